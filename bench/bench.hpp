@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * Minimal microbenchmark harness with no dependencies.
+ *
+ * A benchmark is a callable that does n operations when called with n. The runner grows n until one run
+ * takes at least minRunTime, then times `reps` runs and reports the median (and best) ns/op, plus
+ * throughput as itemsPerOp * ops/s, e.g. N_SPECTRUM_SAMPLES items for a sample() call.
+ *
+ * Usage: <benchmark> [filter] [--reps N] [--time ms]; only benchmarks whose name contains filter run.
+ * Inputs should come from fixed seeds so runs are comparable between builds. Build in Release.
+ */
+namespace jtx::bench {
+    // Keeps the compiler from discarding a result that is otherwise unused
+    template<typename T>
+    inline void doNotOptimize(const T &v) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(v) : "memory");
+#else
+        static volatile char sink;
+        sink = *reinterpret_cast<const volatile char *>(&v);
+#endif
+    }
+
+    class Runner {
+    public:
+        Runner(const int argc, char **argv) {
+            for (int i = 1; i < argc; ++i) {
+                if (std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+                    reps = std::max(1, std::atoi(argv[++i]));
+                } else if (std::strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+                    minRunTime = std::max(1.0, std::atof(argv[++i])) * 1e6;
+                } else {
+                    filter = argv[i];
+                }
+            }
+
+            std::printf("reps: %d, min run time: %.0f ms, AVX2: %s\n", reps, minRunTime * 1e-6,
+#ifdef __AVX2__
+                        "on"
+#else
+                        "off"
+#endif
+            );
+            std::printf("%-48s %12s %12s %14s\n", "benchmark", "ns/op", "best ns/op", "Msamples/s");
+        }
+
+        template<typename F>
+        void run(const std::string &name, F &&f, const double itemsPerOp = 1) {
+            if (!filter.empty() && name.find(filter) == std::string::npos) return;
+
+            size_t n = 1;
+            for (double t = time(f, n); t < minRunTime && n < (size_t(1) << 32); t = time(f, n)) {
+                // Aim a little past minRunTime, growing at most 100x per step while runs are too short to trust
+                n = static_cast<size_t>(std::ceil(static_cast<double>(n) * std::min(100.0, 1.2 * minRunTime / std::max(t, 1.0))));
+            }
+
+            std::vector<double> ns(reps);
+            for (double &t: ns) t = time(f, n) / static_cast<double>(n);
+            std::sort(ns.begin(), ns.end());
+            const double median = ns[ns.size() / 2];
+            std::printf("%-48s %12.2f %12.2f %14.2f\n", name.c_str(), median, ns.front(), itemsPerOp * 1e3 / median);
+        }
+
+    private:
+        template<typename F>
+        static double time(F &f, const size_t n) {
+            const auto start = std::chrono::steady_clock::now();
+            f(n);
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        std::string filter;
+        int reps = 9;
+        double minRunTime = 20e6;
+    };
+}
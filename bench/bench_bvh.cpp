@@ -0,0 +1,278 @@
+#include "bench.hpp"
+
+#include <jtxlib/accel/bvh.hpp>
+#include <jtxlib/accel/bvh8.hpp>
+#include <jtxlib/accel/raysort.hpp>
+#include <jtxlib/accel/tlas.hpp>
+#include <jtxlib/util/parallel.hpp>
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace jtx;
+using bench::doNotOptimize;
+
+namespace {
+    constexpr uint32_t SEED = 0x5eed;
+    constexpr size_t N_BOXES = 1 << 20;
+    constexpr size_t N_RAYS = 1 << 16;
+    constexpr size_t RAY_MASK = N_RAYS - 1;
+
+    // Small boxes scattered through the unit cube stand in for scene primitives
+    std::vector<BBox3f> makeBoxes() {
+        std::mt19937 rng(SEED);
+        std::uniform_real_distribution<float> u(0, 1);
+        std::vector<BBox3f> boxes(N_BOXES);
+        for (BBox3f &b: boxes) {
+            const Point3f p{u(rng), u(rng), u(rng)};
+            b = BBox3f(p, p + Vec3f{u(rng), u(rng), u(rng)} * 0.005f);
+        }
+        return boxes;
+    }
+
+    // Incoherent rays: random origins inside the cube, random directions
+    std::vector<Rayf> makeRays() {
+        std::mt19937 rng(SEED + 1);
+        std::uniform_real_distribution<float> u(0, 1), v(-1, 1);
+        std::vector<Rayf> rays;
+        rays.reserve(N_RAYS);
+        for (size_t i = 0; i < N_RAYS; ++i) {
+            rays.emplace_back(Point3f{u(rng), u(rng), u(rng)}, normalize(Vec3f{v(rng), v(rng), v(rng)}));
+        }
+        return rays;
+    }
+
+    // Coherent rays: a pinhole camera in front of the cube, one ray per pixel in scanline order
+    std::vector<Rayf> makeCameraRays() {
+        constexpr size_t RES = 256;
+        static_assert(RES * RES == N_RAYS);
+        std::vector<Rayf> rays;
+        rays.reserve(N_RAYS);
+        for (size_t y = 0; y < RES; ++y) {
+            for (size_t x = 0; x < RES; ++x) {
+                const float u = (static_cast<float>(x) + 0.5f) / RES - 0.5f, v = (static_cast<float>(y) + 0.5f) / RES - 0.5f;
+                rays.emplace_back(Point3f{0.5f, 0.5f, -1.0f}, normalize(Vec3f{u, v, 1.0f}));
+            }
+        }
+        return rays;
+    }
+
+    // One frame of a smooth wave through the boxes, standing in for a skinned animation
+    std::vector<BBox3f> deform(const std::vector<BBox3f> &boxes, const float phase) {
+        std::vector<BBox3f> out(boxes.size());
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            const Point3f &p = boxes[i].pmin;
+            const Vec3f d = Vec3f{std::sin(20 * p.y + phase), std::sin(20 * p.z + phase),
+                                  std::sin(20 * p.x + phase)} * 0.2f;
+            out[i] = BBox3f(boxes[i].pmin + d, boxes[i].pmax + d);
+        }
+        return out;
+    }
+
+    // The primitive callbacks: the boxes themselves are the primitives
+    template<typename Accel>
+    float closestHit(const Accel &accel, const std::vector<BBox3f> &boxes, const Rayf &ray,
+                     BVHTraversalStats *stats = nullptr) {
+        float tHit = INFINITY_F;
+        accel.intersect(ray, INFINITY_F, [&](const uint32_t p, float &tMax) {
+            float t0;
+            if (!boxes[p].intersectP(ray.origin, ray.dir, tMax, &t0) || t0 >= tMax) return false;
+            tMax = tHit = t0;
+            return true;
+        }, stats);
+        return tHit;
+    }
+
+    template<typename Accel>
+    bool anyHit(const Accel &accel, const std::vector<BBox3f> &boxes, const Rayf &ray) {
+        return accel.intersectP(ray, INFINITY_F, [&](const uint32_t p, const float tMax) {
+            return boxes[p].intersectP(ray.origin, ray.dir, tMax);
+        });
+    }
+
+    template<typename Accel>
+    void printStats(const char *name, const Accel &accel, const std::vector<BBox3f> &boxes,
+                    const std::vector<Rayf> &rays, const char *rayName) {
+        BVHTraversalStats stats;
+        for (const Rayf &ray: rays) closestHit(accel, boxes, ray, &stats);
+        std::printf("%-11s %-10s %9zu nodes %8.1f MB %8.1f nodes/ray %8.1f prims/ray\n", name, rayName,
+                    accel.getNodes().size(), static_cast<double>(accel.memoryBytes()) / (1024.0 * 1024.0),
+                    static_cast<double>(stats.nodesVisited) / static_cast<double>(rays.size()),
+                    static_cast<double>(stats.primitivesTested) / static_cast<double>(rays.size()));
+    }
+
+    // Items are rays, so the last column is Mrays/s on one thread
+    template<typename Accel>
+    void benchClosestHit(bench::Runner &runner, const std::string &name, const Accel &accel,
+                         const std::vector<BBox3f> &boxes, const std::vector<Rayf> &rays) {
+        runner.run(name, [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) doNotOptimize(closestHit(accel, boxes, rays[i & RAY_MASK]));
+        });
+    }
+
+    template<typename Accel>
+    void benchAnyHit(bench::Runner &runner, const std::string &name, const Accel &accel,
+                     const std::vector<BBox3f> &boxes, const std::vector<Rayf> &rays) {
+        runner.run(name, [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) doNotOptimize(anyHit(accel, boxes, rays[i & RAY_MASK]));
+        });
+    }
+}
+
+int main(int argc, char **argv) {
+    bench::Runner runner(argc, argv);
+    const std::vector<BBox3f> boxes = makeBoxes();
+    const std::vector<Rayf> incoherent = makeRays(), coherent = makeCameraRays();
+
+    // Items are primitives, so the last column is Mprims/s built
+    const std::pair<const char *, BVHBuildMethod> methods[] = {
+        {"SAH", BVHBuildMethod::SAH}, {"LBVH", BVHBuildMethod::LBVH}, {"TreeletLBVH", BVHBuildMethod::TreeletLBVH}};
+    const int hardwareThreads = maxThreads();
+    for (const auto &[methodName, method]: methods) {
+        for (int threads = 1;; threads = hardwareThreads) {
+            setMaxThreads(threads);
+            runner.run(std::string("BVH build ") + methodName + " (1M boxes, " + std::to_string(threads) + " threads)",
+                       [&](const size_t n) {
+                           for (size_t i = 0; i < n; ++i) {
+                               const BVH bvh(boxes, 4, method);
+                               doNotOptimize(bvh.getNodes().data());
+                           }
+                       }, N_BOXES);
+            if (threads == hardwareThreads) break;
+        }
+    }
+    setMaxThreads(0);
+
+    // Refit against rebuilding for deforming geometry, and how far the tree degrades over an animation
+    {
+        const std::vector<BBox3f> frame = deform(boxes, 0.5f);
+        BVH refit(boxes, 4);
+        runner.run("BVH refit (1M boxes)", [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) refit.refit(frame);
+        }, N_BOXES);
+        runner.run("BVH refit with rotations (1M boxes)", [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) refit.refit(frame, true);
+        }, N_BOXES);
+
+        BVH plain(boxes, 4), rotated(boxes, 4);
+        for (int f = 1; f <= 8; ++f) {
+            const std::vector<BBox3f> animated = deform(boxes, 0.5f * static_cast<float>(f));
+            plain.refit(animated);
+            rotated.refit(animated, true);
+            if (f % 4 == 0) {
+                std::printf("frame %d: SAH cost ratio %.3f refit, %.3f refit with rotations\n", f,
+                            static_cast<double>(plain.sahCostRatio()), static_cast<double>(rotated.sahCostRatio()));
+            }
+        }
+    }
+
+    // Tree quality of the faster builders, as traversal work on the same rays
+    for (const auto &[methodName, method]: methods) {
+        if (method == BVHBuildMethod::SAH) continue;
+        const BVH lbvh(boxes, 4, method);
+        printStats(methodName, lbvh, boxes, incoherent, "incoherent");
+        benchClosestHit(runner, std::string(methodName) + " closest hit, incoherent", lbvh, boxes, incoherent);
+    }
+
+    const BVH bvh(boxes, 4);
+    runner.run("BVH8 collapse (1M boxes)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            const BVH8 bvh8(bvh);
+            doNotOptimize(bvh8.getNodes().data());
+        }
+    }, N_BOXES);
+    const BVH8 bvh8(bvh);
+
+    for (const auto &[rayName, rays]: {std::pair{"incoherent", &incoherent}, std::pair{"coherent", &coherent}}) {
+        printStats("BVH", bvh, boxes, *rays, rayName);
+        printStats("BVH8", bvh8, boxes, *rays, rayName);
+    }
+
+    for (const auto &[rayName, rays]: {std::pair{"incoherent", &incoherent}, std::pair{"coherent", &coherent}}) {
+        benchClosestHit(runner, std::string("BVH closest hit, ") + rayName, bvh, boxes, *rays);
+        benchClosestHit(runner, std::string("BVH8 closest hit, ") + rayName, bvh8, boxes, *rays);
+        benchAnyHit(runner, std::string("BVH any hit, ") + rayName, bvh, boxes, *rays);
+        benchAnyHit(runner, std::string("BVH8 any hit, ") + rayName, bvh8, boxes, *rays);
+    }
+
+    // Ray sorting between bounces: the same incoherent batch traced as is, and sorted first with the sort timed too.
+    // Items are rays, so the last column is Mrays/s
+    {
+        std::vector<Rayf> batch(incoherent.size());
+        std::vector<uint32_t> order(incoherent.size());
+        std::vector<float> tHits(incoherent.size());
+        RaySorter sorter;
+        runner.run("BVH closest hit batch, unsorted", [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                std::copy(incoherent.begin(), incoherent.end(), batch.begin());
+                for (size_t r = 0; r < batch.size(); ++r) tHits[r] = closestHit(bvh, boxes, batch[r]);
+                doNotOptimize(tHits.data());
+            }
+        }, N_RAYS);
+        runner.run("BVH closest hit batch, sorted", [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                std::copy(incoherent.begin(), incoherent.end(), batch.begin());
+                sorter.sort(batch, bvh.bounds(), order);
+                for (size_t r = 0; r < batch.size(); ++r) tHits[order[r]] = closestHit(bvh, boxes, batch[r]);
+                doNotOptimize(tHits.data());
+            }
+        }, N_RAYS);
+        runner.run("Ray sort only", [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                std::copy(incoherent.begin(), incoherent.end(), batch.begin());
+                sorter.sort(batch, bvh.bounds(), order);
+                doNotOptimize(batch.data());
+            }
+        }, N_RAYS);
+    }
+
+    // Instancing: one object of 4K boxes placed 256 times in a grid, against the same copies flattened into world space
+    {
+        constexpr int GRID = 16;
+        std::mt19937 rng(SEED + 2);
+        std::uniform_real_distribution<float> u(0, 1);
+        std::vector<BBox3f> object(N_BOXES / (GRID * GRID));
+        for (BBox3f &b: object) {
+            const Point3f p{u(rng), u(rng), u(rng)};
+            b = BBox3f(p, p + Vec3f{u(rng), u(rng), u(rng)} * 0.05f);
+        }
+        const BVH blas(object, 4);
+
+        std::vector<TLAS<>::Instance> instances;
+        std::vector<BBox3f> flattened;
+        flattened.reserve(N_BOXES);
+        for (int i = 0; i < GRID * GRID; ++i) {
+            const Transform t = Transform::translate((static_cast<float>(i % GRID) + 0.5f) / GRID,
+                                                     (static_cast<float>(i / GRID) + 0.5f) / GRID, 0.5f) *
+                                Transform::rotateZ(360 * u(rng)) *
+                                Transform::scale(1.0f / GRID, 1.0f / GRID, 1.0f / GRID) * Transform::translate(-0.5f);
+            instances.push_back({&blas, t});
+            for (const BBox3f &b: object) flattened.push_back(t.applyToBBox(b));
+        }
+        const TLAS<> tlas(instances);
+        const BVH flat(flattened, 4);
+        std::printf("instanced: %.2f MB (%.2f MB top level + %.2f MB BLAS), flattened: %.2f MB\n",
+                    static_cast<double>(tlas.memoryBytes() + blas.memoryBytes()) / (1024.0 * 1024.0),
+                    static_cast<double>(tlas.memoryBytes()) / (1024.0 * 1024.0),
+                    static_cast<double>(blas.memoryBytes()) / (1024.0 * 1024.0),
+                    static_cast<double>(flat.memoryBytes()) / (1024.0 * 1024.0));
+
+        runner.run("TLAS closest hit, coherent (256 instances)", [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                const Rayf &ray = coherent[i & RAY_MASK];
+                float tHit = INFINITY_F;
+                tlas.intersect(ray, INFINITY_F, [&](uint32_t, const uint32_t p, const Rayf &objectRay, float &tMax) {
+                    float t0;
+                    if (!object[p].intersectP(objectRay.origin, objectRay.dir, tMax, &t0) || t0 >= tMax) return false;
+                    tMax = tHit = t0;
+                    return true;
+                });
+                doNotOptimize(tHit);
+            }
+        });
+        benchClosestHit(runner, "Flattened closest hit, coherent (256 instances)", flat, flattened, coherent);
+    }
+}
@@ -0,0 +1,134 @@
+#include "bench.hpp"
+
+#include <jtxlib/util/taggedptr.hpp>
+
+#include <cmath>
+#include <random>
+#include <tuple>
+
+using namespace jtx;
+using bench::doNotOptimize;
+
+namespace {
+    constexpr uint32_t SEED = 0x5eed;
+    constexpr size_t N_HANDLES = 4096;
+    constexpr size_t HANDLE_MASK = N_HANDLES - 1;
+
+    // Stand-ins for the spectrum types: small bodies that differ per type so every case is real work
+    template<int N>
+    struct Shape {
+        float k = 1.0f + N;
+
+        [[nodiscard]] float eval(const float x) const {
+            if constexpr (N % 4 == 0) return x * k + N;
+            else if constexpr (N % 4 == 1) return x / k - N;
+            else if constexpr (N % 4 == 2) return std::sqrt(x * k) + N;
+            else return x * x * k - N;
+        }
+    };
+
+    // The hand-written switch dispatch TaggedPtr used before, one overload per type count. It stopped at 8
+    // types; the 16 type version is written the same way so the largest size has a baseline too.
+    namespace legacy {
+        template<typename F, typename R, typename T0, typename T1>
+        R dispatch(F &&f, const void *ptr, int tag) {
+            if (tag == 0) return f((const T0 *) ptr);
+            return f((const T1 *) ptr);
+        }
+
+        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3>
+        R dispatch(F &&f, const void *ptr, int tag) {
+            switch (tag) {
+                case 0: return f((const T0 *) ptr);
+                case 1: return f((const T1 *) ptr);
+                case 2: return f((const T2 *) ptr);
+                default: return f((const T3 *) ptr);
+            }
+        }
+
+        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3, typename T4, typename T5,
+                 typename T6, typename T7>
+        R dispatch(F &&f, const void *ptr, int tag) {
+            switch (tag) {
+                case 0: return f((const T0 *) ptr);
+                case 1: return f((const T1 *) ptr);
+                case 2: return f((const T2 *) ptr);
+                case 3: return f((const T3 *) ptr);
+                case 4: return f((const T4 *) ptr);
+                case 5: return f((const T5 *) ptr);
+                case 6: return f((const T6 *) ptr);
+                default: return f((const T7 *) ptr);
+            }
+        }
+
+        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3, typename T4, typename T5,
+                 typename T6, typename T7, typename T8, typename T9, typename T10, typename T11, typename T12,
+                 typename T13, typename T14, typename T15>
+        R dispatch(F &&f, const void *ptr, int tag) {
+            switch (tag) {
+                case 0: return f((const T0 *) ptr);
+                case 1: return f((const T1 *) ptr);
+                case 2: return f((const T2 *) ptr);
+                case 3: return f((const T3 *) ptr);
+                case 4: return f((const T4 *) ptr);
+                case 5: return f((const T5 *) ptr);
+                case 6: return f((const T6 *) ptr);
+                case 7: return f((const T7 *) ptr);
+                case 8: return f((const T8 *) ptr);
+                case 9: return f((const T9 *) ptr);
+                case 10: return f((const T10 *) ptr);
+                case 11: return f((const T11 *) ptr);
+                case 12: return f((const T12 *) ptr);
+                case 13: return f((const T13 *) ptr);
+                case 14: return f((const T14 *) ptr);
+                default: return f((const T15 *) ptr);
+            }
+        }
+    }
+
+    template<typename... Ts, size_t... Is>
+    void benchDispatch(bench::Runner &runner, std::index_sequence<Is...>) {
+        using Ptr = TaggedPtr<Ts...>;
+        constexpr size_t N = sizeof...(Ts);
+        const std::tuple<Ts...> objects;
+
+        std::mt19937 rng(SEED);
+        std::vector<Ptr> handles(N_HANDLES);
+        for (Ptr &h: handles) {
+            const size_t t = rng() % N;
+            ((t == Is && (h = Ptr(const_cast<Ts *>(&std::get<Is>(objects))), true)) || ...);
+        }
+        std::vector<Ptr> sorted = handles;
+        std::sort(sorted.begin(), sorted.end(), [](const Ptr &a, const Ptr &b) { return a.getTag() < b.getTag(); });
+
+        auto eval = [](auto p) { return p->eval(0.5f); };
+        for (const bool isSorted: {false, true}) {
+            const std::vector<Ptr> &hs = isSorted ? sorted : handles;
+            const std::string suffix = " (" + std::to_string(N) + " types, " + (isSorted ? "sorted)" : "random)");
+
+            runner.run("TaggedPtr::dispatch" + suffix, [&](const size_t n) {
+                for (size_t i = 0; i < n; ++i) doNotOptimize(hs[i & HANDLE_MASK].dispatch(eval));
+            });
+
+            runner.run("legacy switch dispatch" + suffix, [&](const size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    const Ptr &h = hs[i & HANDLE_MASK];
+                    doNotOptimize(legacy::dispatch<decltype(eval) &, float, Ts...>(eval, h.getPtr(), h.getTag() - 1));
+                }
+            });
+        }
+    }
+
+    template<size_t... Is>
+    void benchShapes(bench::Runner &runner, std::index_sequence<Is...> is) {
+        benchDispatch<Shape<Is>...>(runner, is);
+    }
+}
+
+int main(int argc, char **argv) {
+    bench::Runner runner(argc, argv);
+    benchShapes(runner, std::make_index_sequence<2>{});
+    benchShapes(runner, std::make_index_sequence<4>{});
+    benchShapes(runner, std::make_index_sequence<8>{});
+    benchShapes(runner, std::make_index_sequence<16>{});
+}
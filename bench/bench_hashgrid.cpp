@@ -0,0 +1,74 @@
+#include "bench.hpp"
+
+#include <jtxlib/accel/hashgrid.hpp>
+#include <jtxlib/accel/kdtree.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace jtx;
+using bench::doNotOptimize;
+
+namespace {
+    constexpr uint32_t SEED = 0x5eed;
+    constexpr size_t N_POINTS = 1 << 20;
+    constexpr size_t N_QUERIES = 4096;
+    constexpr size_t QUERY_MASK = N_QUERIES - 1;
+    // About 16 points of the cloud fall within this radius of a query inside it
+    constexpr float RADIUS = 0.0156f;
+
+    std::vector<Point3f> makePoints(const size_t n, const uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> u(0, 1);
+        std::vector<Point3f> points;
+        for (size_t i = 0; i < n; ++i) points.emplace_back(u(rng), u(rng), u(rng));
+        return points;
+    }
+}
+
+int main(int argc, char **argv) {
+    bench::Runner runner(argc, argv);
+    const std::vector<Point3f> points = makePoints(N_POINTS, SEED);
+    const std::vector<Point3f> queries = makePoints(N_QUERIES, SEED + 1);
+
+    // Rebuilding one grid, as progressive photon mapping does every iteration, against building a k-d tree.
+    // Items are points, so the last column is Mpoints/s built
+    HashGrid grid(RADIUS);
+    const int hardwareThreads = maxThreads();
+    for (int threads = 1;; threads = hardwareThreads) {
+        setMaxThreads(threads);
+        runner.run("HashGrid rebuild (1M points, " + std::to_string(threads) + " threads)", [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                grid.build(points);
+                doNotOptimize(grid.getCells().data());
+            }
+        }, N_POINTS);
+        runner.run("KdTree build (1M points, " + std::to_string(threads) + " threads)", [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                const KdTree tree(points);
+                doNotOptimize(tree.getNodes().data());
+            }
+        }, N_POINTS);
+        if (threads == hardwareThreads) break;
+    }
+    setMaxThreads(0);
+
+    // The same fixed-radius queries on both; items are queries, so the last column is Mqueries/s
+    const KdTree tree(points);
+    runner.run("HashGrid radius search, ~16 found (1M points)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t found = 0;
+            grid.radiusSearch(queries[i & QUERY_MASK], [&](uint32_t, float) { ++found; });
+            doNotOptimize(found);
+        }
+    });
+    runner.run("KdTree radius search, ~16 found (1M points)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t found = 0;
+            tree.radiusSearch(queries[i & QUERY_MASK], RADIUS, [&](uint32_t, float) { ++found; });
+            doNotOptimize(found);
+        }
+    });
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "bench.hpp"
+
+#include <jtxlib/accel/kdtree.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace jtx;
+using bench::doNotOptimize;
+
+namespace {
+    constexpr uint32_t SEED = 0x5eed;
+    constexpr size_t N_POINTS = 1 << 20;
+    constexpr size_t N_QUERIES = 4096;
+    constexpr size_t QUERY_MASK = N_QUERIES - 1;
+    constexpr int K = 16;
+    // About K points of the cloud fall within this radius of a query inside it
+    constexpr float RADIUS = 0.0156f;
+
+    std::vector<Point3f> makePoints(const size_t n, const uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> u(0, 1);
+        std::vector<Point3f> points;
+        for (size_t i = 0; i < n; ++i) points.emplace_back(u(rng), u(rng), u(rng));
+        return points;
+    }
+}
+
+int main(int argc, char **argv) {
+    bench::Runner runner(argc, argv);
+    const std::vector<Point3f> points = makePoints(N_POINTS, SEED);
+    const std::vector<Point3f> queries = makePoints(N_QUERIES, SEED + 1);
+
+    // Items are points, so the last column is Mpoints/s built
+    const int hardwareThreads = maxThreads();
+    for (int threads = 1;; threads = hardwareThreads) {
+        setMaxThreads(threads);
+        runner.run("KdTree build (1M points, " + std::to_string(threads) + " threads)", [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                const KdTree tree(points);
+                doNotOptimize(tree.getNodes().data());
+            }
+        }, N_POINTS);
+        if (threads == hardwareThreads) break;
+    }
+    setMaxThreads(0);
+
+    // Items are queries from here on, so the last column is Mqueries/s
+    const KdTree tree(points);
+    KdTreeNeighbor neighbors[K];
+    runner.run("KdTree 16-nearest (1M points)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) doNotOptimize(tree.knn(queries[i & QUERY_MASK], neighbors));
+    });
+
+    runner.run("KdTree radius search, ~16 found (1M points)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t found = 0;
+            tree.radiusSearch(queries[i & QUERY_MASK], RADIUS, [&](uint32_t, float) { ++found; });
+            doNotOptimize(found);
+        }
+    });
+
+    // The baseline the tree replaces: a full pass with a bounded heap
+    runner.run("Brute force 16-nearest (1M points)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            const Point3f &q = queries[i & QUERY_MASK];
+            NeighborHeap heap(neighbors);
+            for (size_t p = 0; p < N_POINTS; ++p) heap.push(static_cast<uint32_t>(p), distanceSqr(points[p], q));
+            doNotOptimize(heap.size());
+        }
+    });
+
+    std::vector<KdTreeNeighbor> batchNeighbors(N_QUERIES * K);
+    std::vector<uint32_t> counts(N_QUERIES);
+    for (int threads = 1;; threads = hardwareThreads) {
+        setMaxThreads(threads);
+        runner.run("KdTree 16-nearest batch (" + std::to_string(threads) + " threads)", [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                tree.knn(queries, K, batchNeighbors, counts);
+                doNotOptimize(counts.data());
+            }
+        }, N_QUERIES);
+        if (threads == hardwareThreads) break;
+    }
+    setMaxThreads(0);
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "bench.hpp"
+#include "film.hpp"
+#include "spectrum.hpp"
+
+#include <random>
+
+using namespace jtx;
+using bench::doNotOptimize;
+
+namespace {
+    constexpr uint32_t SEED = 0x5eed;
+    // Power of two so benchmarks can cycle through inputs with a mask
+    constexpr size_t N_INPUTS = 4096;
+    constexpr size_t INPUT_MASK = N_INPUTS - 1;
+
+    struct Inputs {
+        std::vector<float> u, temps;
+        std::vector<SampledWavelengths> lambda;
+        std::vector<SampledSpectrum> a, b;
+
+        explicit Inputs(const uint32_t seed) {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> uniform(0, 1);
+            for (size_t i = 0; i < N_INPUTS; ++i) {
+                u.push_back(uniform(rng));
+                temps.push_back(1000 + 9000 * uniform(rng));
+                lambda.push_back(SampledWavelengths::sampleVisible(uniform(rng)));
+
+                SampledSpectrum sa, sb;
+                for (int j = 0; j < N_SPECTRUM_SAMPLES; ++j) {
+                    sa[j] = uniform(rng);
+                    // Kept away from 0 so division doesn't hit denormals
+                    sb[j] = 0.1f + uniform(rng);
+                }
+                a.push_back(sa);
+                b.push_back(sb);
+            }
+        }
+    };
+
+    template<typename S>
+    void benchSample(bench::Runner &runner, const std::string &name, const S &s, const Inputs &in) {
+        runner.run(name + "::sample", [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) doNotOptimize(s.sample(in.lambda[i & INPUT_MASK]));
+        }, N_SPECTRUM_SAMPLES);
+    }
+
+    template<typename F>
+    void benchArithmetic(bench::Runner &runner, const std::string &name, F op, const Inputs &in) {
+        runner.run("SampledSpectrum " + name, [&](const size_t n) {
+            for (size_t i = 0; i < n; ++i) doNotOptimize(op(in.a[i & INPUT_MASK], in.b[i & INPUT_MASK]));
+        }, N_SPECTRUM_SAMPLES);
+    }
+}
+
+int main(int argc, char **argv) {
+    RGBToSpectrumTable::init({});
+    bench::Runner runner(argc, argv);
+    const Inputs in(SEED);
+
+    //region Spectrum sample()
+    ConstantSpectrum constant(0.5f);
+    DenselySampledSpectrum dense(spectra::X(), Allocator{});
+    CompactDenseSpectrum compactHalf(Spectrum(&dense), 5, true);
+
+    std::mt19937 rng(SEED);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    std::vector<float> knotLambda, knotValues;
+    for (int i = 0; i < 32; ++i) {
+        knotLambda.push_back(LAMBDA_MIN + (LAMBDA_MAX - LAMBDA_MIN) * static_cast<float>(i) / 31);
+        knotValues.push_back(uniform(rng));
+    }
+    PiecewiseLinearSpectrum pwl({knotLambda.data(), knotLambda.size()}, {knotValues.data(), knotValues.size()});
+
+    BlackbodySpectrum blackbody(5500);
+    BlackbodyTableCache blackbodyCache;
+    BlackbodySpectrum blackbodyCached(5500, blackbodyCache);
+    RGBAlbedoSpectrum albedo(*RGBToSpectrumTable::sRGB, {0.2f, 0.5f, 0.8f});
+    RGBUnboundedSpectrum unbounded(*RGBToSpectrumTable::sRGB, {2.0f, 5.0f, 8.0f});
+    RGBIlluminantSpectrum illuminant(*RGBToSpectrumTable::sRGB, {0.8f, 0.6f, 0.4f}, &spectra::D65());
+
+    benchSample(runner, "ConstantSpectrum", constant, in);
+    benchSample(runner, "DenselySampledSpectrum", dense, in);
+    benchSample(runner, "CompactDenseSpectrum (5nm, fp16)", compactHalf, in);
+    benchSample(runner, "PiecewiseLinearSpectrum (32 knots)", pwl, in);
+    benchSample(runner, "BlackbodySpectrum", blackbody, in);
+    benchSample(runner, "BlackbodySpectrum (table)", blackbodyCached, in);
+    benchSample(runner, "RGBAlbedoSpectrum", albedo, in);
+    benchSample(runner, "RGBUnboundedSpectrum", unbounded, in);
+    benchSample(runner, "RGBIlluminantSpectrum", illuminant, in);
+
+    // Same spectra through the tagged pointer, in a fixed random order so the dispatch branch is unpredictable
+    const Spectrum types[] = {Spectrum(&constant), Spectrum(&dense), Spectrum(&compactHalf), Spectrum(&pwl),
+                              Spectrum(&blackbody), Spectrum(&albedo), Spectrum(&unbounded), Spectrum(&illuminant)};
+    std::vector<Spectrum> handles(N_INPUTS);
+    for (Spectrum &h: handles) h = types[rng() % std::size(types)];
+
+    runner.run("Spectrum::sample (mixed handles)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) doNotOptimize(handles[i & INPUT_MASK].sample(in.lambda[i & INPUT_MASK]));
+    }, N_SPECTRUM_SAMPLES);
+
+    SpectrumBatch batch;
+    std::vector<SampledSpectrum> batchOut(N_INPUTS);
+    runner.run("SpectrumBatch::sample (mixed handles)", [&](const size_t n) {
+        // One op is one spectrum, so whole batches are timed and the remainder rounds up
+        for (size_t i = 0; i < n; i += N_INPUTS) {
+            batch.sample({handles.data(), N_INPUTS}, in.lambda[(i / N_INPUTS) & INPUT_MASK],
+                         {batchOut.data(), N_INPUTS});
+            doNotOptimize(batchOut[0]);
+        }
+    }, N_SPECTRUM_SAMPLES);
+    //endregion
+
+    //region SampledSpectrum arithmetic
+    benchArithmetic(runner, "a * b + a", [](const SampledSpectrum &a, const SampledSpectrum &b) { return a * b + a; }, in);
+    benchArithmetic(runner, "a / b", [](const SampledSpectrum &a, const SampledSpectrum &b) { return a / b; }, in);
+    benchArithmetic(runner, "safeDiv", [](const SampledSpectrum &a, const SampledSpectrum &b) {
+        return SampledSpectrum::safeDiv(a, b);
+    }, in);
+    benchArithmetic(runner, "exp(-a)", [](const SampledSpectrum &a, const SampledSpectrum &) {
+        return SampledSpectrum::exp(-a);
+    }, in);
+    benchArithmetic(runner, "average", [](const SampledSpectrum &a, const SampledSpectrum &) { return a.average(); }, in);
+    //endregion
+
+    //region SampledWavelengths
+    runner.run("SampledWavelengths::sampleUniform", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) doNotOptimize(SampledWavelengths::sampleUniform(in.u[i & INPUT_MASK]));
+    }, N_SPECTRUM_SAMPLES);
+
+    runner.run("SampledWavelengths::sampleVisible", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) doNotOptimize(SampledWavelengths::sampleVisible(in.u[i & INPUT_MASK]));
+    }, N_SPECTRUM_SAMPLES);
+    //endregion
+
+    //region Whole spectra
+    const Spectrum x(&dense), bb(&blackbody);
+    runner.run("innerProduct (dense, dense)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) doNotOptimize(innerProduct(x, x));
+    }, N_DENSE_SAMPLES);
+
+    runner.run("innerProduct (dense, blackbody)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) doNotOptimize(innerProduct(x, bb));
+    }, N_DENSE_SAMPLES);
+
+    const Spectrum knots(&pwl), flat(&constant);
+    runner.run("innerProduct (pwl, pwl)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) doNotOptimize(innerProduct(knots, knots));
+    }, N_DENSE_SAMPLES);
+
+    runner.run("innerProduct (constant, pwl)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) doNotOptimize(innerProduct(flat, knots));
+    }, N_DENSE_SAMPLES);
+
+    // Only shared handles are cached, so the same knots are converted interned and as a local spectrum
+    const Spectrum interned = spectra::intern(pwl.getLambdas(), pwl.getValues());
+    runner.run("SpectrumToXYZ (interned, cached)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) doNotOptimize(SpectrumToXYZ(interned));
+    }, N_DENSE_SAMPLES);
+
+    runner.run("SpectrumToXYZ (uncached)", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) doNotOptimize(SpectrumToXYZ(knots));
+    }, N_DENSE_SAMPLES);
+
+    runner.run("blackBody", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            doNotOptimize(blackBody(LAMBDA_MIN + 470 * in.u[i & INPUT_MASK], in.temps[i & INPUT_MASK]));
+        }
+    });
+    //endregion
+
+    //region Film
+    const FilmSensor sensor(Mat3::identity());
+    std::vector<Color> rgb(N_INPUTS);
+    runner.run("FilmSensor::toRGB", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) doNotOptimize(sensor.toRGB(in.a[i & INPUT_MASK], in.lambda[i & INPUT_MASK]));
+    }, N_SPECTRUM_SAMPLES);
+
+    runner.run("FilmSensor::toRGB (batch)", [&](const size_t n) {
+        for (size_t i = 0; i < n; i += N_INPUTS) {
+            sensor.toRGB({in.a.data(), N_INPUTS}, {in.lambda.data(), N_INPUTS}, {rgb.data(), N_INPUTS});
+            doNotOptimize(rgb[0]);
+        }
+    }, N_SPECTRUM_SAMPLES);
+    //endregion
+}
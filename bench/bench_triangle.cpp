@@ -0,0 +1,93 @@
+#include "bench.hpp"
+
+#include <jtxlib/geometry/triangle.hpp>
+
+#include <random>
+#include <vector>
+
+using namespace jtx;
+using bench::doNotOptimize;
+
+namespace {
+    constexpr uint32_t SEED = 0x5eed;
+    constexpr size_t N_PACKETS = 4096;
+    constexpr size_t PACKET_MASK = N_PACKETS - 1;
+    constexpr size_t N_RAYS = 1024;
+    constexpr size_t RAY_MASK = N_RAYS - 1;
+
+    // Leaf-sized groups of 8 nearby triangles, so rays hit some of them, as in a BVH leaf
+    std::vector<Triangle8> makePackets() {
+        std::mt19937 rng(SEED);
+        std::uniform_real_distribution<float> u(0, 1), v(-0.5f, 0.5f);
+        std::vector<Triangle8> packets(N_PACKETS);
+        for (size_t i = 0; i < N_PACKETS; ++i) {
+            for (int lane = 0; lane < Triangle8::WIDTH; ++lane) {
+                const Point3f c{u(rng), u(rng), u(rng)};
+                packets[i].set(lane, c + Vec3f{v(rng), v(rng), v(rng)}, c + Vec3f{v(rng), v(rng), v(rng)},
+                               c + Vec3f{v(rng), v(rng), v(rng)}, static_cast<uint32_t>(i * Triangle8::WIDTH + lane));
+            }
+        }
+        return packets;
+    }
+
+    std::vector<Rayf> makeRays() {
+        std::mt19937 rng(SEED + 1);
+        std::uniform_real_distribution<float> u(0, 1), v(-1, 1);
+        std::vector<Rayf> rays;
+        for (size_t i = 0; i < N_RAYS; ++i) {
+            rays.emplace_back(Point3f{u(rng), u(rng), -1.0f}, Vec3f{0.3f * v(rng), 0.3f * v(rng), 1.0f});
+        }
+        return rays;
+    }
+}
+
+int main(int argc, char **argv) {
+    bench::Runner runner(argc, argv);
+    const std::vector<Triangle8> packets = makePackets();
+    const std::vector<Rayf> rays = makeRays();
+    std::vector<PrecomputedTriangle> precomputed;
+    for (const Triangle8 &packet: packets) {
+        for (int lane = 0; lane < Triangle8::WIDTH; ++lane) {
+            precomputed.emplace_back(packet.vertex(lane, 0), packet.vertex(lane, 1), packet.vertex(lane, 2));
+        }
+    }
+
+    // Each op is one ray against one packet's 8 triangles, closest hit; items are triangles, so the last column is
+    // Mtriangle tests/s
+    runner.run("Watertight, scalar", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            const TriangleRay ray(rays[i & RAY_MASK]);
+            const Triangle8 &packet = packets[i & PACKET_MASK];
+            float tMax = INFINITY_F;
+            for (int lane = 0; lane < Triangle8::WIDTH; ++lane) {
+                TriangleIntersection isect;
+                if (intersectTriangle(ray, packet.vertex(lane, 0), packet.vertex(lane, 1), packet.vertex(lane, 2),
+                                      tMax, &isect)) {
+                    tMax = isect.t;
+                }
+            }
+            doNotOptimize(tMax);
+        }
+    }, Triangle8::WIDTH);
+
+    runner.run("Precomputed (Baldwin-Weber), scalar", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            const Rayf &ray = rays[i & RAY_MASK];
+            const PrecomputedTriangle *tris = &precomputed[(i & PACKET_MASK) * Triangle8::WIDTH];
+            float tMax = INFINITY_F;
+            for (int lane = 0; lane < Triangle8::WIDTH; ++lane) {
+                TriangleIntersection isect;
+                if (tris[lane].intersect(ray, tMax, &isect)) tMax = isect.t;
+            }
+            doNotOptimize(tMax);
+        }
+    }, Triangle8::WIDTH);
+
+    runner.run("Watertight, Triangle8", [&](const size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            TriangleIntersection isect;
+            doNotOptimize(intersectTriangle8(packets[i & PACKET_MASK], TriangleRay(rays[i & RAY_MASK]), INFINITY_F,
+                                             &isect));
+        }
+    }, Triangle8::WIDTH);
+}
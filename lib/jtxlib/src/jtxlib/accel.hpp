@@ -0,0 +1,8 @@
+#pragma once
+
+#include "accel/bvh.hpp"
+#include "accel/bvh8.hpp"
+#include "accel/hashgrid.hpp"
+#include "accel/kdtree.hpp"
+#include "accel/raysort.hpp"
+#include "accel/tlas.hpp"
@@ -0,0 +1,473 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <jtxlib/util/parallel.hpp>
+
+namespace jtx {
+    namespace {
+        constexpr int N_BUCKETS = 12;
+        // Subtrees at least this large are built on another thread
+        constexpr size_t PARALLEL_BUILD_THRESHOLD = 128 * 1024;
+        // Nodes at least this large also compute bounds and bins in parallel
+        constexpr size_t PARALLEL_BIN_THRESHOLD = 256 * 1024;
+        constexpr size_t BIN_CHUNK_SIZE = 64 * 1024;
+        // Relative to intersecting one primitive
+        constexpr float TRAVERSAL_COST = 0.5f;
+        // Past this depth splits are by count, which adds at most 31 levels for fewer than 2^31 primitives and so keeps
+        // every tree within BVH::MAX_DEPTH
+        constexpr int EQUAL_COUNTS_DEPTH = BVH::MAX_DEPTH - 32;
+        // Subtrees with at least this many nodes are refit, and laid out again after rotations, on another thread
+        constexpr uint32_t PARALLEL_REFIT_THRESHOLD = 64 * 1024;
+        constexpr size_t REFIT_CHUNK_SIZE = 64 * 1024;
+
+        struct BVHPrimitive {
+            BBox3f bounds;
+            Point3f centroid;
+            uint32_t index;
+        };
+
+        struct BVHBuildNode {
+            BBox3f bounds;
+            BVHBuildNode *children[2] = {nullptr, nullptr};
+            uint32_t firstPrimOffset = 0, nPrimitives = 0;
+            int splitAxis = 0;
+        };
+
+        struct Bucket {
+            uint32_t count = 0;
+            BBox3f bounds;
+        };
+
+        struct NodeBounds {
+            BBox3f bounds, centroidBounds;
+
+            void merge(const NodeBounds &b) {
+                bounds.merge(b.bounds);
+                centroidBounds.merge(b.centroidBounds);
+            }
+        };
+
+        // Runs f(chunkBegin, chunkEnd, result) per chunk, in parallel for large ranges, and merges the chunk results
+        template<typename R, typename F>
+        R reduceChunks(const size_t n, F &&f) {
+            if (n < PARALLEL_BIN_THRESHOLD) {
+                R r;
+                f(0, n, r);
+                return r;
+            }
+            std::vector<R> partial((n + BIN_CHUNK_SIZE - 1) / BIN_CHUNK_SIZE);
+            parallelFor(0, n, BIN_CHUNK_SIZE, [&](const size_t b, const size_t e) { f(b, e, partial[b / BIN_CHUNK_SIZE]); });
+            for (size_t i = 1; i < partial.size(); ++i) partial[0].merge(partial[i]);
+            return partial[0];
+        }
+
+        struct Buckets {
+            Bucket b[N_BUCKETS];
+
+            void merge(const Buckets &o) {
+                for (int i = 0; i < N_BUCKETS; ++i) {
+                    b[i].count += o.b[i].count;
+                    b[i].bounds.merge(o.b[i].bounds);
+                }
+            }
+        };
+
+        class BVHBuilder {
+        public:
+            BVHBuilder(span<BVHPrimitive> primitives, vector<uint32_t> &ordered, const int maxPrimsInNode)
+                : primitives(primitives), ordered(ordered), maxPrimsInNode(maxPrimsInNode) {}
+
+            BVHBuildNode *build() { return buildRecursive(newArena(), primitives, 0); }
+
+            [[nodiscard]] int nodeCount() const { return totalNodes.load(); }
+
+        private:
+            // Each task gets its own arena, since monotonic_buffer_resource is not thread-safe
+            Allocator newArena() {
+                std::lock_guard lock(arenaMutex);
+                arenas.push_back(std::make_unique<pmr::monotonic_buffer_resource>(64 * 1024));
+                return Allocator(arenas.back().get());
+            }
+
+            BVHBuildNode *makeLeaf(BVHBuildNode *node, span<BVHPrimitive> prims, const BBox3f &bounds) {
+                const uint32_t offset = orderedOffset.fetch_add(static_cast<uint32_t>(prims.size()));
+                for (size_t i = 0; i < prims.size(); ++i) ordered[offset + i] = prims[i].index;
+                node->bounds = bounds;
+                node->firstPrimOffset = offset;
+                node->nPrimitives = static_cast<uint32_t>(prims.size());
+                return node;
+            }
+
+            BVHBuildNode *buildRecursive(Allocator alloc, span<BVHPrimitive> prims, const int depth) {
+                ASSERT(!prims.empty());
+                BVHBuildNode *node = alloc.new_object<BVHBuildNode>();
+                totalNodes.fetch_add(1, std::memory_order_relaxed);
+
+                const auto [bounds, centroidBounds] = reduceChunks<NodeBounds>(prims.size(),
+                    [&](const size_t b, const size_t e, NodeBounds &r) {
+                        for (size_t i = b; i < e; ++i) {
+                            r.bounds.merge(prims[i].bounds);
+                            r.centroidBounds.merge(prims[i].centroid);
+                        }
+                    });
+
+                if (prims.size() == 1) return makeLeaf(node, prims, bounds);
+
+                const int dim = centroidBounds.maxDim();
+                const float cMin = centroidBounds.pmin[dim], cMax = centroidBounds.pmax[dim];
+                size_t mid = prims.size() / 2;
+
+                if (cMax == cMin) {
+                    // Centroids coincide, so no plane separates them; split by count if the leaf would be too big
+                    if (prims.size() <= static_cast<size_t>(maxPrimsInNode)) return makeLeaf(node, prims, bounds);
+                } else if (prims.size() <= 2 || bounds.surfaceArea() == 0 || depth >= EQUAL_COUNTS_DEPTH) {
+                    // Too few primitives for buckets to help, no area for SAH to compare, or deep enough that
+                    // unbalanced SAH splits could overflow the traversal stack
+                    std::nth_element(prims.begin(), prims.begin() + mid, prims.end(),
+                                     [dim](const BVHPrimitive &a, const BVHPrimitive &b) {
+                                         return a.centroid[dim] < b.centroid[dim];
+                                     });
+                } else {
+                    auto bucketOf = [&](const BVHPrimitive &p) {
+                        const auto b = static_cast<int>(N_BUCKETS * ((p.centroid[dim] - cMin) / (cMax - cMin)));
+                        return b >= N_BUCKETS ? N_BUCKETS - 1 : b;
+                    };
+                    const Buckets buckets = reduceChunks<Buckets>(prims.size(),
+                        [&](const size_t b, const size_t e, Buckets &r) {
+                            for (size_t i = b; i < e; ++i) {
+                                Bucket &bucket = r.b[bucketOf(prims[i])];
+                                ++bucket.count;
+                                bucket.bounds.merge(prims[i].bounds);
+                            }
+                        });
+
+                    // Cost of splitting after each bucket, from a forward and a backward sweep
+                    constexpr int N_SPLITS = N_BUCKETS - 1;
+                    float costs[N_SPLITS] = {};
+                    uint32_t countBelow = 0;
+                    BBox3f boundBelow;
+                    for (int i = 0; i < N_SPLITS; ++i) {
+                        boundBelow.merge(buckets.b[i].bounds);
+                        countBelow += buckets.b[i].count;
+                        costs[i] = countBelow == 0 ? INFINITY_F : countBelow * boundBelow.surfaceArea();
+                    }
+                    uint32_t countAbove = 0;
+                    BBox3f boundAbove;
+                    for (int i = N_SPLITS; i >= 1; --i) {
+                        boundAbove.merge(buckets.b[i].bounds);
+                        countAbove += buckets.b[i].count;
+                        costs[i - 1] = countAbove == 0 ? INFINITY_F : costs[i - 1] + countAbove * boundAbove.surfaceArea();
+                    }
+
+                    int minBucket = 0;
+                    for (int i = 1; i < N_SPLITS; ++i) {
+                        if (costs[i] < costs[minBucket]) minBucket = i;
+                    }
+                    const float leafCost = static_cast<float>(prims.size());
+                    const float minCost = TRAVERSAL_COST + costs[minBucket] / bounds.surfaceArea();
+
+                    if (prims.size() > static_cast<size_t>(maxPrimsInNode) || minCost < leafCost) {
+                        mid = std::partition(prims.begin(), prims.end(),
+                                             [&](const BVHPrimitive &p) { return bucketOf(p) <= minBucket; }) -
+                              prims.begin();
+                    } else {
+                        return makeLeaf(node, prims, bounds);
+                    }
+                }
+
+                node->bounds = bounds;
+                node->splitAxis = dim;
+                const span<BVHPrimitive> left(prims.data(), mid), right(prims.data() + mid, prims.size() - mid);
+                if (prims.size() >= PARALLEL_BUILD_THRESHOLD) {
+                    // The other thread gets its own arena; this one keeps using alloc
+                    parallelInvoke([&] { node->children[0] = buildRecursive(alloc, left, depth + 1); },
+                                   [&] { node->children[1] = buildRecursive(newArena(), right, depth + 1); });
+                } else {
+                    node->children[0] = buildRecursive(alloc, left, depth + 1);
+                    node->children[1] = buildRecursive(alloc, right, depth + 1);
+                }
+                return node;
+            }
+
+            span<BVHPrimitive> primitives;
+            vector<uint32_t> &ordered;
+            const int maxPrimsInNode;
+            std::atomic<uint32_t> orderedOffset{0};
+            std::atomic<int> totalNodes{0};
+
+            std::mutex arenaMutex;
+            std::vector<std::unique_ptr<pmr::monotonic_buffer_resource>> arenas;
+        };
+
+        uint32_t flatten(const BVHBuildNode *node, vector<LinearBVHNode> &nodes, uint32_t &offset) {
+            const uint32_t nodeOffset = offset++;
+            LinearBVHNode &linear = nodes[nodeOffset];
+            linear.bounds = node->bounds;
+            if (node->nPrimitives > 0) {
+                ASSERT(node->nPrimitives <= BVH::MAX_PRIMS_IN_NODE);
+                linear.primitivesOffset = node->firstPrimOffset;
+                linear.nPrimitives = static_cast<uint16_t>(node->nPrimitives);
+            } else {
+                linear.axis = static_cast<uint8_t>(node->splitAxis);
+                linear.nPrimitives = 0;
+                flatten(node->children[0], nodes, offset);
+                linear.secondChildOffset = flatten(node->children[1], nodes, offset);
+            }
+            return nodeOffset;
+        }
+
+        /**
+         * Refits a flattened tree in place. A subtree is the contiguous range [n, end) of the depth-first node array,
+         * so independent subtrees are refit on separate threads.
+         *
+         * Rotations only relink nodes: each node keeps its slot while rotating, and the children of node i are held
+         * in links[i]. Kopta's swap is then O(1), and the array is laid out again once at the end if anything
+         * rotated. A rotation at node n cannot change n's ancestors, so until n is reached the links of n match its
+         * original children, and the descent can still follow the original offsets. Subtrees with no rotation in
+         * them are still contiguous, so the relayout skips those that stay in place and copies the rest as blocks.
+         */
+        class BVHRefitter {
+        public:
+            BVHRefitter(span<LinearBVHNode> nodes, span<const uint32_t> primitiveIndices,
+                        span<const BBox3f> primitiveBounds, const bool rotate)
+                : nodes(nodes), primitiveIndices(primitiveIndices), primitiveBounds(primitiveBounds), rotate(rotate) {
+                if (rotate) {
+                    links.resize(nodes.size());
+                    sizes.resize(nodes.size());
+                    heights.resize(nodes.size());
+                    relinked.resize(nodes.size());
+                }
+            }
+
+            void refit() {
+                const auto nNodes = static_cast<uint32_t>(nodes.size());
+                refit(0, nNodes, 0);
+                if (!rotated.load(std::memory_order_relaxed)) return;
+
+                // Through scratch, since a subtree's new range can overlap where another one is read from
+                scratch.resize(nNodes);
+                moved.resize(nNodes);
+                relayout(0, 0);
+                parallelFor(0, nNodes, REFIT_CHUNK_SIZE, [&](const size_t b, const size_t e) {
+                    for (size_t i = b; i < e; ++i) {
+                        if (moved[i]) nodes[i] = scratch[i];
+                    }
+                });
+            }
+
+        private:
+            struct Link {
+                uint32_t children[2];
+            };
+
+            void refit(const uint32_t n, const uint32_t end, const int depth) {
+                LinearBVHNode &node = nodes[n];
+                if (node.isLeaf()) {
+                    BBox3f bounds;
+                    for (uint32_t i = 0; i < node.nPrimitives; ++i) {
+                        bounds.merge(primitiveBounds[primitiveIndices[node.primitivesOffset + i]]);
+                    }
+                    node.bounds = bounds;
+                    if (rotate) {
+                        sizes[n] = 1;
+                        heights[n] = 0;
+                    }
+                    return;
+                }
+
+                const uint32_t second = node.secondChildOffset;
+                if (rotate) links[n] = {{n + 1, second}};
+                if (end - n >= PARALLEL_REFIT_THRESHOLD) {
+                    parallelInvoke([&] { refit(n + 1, second, depth + 1); },
+                                   [&] { refit(second, end, depth + 1); });
+                } else {
+                    refit(n + 1, second, depth + 1);
+                    refit(second, end, depth + 1);
+                }
+                if (rotate) {
+                    rotateChildren(n, depth);
+                } else {
+                    node.bounds = merge(nodes[n + 1].bounds, nodes[second].bounds);
+                }
+            }
+
+            /**
+             * Tries the four child/grandchild swaps at node n: either child of n trades places with either child of
+             * its sibling. The sibling's bounds become the merge of its remaining child and the swapped-in subtree,
+             * and n's own bounds do not change, so the swap that shrinks the sibling most lowers the SAH cost most.
+             * Swaps that would put a leaf deeper than BVH::MAX_DEPTH are skipped.
+             */
+            void rotateChildren(const uint32_t n, const int depth) {
+                const uint32_t left = links[n].children[0], right = links[n].children[1];
+
+                // Candidate: the sibling is reused as the interior node over a and b, next to c under n
+                uint32_t sibling = 0, a = 0, b = 0, c = 0;
+                float bestGain = 0;
+                auto consider = [&](const uint32_t old, const uint32_t na, const uint32_t nb, const uint32_t nc) {
+                    const int height = 1 + std::max<int>(heights[nc], 1 + std::max(heights[na], heights[nb]));
+                    if (depth + height > BVH::MAX_DEPTH) return;
+                    const float gain = nodes[old].bounds.surfaceArea() -
+                                       merge(nodes[na].bounds, nodes[nb].bounds).surfaceArea();
+                    if (gain > bestGain) {
+                        bestGain = gain;
+                        sibling = old;
+                        a = na;
+                        b = nb;
+                        c = nc;
+                    }
+                };
+                if (!nodes[right].isLeaf()) {
+                    const uint32_t rightLeft = links[right].children[0], rightRight = links[right].children[1];
+                    consider(right, left, rightRight, rightLeft);
+                    consider(right, rightLeft, left, rightRight);
+                }
+                if (!nodes[left].isLeaf()) {
+                    const uint32_t leftLeft = links[left].children[0], leftRight = links[left].children[1];
+                    consider(left, right, leftRight, leftLeft);
+                    consider(left, leftLeft, right, leftRight);
+                }
+
+                if (bestGain > 0) {
+                    setChildren(sibling, a, b);
+                    setChildren(n, c, sibling);
+                    rotated.store(true, std::memory_order_relaxed);
+                } else {
+                    nodes[n].bounds = merge(nodes[left].bounds, nodes[right].bounds);
+                    sizes[n] = 1 + sizes[left] + sizes[right];
+                    heights[n] = 1 + std::max(heights[left], heights[right]);
+                    relinked[n] = relinked[left] | relinked[right];
+                }
+            }
+
+            // Makes a and b the children of interior node i, ordered for front-to-back traversal
+            void setChildren(const uint32_t i, const uint32_t a, const uint32_t b) {
+                LinearBVHNode &node = nodes[i];
+                const bool swap = orderChildren(nodes[a].bounds, nodes[b].bounds, node.axis);
+                links[i] = swap ? Link{{b, a}} : Link{{a, b}};
+                node.bounds = merge(nodes[a].bounds, nodes[b].bounds);
+                sizes[i] = 1 + sizes[a] + sizes[b];
+                heights[i] = 1 + std::max(heights[a], heights[b]);
+                relinked[i] = 1;
+            }
+
+            // Writes the subtree linked from node i depth-first into scratch, starting at offset
+            void relayout(const uint32_t i, const uint32_t offset) {
+                if (!relinked[i]) {
+                    if (offset != i) shiftSubtree(i, offset);
+                    return;
+                }
+                LinearBVHNode &out = scratch[offset];
+                out = nodes[i];
+                moved[offset] = 1;
+                const uint32_t first = links[i].children[0], second = links[i].children[1];
+                out.secondChildOffset = offset + 1 + sizes[first];
+                if (sizes[i] >= PARALLEL_REFIT_THRESHOLD) {
+                    parallelInvoke([&] { relayout(first, offset + 1); },
+                                   [&] { relayout(second, out.secondChildOffset); });
+                } else {
+                    relayout(first, offset + 1);
+                    relayout(second, out.secondChildOffset);
+                }
+            }
+
+            // Copies an unrotated subtree, still contiguous from i, to offset
+            void shiftSubtree(const uint32_t i, const uint32_t offset) {
+                const uint32_t shift = offset - i;
+                parallelFor(0, sizes[i], REFIT_CHUNK_SIZE, [&](const size_t b, const size_t e) {
+                    for (size_t j = b; j < e; ++j) {
+                        LinearBVHNode &copy = scratch[offset + j];
+                        copy = nodes[i + j];
+                        if (!copy.isLeaf()) copy.secondChildOffset += shift;
+                        moved[offset + j] = 1;
+                    }
+                });
+            }
+
+            // Picks the axis separating the two centroids most; returns true if b should come first along it
+            static bool orderChildren(const BBox3f &a, const BBox3f &b, uint8_t &axis) {
+                float maxSeparation = -1, delta = 0;
+                for (int i = 0; i < 3; ++i) {
+                    const float d = (b.pmin[i] + b.pmax[i]) - (a.pmin[i] + a.pmax[i]);
+                    if (std::abs(d) > maxSeparation) {
+                        maxSeparation = std::abs(d);
+                        delta = d;
+                        axis = static_cast<uint8_t>(i);
+                    }
+                }
+                return delta < 0;
+            }
+
+            span<LinearBVHNode> nodes;
+            span<const uint32_t> primitiveIndices;
+            span<const BBox3f> primitiveBounds;
+            const bool rotate;
+
+            // Indexed by each node's slot in the original array; only used when rotating
+            std::vector<Link> links;
+            std::vector<uint32_t> sizes;
+            // Heights, and whether a rotation happened in each subtree
+            std::vector<uint8_t> heights, relinked;
+            // Written on relayout, and which of its slots differ from the tree before it
+            std::vector<LinearBVHNode> scratch;
+            std::vector<uint8_t> moved;
+            std::atomic<bool> rotated{false};
+        };
+    }
+
+    BVH::BVH(const span<const BBox3f> primitiveBounds, const int maxPrimsInNode, const BVHBuildMethod method,
+             const Allocator alloc) : nodes(alloc), primitiveIndices(alloc) {
+        ASSERT(maxPrimsInNode >= 1 && maxPrimsInNode <= MAX_PRIMS_IN_NODE);
+        ASSERT(primitiveBounds.size() < UINT32_MAX / 2);
+        if (primitiveBounds.empty()) return;
+
+        switch (method) {
+            case BVHBuildMethod::SAH: buildSAH(primitiveBounds, maxPrimsInNode); break;
+            case BVHBuildMethod::LBVH: buildLBVH(primitiveBounds, maxPrimsInNode, false); break;
+            case BVHBuildMethod::TreeletLBVH: buildLBVH(primitiveBounds, maxPrimsInNode, true); break;
+        }
+        builtCost = sahCost();
+    }
+
+    void BVH::refit(const span<const BBox3f> primitiveBounds, const bool rotate) {
+        ASSERT(primitiveBounds.size() == primitiveIndices.size());
+        if (nodes.empty()) return;
+        BVHRefitter({nodes.data(), nodes.size()}, getPrimitiveIndices(), primitiveBounds, rotate).refit();
+    }
+
+    float BVH::sahCost() const {
+        if (nodes.empty()) return 0;
+        const float rootArea = nodes[0].bounds.surfaceArea();
+        if (rootArea == 0) return 0;
+
+        double cost = 0;
+        for (const LinearBVHNode &node: nodes) {
+            const float nodeCost = node.isLeaf() ? static_cast<float>(node.nPrimitives) : TRAVERSAL_COST;
+            cost += nodeCost * node.bounds.surfaceArea();
+        }
+        return static_cast<float>(cost / rootArea);
+    }
+
+    void BVH::buildSAH(const span<const BBox3f> primitiveBounds, const int maxPrimsInNode) {
+        std::vector<BVHPrimitive> primitives(primitiveBounds.size());
+        parallelFor(0, primitives.size(), BIN_CHUNK_SIZE, [&](const size_t b, const size_t e) {
+            for (size_t i = b; i < e; ++i) {
+                const BBox3f &pb = primitiveBounds[i];
+                primitives[i] = {pb, (pb.pmin + pb.pmax) * 0.5f, static_cast<uint32_t>(i)};
+            }
+        });
+
+        primitiveIndices.resize(primitives.size());
+        BVHBuilder builder({primitives.data(), primitives.size()}, primitiveIndices, maxPrimsInNode);
+        const BVHBuildNode *root = builder.build();
+
+        nodes.resize(builder.nodeCount());
+        uint32_t offset = 0;
+        flatten(root, nodes, offset);
+        ASSERT(offset == nodes.size());
+    }
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <jtxlib.hpp>
+#include <jtxlib/math/bounds.hpp>
+#include <jtxlib/math/ray.hpp>
+#include <jtxlib/math/vec3.hpp>
+#include <jtxlib/std/memory_resource.hpp>
+#include <jtxlib/std/std.hpp>
+#include <jtxlib/util/assert.hpp>
+
+/**
+ * Bounding volume hierarchy over primitive bounds, following PBRT's BVHAggregate
+ * https://pbr-book.org/4ed/Primitives_and_Intersection_Acceleration/Bounding_Volume_Hierarchies
+ */
+namespace jtx {
+    // A node of the flattened tree, in depth-first order so an interior node's first child follows it
+    struct alignas(32) LinearBVHNode {
+        BBox3f bounds;
+        union {
+            uint32_t primitivesOffset;  // leaf: first entry in the BVH's primitive indices
+            uint32_t secondChildOffset; // interior
+        };
+        uint16_t nPrimitives = 0;       // 0 for interior nodes
+        uint8_t axis = 0;               // interior: split axis, for front-to-back traversal
+
+        [[nodiscard]] JTX_HOSTDEV bool isLeaf() const { return nPrimitives > 0; }
+    };
+    static_assert(sizeof(LinearBVHNode) == 32, "LinearBVHNode should fill half a cache line");
+
+    // Optional counters for comparing layouts; traversal adds to them when given a non-null pointer
+    struct BVHTraversalStats {
+        uint64_t nodesVisited = 0;     // nodes whose bounds were tested against the ray
+        uint64_t primitivesTested = 0; // primitives in the leaves the ray reached
+    };
+
+    enum class BVHBuildMethod {
+        SAH,         // binned SAH, best trees
+        LBVH,        // Morton-ordered linear BVH, fastest build, for per-frame rebuilds
+        TreeletLBVH, // LBVH followed by treelet restructuring, recovering most of the SAH quality
+    };
+
+    /**
+     * Binned SAH BVH over an array of primitive bounds.
+     *
+     * Each split bins centroids into 12 buckets along the largest axis of the centroid bounds and picks the cheapest
+     * bucket boundary by SAH. Subtrees with more than 128K primitives are built as parallel tasks, and nodes with more
+     * than 256K primitives also compute their bounds and bins in parallel, so large builds scale with cores.
+     * The result is a depth-first array of LinearBVHNode plus the primitive indices the leaves refer to.
+     *
+     * BVHBuildMethod::LBVH and TreeletLBVH instead sort primitives by the Morton code of their centroid and build
+     * the hierarchy from the sorted codes (see lbvh.cpp); they produce the same node layout.
+     *
+     * The BVH only knows primitive bounds; traversal calls back into the caller to intersect primitive i, where i is
+     * its position in the bounds passed to the constructor.
+     */
+    class BVH {
+    public:
+        static constexpr int MAX_PRIMS_IN_NODE = 255;
+        // Interior nodes on any root-to-leaf path, and so the size of the traversal stack. The SAH builder switches to
+        // equal-count splits deep in the tree, LBVH falls back to SAH for trees that would be deeper, and refit
+        // rotations never push a leaf past it.
+        static constexpr int MAX_DEPTH = 64;
+
+        JTX_HOST
+        explicit BVH(Allocator alloc = {}) : nodes(alloc), primitiveIndices(alloc) {}
+
+        JTX_HOST
+        BVH(span<const BBox3f> primitiveBounds, int maxPrimsInNode = 4, BVHBuildMethod method = BVHBuildMethod::SAH,
+            Allocator alloc = {});
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        BBox3f bounds() const { return nodes.empty() ? BBox3f() : nodes[0].bounds; }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        span<const LinearBVHNode> getNodes() const { return {nodes.data(), nodes.size()}; }
+
+        // Primitive indices in leaf order; leaf n covers [primitivesOffset, primitivesOffset + nPrimitives)
+        [[nodiscard]]
+        JTX_HOSTDEV
+        span<const uint32_t> getPrimitiveIndices() const { return {primitiveIndices.data(), primitiveIndices.size()}; }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        size_t memoryBytes() const {
+            return nodes.size() * sizeof(LinearBVHNode) + primitiveIndices.size() * sizeof(uint32_t);
+        }
+
+        /**
+         * Recomputes node bounds bottom-up from new primitive bounds, for geometry that moves without changing its
+         * topology, e.g. skinned characters. primitiveBounds must have the same size and order as at construction.
+         * Independent subtrees are refit in parallel.
+         *
+         * With rotate, each interior node also tries swapping one child with a grandchild when that shrinks the node
+         * in between, as in "Fast, Effective BVH Updates for Animated Scenes" (Kopta et al. 2012). Every rotation
+         * lowers the SAH cost, which slows the degradation over long animations. Leaves keep their primitives, so
+         * primitive indices stay valid either way.
+         */
+        JTX_HOST void refit(span<const BBox3f> primitiveBounds, bool rotate = false);
+
+        // SAH cost of the tree relative to intersecting one primitive, with areas normalized by the root's
+        [[nodiscard]] JTX_HOST float sahCost() const;
+
+        // sahCost() over its value when the tree was built; refit trees whose ratio has grown well past 1 are worth
+        // rebuilding
+        [[nodiscard]]
+        JTX_HOST
+        float sahCostRatio() const { return builtCost > 0 ? sahCost() / builtCost : 1.0f; }
+
+        /**
+         * Finds the closest hit along ray within [0, tMax].
+         *
+         * Calls f(primitiveIndex, tMax) for each primitive whose leaf the ray reaches. f returns true on a hit
+         * closer than tMax and lowers tMax to it, which then prunes the rest of the traversal.
+         * Children are visited near to far using the ray's direction sign on the node's split axis.
+         */
+        template<typename F>
+        JTX_HOSTDEV bool intersect(const Rayf &ray, float tMax, F &&f, BVHTraversalStats *stats = nullptr) const {
+            return traverse<false>(ray, tMax, f, stats);
+        }
+
+        // Any-hit query: returns as soon as f(primitiveIndex, tMax) reports a hit
+        template<typename F>
+        JTX_HOSTDEV bool intersectP(const Rayf &ray, float tMax, F &&f, BVHTraversalStats *stats = nullptr) const {
+            return traverse<true>(ray, tMax, f, stats);
+        }
+
+    private:
+        JTX_HOST void buildSAH(span<const BBox3f> primitiveBounds, int maxPrimsInNode);
+
+        // Defined in lbvh.cpp
+        JTX_HOST void buildLBVH(span<const BBox3f> primitiveBounds, int maxPrimsInNode, bool restructure);
+
+        template<bool AnyHit, typename F>
+        JTX_HOSTDEV bool traverse(const Rayf &ray, float tMax, F &f, BVHTraversalStats *stats) const {
+            if (nodes.empty()) return false;
+            const Vec3f invDir(1 / ray.dir.x, 1 / ray.dir.y, 1 / ray.dir.z);
+            const int dirIsNeg[3] = {int(invDir.x < 0), int(invDir.y < 0), int(invDir.z < 0)};
+
+            bool hit = false;
+            uint32_t toVisit[MAX_DEPTH];
+            int toVisitOffset = 0;
+            uint32_t current = 0;
+            while (true) {
+                const LinearBVHNode &node = nodes[current];
+                if (stats) ++stats->nodesVisited;
+                if (node.bounds.intersectP(ray.origin, tMax, invDir, dirIsNeg)) {
+                    if (node.isLeaf()) {
+                        if (stats) stats->primitivesTested += node.nPrimitives;
+                        for (uint32_t i = 0; i < node.nPrimitives; ++i) {
+                            if (f(primitiveIndices[node.primitivesOffset + i], tMax)) {
+                                if constexpr (AnyHit) return true;
+                                hit = true;
+                            }
+                        }
+                        if (toVisitOffset == 0) break;
+                        current = toVisit[--toVisitOffset];
+                    } else if (dirIsNeg[node.axis]) {
+                        ASSERT(toVisitOffset < MAX_DEPTH);
+                        // The second child is nearer
+                        toVisit[toVisitOffset++] = current + 1;
+                        current = node.secondChildOffset;
+                    } else {
+                        ASSERT(toVisitOffset < MAX_DEPTH);
+                        toVisit[toVisitOffset++] = node.secondChildOffset;
+                        current = current + 1;
+                    }
+                } else {
+                    if (toVisitOffset == 0) break;
+                    current = toVisit[--toVisitOffset];
+                }
+            }
+            return hit;
+        }
+
+        vector<LinearBVHNode> nodes;
+        vector<uint32_t> primitiveIndices;
+        float builtCost = 0;
+    };
+}
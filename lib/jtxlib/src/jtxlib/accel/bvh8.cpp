@@ -0,0 +1,87 @@
+#include "bvh8.hpp"
+
+namespace jtx {
+    namespace {
+        class BVH8Collapser {
+        public:
+            BVH8Collapser(span<const LinearBVHNode> binary, vector<BVH8Node> &nodes) : binary(binary), nodes(nodes) {}
+
+            // Emits the wide node for binary node n, then its interior children depth-first; returns its index
+            uint32_t collapse(const uint32_t n) {
+                // Gather up to 8 children by opening the largest interior child until none is left or the node is full
+                uint32_t slots[BVH8Node::WIDTH];
+                int count = 0;
+                if (binary[n].isLeaf()) {
+                    slots[count++] = n;
+                } else {
+                    slots[count++] = n + 1;
+                    slots[count++] = binary[n].secondChildOffset;
+                }
+                while (count < BVH8Node::WIDTH) {
+                    int open = -1;
+                    float maxArea = -1;
+                    for (int i = 0; i < count; ++i) {
+                        const LinearBVHNode &c = binary[slots[i]];
+                        if (!c.isLeaf() && c.bounds.surfaceArea() > maxArea) {
+                            maxArea = c.bounds.surfaceArea();
+                            open = i;
+                        }
+                    }
+                    if (open < 0) break;
+                    const uint32_t opened = slots[open];
+                    slots[open] = opened + 1;
+                    slots[count++] = binary[opened].secondChildOffset;
+                }
+
+                const auto index = static_cast<uint32_t>(nodes.size());
+                nodes.emplace_back();
+                // Recursing below can reallocate, so the node is only accessed by index
+                for (int i = 0; i < BVH8Node::WIDTH; ++i) {
+                    BVH8Node &node = nodes[index];
+                    if (i >= count) {
+                        // Inverted bounds: every slab test misses
+                        for (int a = 0; a < 3; ++a) {
+                            node.lo[a][i] = INFINITY_F;
+                            node.hi[a][i] = -INFINITY_F;
+                        }
+                        node.child[i] = 0;
+                        node.nPrimitives[i] = 0;
+                        continue;
+                    }
+
+                    const LinearBVHNode &c = binary[slots[i]];
+                    for (int a = 0; a < 3; ++a) {
+                        node.lo[a][i] = c.bounds.pmin[a];
+                        node.hi[a][i] = c.bounds.pmax[a];
+                    }
+                    node.nPrimitives[i] = static_cast<uint8_t>(c.nPrimitives);
+                    if (c.isLeaf()) {
+                        node.child[i] = c.primitivesOffset;
+                    } else {
+                        const uint32_t childIndex = collapse(slots[i]);
+                        nodes[index].child[i] = childIndex;
+                    }
+                }
+                nodes[index].nChildren = static_cast<uint8_t>(count);
+                return index;
+            }
+
+        private:
+            span<const LinearBVHNode> binary;
+            vector<BVH8Node> &nodes;
+        };
+    }
+
+    BVH8::BVH8(const BVH &bvh, const Allocator alloc) : nodes(alloc), primitiveIndices(alloc) {
+        const span<const LinearBVHNode> binary = bvh.getNodes();
+        if (binary.empty()) return;
+
+        const span<const uint32_t> indices = bvh.getPrimitiveIndices();
+        primitiveIndices.resize(indices.size());
+        std::copy(indices.begin(), indices.end(), primitiveIndices.begin());
+
+        // Each wide node replaces at least one binary interior node, and usually about seven
+        nodes.reserve(binary.size() / 7 + 1);
+        BVH8Collapser(binary, nodes).collapse(0);
+    }
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <jtxlib.hpp>
+#include <jtxlib/accel/bvh.hpp>
+#include <jtxlib/math/bounds.hpp>
+#include <jtxlib/math/numerical.hpp>
+#include <jtxlib/math/ray.hpp>
+#include <jtxlib/std/memory_resource.hpp>
+#include <jtxlib/std/std.hpp>
+#include <jtxlib/util/assert.hpp>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/**
+ * 8-wide BVH collapsed from a binary BVH, so one AVX slab test covers all children of a node.
+ * See "Efficient Incoherent Ray Traversal on GPUs Through Compressed Wide BVHs" (Ylitie et al. 2017) for the
+ * collapse, and Embree's BVH8 for the SoA node layout.
+ */
+namespace jtx {
+    /**
+     * A wide node with up to 8 children. Child bounds are stored SoA, lo[axis][child] and hi[axis][child], so each
+     * slab is one 256-bit load. Unused slots have empty (inverted) bounds and never hit.
+     */
+    struct alignas(64) BVH8Node {
+        static constexpr int WIDTH = 8;
+
+        float lo[3][WIDTH];
+        float hi[3][WIDTH];
+        uint32_t child[WIDTH];       // interior child: node index; leaf child: first entry in the primitive indices
+        uint8_t nPrimitives[WIDTH];  // 0 for interior children and unused slots
+        uint8_t nChildren = 0;
+
+        [[nodiscard]] JTX_HOSTDEV bool isLeaf(const int i) const { return nPrimitives[i] > 0; }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        BBox3f childBounds(const int i) const {
+            return {Point3f{lo[0][i], lo[1][i], lo[2][i]}, Point3f{hi[0][i], hi[1][i], hi[2][i]}};
+        }
+    };
+    static_assert(sizeof(BVH8Node) == 256, "BVH8Node should span exactly four cache lines");
+
+    namespace detail {
+        // For each 8-bit hit mask, the indices of its set bits packed as 4-bit nibbles, lowest first
+        constexpr std::array<uint32_t, 256> COMPRESS_LUT = [] {
+            std::array<uint32_t, 256> lut{};
+            for (uint32_t m = 0; m < 256; ++m) {
+                int n = 0;
+                for (uint32_t i = 0; i < 8; ++i) {
+                    if (m & (1u << i)) lut[m] |= i << (4 * n++);
+                }
+            }
+            return lut;
+        }();
+    }
+
+    /**
+     * 8-wide BVH built by collapsing a binary BVH: each wide node starts from a binary node's two children and
+     * repeatedly opens the interior child with the largest surface area until it has 8 children or only leaves.
+     * Leaves are shared with the binary tree, so primitive callbacks get the same indices.
+     *
+     * Traversal tests all 8 children at once, compresses the hit lanes to the front using the hit mask, and pushes
+     * them far to near so the nearest child is visited next. Stack entries carry their entry distance, so closest
+     * hit skips subtrees that are already farther than the current hit.
+     */
+    class BVH8 {
+    public:
+        JTX_HOST
+        explicit BVH8(Allocator alloc = {}) : nodes(alloc), primitiveIndices(alloc) {}
+
+        JTX_HOST
+        explicit BVH8(const BVH &bvh, Allocator alloc = {});
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        BBox3f bounds() const {
+            BBox3f b;
+            if (!nodes.empty()) {
+                for (int i = 0; i < nodes[0].nChildren; ++i) b.merge(nodes[0].childBounds(i));
+            }
+            return b;
+        }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        span<const BVH8Node> getNodes() const { return {nodes.data(), nodes.size()}; }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        span<const uint32_t> getPrimitiveIndices() const { return {primitiveIndices.data(), primitiveIndices.size()}; }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        size_t memoryBytes() const {
+            return nodes.size() * sizeof(BVH8Node) + primitiveIndices.size() * sizeof(uint32_t);
+        }
+
+        // Same contract as BVH::intersect
+        template<typename F>
+        JTX_HOSTDEV bool intersect(const Rayf &ray, float tMax, F &&f, BVHTraversalStats *stats = nullptr) const {
+            return traverse<false>(ray, tMax, f, stats);
+        }
+
+        // Same contract as BVH::intersectP
+        template<typename F>
+        JTX_HOSTDEV bool intersectP(const Rayf &ray, float tMax, F &&f, BVHTraversalStats *stats = nullptr) const {
+            return traverse<true>(ray, tMax, f, stats);
+        }
+
+    private:
+        // The wide tree is at most as deep as the binary one, and each level leaves at most 7 entries behind
+        static constexpr int STACK_SIZE = 1 + (BVH8Node::WIDTH - 1) * BVH::MAX_DEPTH;
+
+        struct StackEntry {
+            uint32_t ref;         // node index, or first primitive index for a leaf
+            uint32_t nPrimitives; // 0 for a node
+            float tNear;
+        };
+
+        template<bool AnyHit, typename F>
+        JTX_HOSTDEV bool traverse(const Rayf &ray, float tMax, F &f, BVHTraversalStats *stats) const {
+            if (nodes.empty()) return false;
+            const Vec3f invDir(1 / ray.dir.x, 1 / ray.dir.y, 1 / ray.dir.z);
+            const int dirIsNeg[3] = {int(invDir.x < 0), int(invDir.y < 0), int(invDir.z < 0)};
+            // Same conservative far bound as AABB3::intersectP
+            constexpr float FAR_SCALE = 1 + 2 * gamma(3);
+
+#ifdef __AVX2__
+            const __m256 o[3] = {_mm256_set1_ps(ray.origin.x), _mm256_set1_ps(ray.origin.y),
+                                 _mm256_set1_ps(ray.origin.z)};
+            const __m256 inv[3] = {_mm256_set1_ps(invDir.x), _mm256_set1_ps(invDir.y), _mm256_set1_ps(invDir.z)};
+            const __m256 farScale = _mm256_set1_ps(FAR_SCALE);
+#endif
+
+            bool hit = false;
+            StackEntry stack[STACK_SIZE];
+            int sp = 0;
+            stack[sp++] = {0, 0, 0.0f};
+            while (sp > 0) {
+                const StackEntry entry = stack[--sp];
+                if (entry.tNear > tMax) continue;
+
+                if (entry.nPrimitives > 0) {
+                    if (stats) stats->primitivesTested += entry.nPrimitives;
+                    for (uint32_t i = 0; i < entry.nPrimitives; ++i) {
+                        if (f(primitiveIndices[entry.ref + i], tMax)) {
+                            if constexpr (AnyHit) return true;
+                            hit = true;
+                        }
+                    }
+                    continue;
+                }
+
+                const BVH8Node &node = nodes[entry.ref];
+                if (stats) ++stats->nodesVisited;
+
+                // Slab test of all children; NaNs from 0 * inf leave the running interval unchanged, as in
+                // AABB3::intersectP, because max/min return their second operand when either is NaN
+                alignas(32) float tNear[BVH8Node::WIDTH];
+                uint32_t mask = 0;
+#ifdef __AVX2__
+                __m256 t0 = _mm256_setzero_ps(), t1 = _mm256_set1_ps(tMax);
+                for (int a = 0; a < 3; ++a) {
+                    const __m256 nearPlane = _mm256_load_ps(dirIsNeg[a] ? node.hi[a] : node.lo[a]);
+                    const __m256 farPlane = _mm256_load_ps(dirIsNeg[a] ? node.lo[a] : node.hi[a]);
+                    const __m256 tn = _mm256_mul_ps(_mm256_sub_ps(nearPlane, o[a]), inv[a]);
+                    const __m256 tf = _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(farPlane, o[a]), inv[a]), farScale);
+                    t0 = _mm256_max_ps(tn, t0);
+                    t1 = _mm256_min_ps(tf, t1);
+                }
+                mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ)));
+                if (mask == 0) continue;
+
+                // Compress-store the entry distances of the hit lanes to the front
+                const uint32_t packed = detail::COMPRESS_LUT[mask];
+                const __m256i lanes = _mm256_and_si256(
+                        _mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(packed)),
+                                          _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28)),
+                        _mm256_set1_epi32(0xF));
+                _mm256_store_ps(tNear, _mm256_permutevar8x32_ps(t0, lanes));
+#else
+                for (int i = 0; i < BVH8Node::WIDTH; ++i) {
+                    float t0 = 0, t1 = tMax;
+                    for (int a = 0; a < 3; ++a) {
+                        const float nearPlane = dirIsNeg[a] ? node.hi[a][i] : node.lo[a][i];
+                        const float farPlane = dirIsNeg[a] ? node.lo[a][i] : node.hi[a][i];
+                        const float tn = (nearPlane - ray.origin[a]) * invDir[a];
+                        const float tf = (farPlane - ray.origin[a]) * invDir[a] * FAR_SCALE;
+                        t0 = tn > t0 ? tn : t0;
+                        t1 = tf < t1 ? tf : t1;
+                    }
+                    if (t0 <= t1) {
+                        tNear[std::popcount(mask)] = t0;
+                        mask |= 1u << i;
+                    }
+                }
+                if (mask == 0) continue;
+                const uint32_t packed = detail::COMPRESS_LUT[mask];
+#endif
+
+                // Sort the hits far to near (insertion sort; usually only a few lanes hit), then push in that order
+                // so the nearest child is popped first
+                const int nHits = std::popcount(mask);
+                uint32_t order[BVH8Node::WIDTH];
+                for (int k = 0; k < nHits; ++k) {
+                    const uint32_t lane = (packed >> (4 * k)) & 0xF;
+                    const float t = tNear[k];
+                    int j = k;
+                    for (; j > 0 && tNear[j - 1] < t; --j) {
+                        tNear[j] = tNear[j - 1];
+                        order[j] = order[j - 1];
+                    }
+                    tNear[j] = t;
+                    order[j] = lane;
+                }
+
+                ASSERT(sp + nHits <= STACK_SIZE);
+                for (int k = 0; k < nHits; ++k) {
+                    const uint32_t lane = order[k];
+                    stack[sp++] = {node.child[lane], node.nPrimitives[lane], tNear[k]};
+                }
+            }
+            return hit;
+        }
+
+        vector<BVH8Node> nodes;
+        vector<uint32_t> primitiveIndices;
+    };
+}
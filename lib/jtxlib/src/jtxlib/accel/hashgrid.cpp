@@ -0,0 +1,90 @@
+#include "hashgrid.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace jtx {
+    namespace {
+        constexpr size_t CHUNK_SIZE = 16 * 1024;
+        constexpr size_t MIN_SLOTS = 16;
+    }
+
+    void HashGrid::build(span<const Point3f> input) {
+        ASSERT(input.size() < UINT32_MAX);
+        const size_t n = input.size();
+        points.resize(n);
+        pointIndices.resize(n);
+        pointSlots.resize(n);
+        pointRanks.resize(n);
+        if (n == 0) {
+            cells.clear();
+            return;
+        }
+
+        // At most n cells are occupied, so the table stays at most half full
+        const size_t nSlots = std::bit_ceil(std::max(2 * n, MIN_SLOTS));
+        const size_t slotMask = nSlots - 1;
+        if (slotKeys.size() != nSlots) {
+            slotKeys = std::vector<std::atomic<uint64_t>>(nSlots);
+            slotCounts = std::vector<std::atomic<uint32_t>>(nSlots);
+        } else {
+            parallelFor(0, nSlots, CHUNK_SIZE, [&](const size_t b, const size_t e) {
+                for (size_t s = b; s < e; ++s) {
+                    slotKeys[s].store(0, std::memory_order_relaxed);
+                    slotCounts[s].store(0, std::memory_order_relaxed);
+                }
+            });
+        }
+        cells.resize(nSlots);
+
+        // Each point claims its cell's slot, inserting the key if no other point has, and takes a rank within it
+        parallelFor(0, n, CHUNK_SIZE, [&](const size_t b, const size_t e) {
+            for (size_t i = b; i < e; ++i) {
+                const uint64_t key = cellKey(input[i], 0, 0, 0);
+                size_t s = slotOf(key);
+                while (true) {
+                    uint64_t current = slotKeys[s].load(std::memory_order_relaxed);
+                    if (current == 0 &&
+                        slotKeys[s].compare_exchange_strong(current, key, std::memory_order_relaxed)) break;
+                    // Either occupied already or another thread won the slot; current holds its key
+                    if (current == key) break;
+                    s = (s + 1) & slotMask;
+                }
+                pointSlots[i] = static_cast<uint32_t>(s);
+                pointRanks[i] = slotCounts[s].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        // Exclusive scan of the counts in slot order: per-chunk sums, a scan over chunks, then each chunk's cells
+        std::vector<uint32_t> chunkStarts((nSlots + CHUNK_SIZE - 1) / CHUNK_SIZE);
+        parallelFor(0, nSlots, CHUNK_SIZE, [&](const size_t b, const size_t e) {
+            uint32_t sum = 0;
+            for (size_t s = b; s < e; ++s) sum += slotCounts[s].load(std::memory_order_relaxed);
+            chunkStarts[b / CHUNK_SIZE] = sum;
+        });
+        uint32_t total = 0;
+        for (uint32_t &start : chunkStarts) {
+            const uint32_t sum = start;
+            start = total;
+            total += sum;
+        }
+        ASSERT(total == n);
+        parallelFor(0, nSlots, CHUNK_SIZE, [&](const size_t b, const size_t e) {
+            uint32_t start = chunkStarts[b / CHUNK_SIZE];
+            for (size_t s = b; s < e; ++s) {
+                const uint32_t count = slotCounts[s].load(std::memory_order_relaxed);
+                cells[s] = {slotKeys[s].load(std::memory_order_relaxed), start, count};
+                start += count;
+            }
+        });
+
+        // Scatter; ranks are unique within a cell, so every point lands in its own place
+        parallelFor(0, n, CHUNK_SIZE, [&](const size_t b, const size_t e) {
+            for (size_t i = b; i < e; ++i) {
+                const uint32_t dst = cells[pointSlots[i]].start + pointRanks[i];
+                points[dst] = input[i];
+                pointIndices[dst] = static_cast<uint32_t>(i);
+            }
+        });
+    }
+}
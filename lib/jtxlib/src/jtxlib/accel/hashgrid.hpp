@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <jtxlib.hpp>
+#include <jtxlib/math/vec3.hpp>
+#include <jtxlib/math/vecmath.hpp>
+#include <jtxlib/std/memory_resource.hpp>
+#include <jtxlib/std/std.hpp>
+#include <jtxlib/util/assert.hpp>
+#include <jtxlib/util/hash.hpp>
+#include <jtxlib/util/parallel.hpp>
+
+/**
+ * Hashed uniform grid for fixed-radius neighbor queries, the structure "Progressive Photon Mapping" (Hachisuka et al.
+ * 2008) and SPH particle solvers rebuild every iteration. With cells as wide as the query radius, every neighbor of a
+ * point lies in the 3x3x3 block of cells around it, so a query is 27 hash lookups and a scan of what they hold.
+ */
+namespace jtx {
+    // A slot of the hash table: a cell's key and the range of the grid's points that fall in it
+    struct HashGridCell {
+        uint64_t key = 0; // 0 marks an empty slot
+        uint32_t start = 0;
+        uint32_t count = 0;
+    };
+
+    /**
+     * Uniform grid over points with cell size equal to the query radius, stored sparsely in a flat open-addressing
+     * (linear probing) table with at least twice as many slots as points, so probes stay short.
+     *
+     * build() is O(n) and parallel throughout: points claim their cell's slot with a compare-and-swap and take a rank
+     * in it with an atomic increment, a parallel scan over the slot counts gives each cell its start, and points are
+     * scattered to start + rank. This is a counting sort by cell, so each cell's points are contiguous. The order
+     * within a cell depends on thread timing. The table, the sorted points and the build scratch are kept between
+     * builds, so rebuilding every iteration over a similar number of points reuses them.
+     *
+     * Cell coordinates are packed 21 bits per axis, so the points and queries should stay within 2^21 cells of the
+     * origin along each axis.
+     */
+    class HashGrid {
+    public:
+        JTX_HOST
+        explicit HashGrid(const float radius, Allocator alloc = {})
+            : radius(radius), invCellSize(1 / radius), cells(alloc), points(alloc), pointIndices(alloc),
+              pointSlots(alloc), pointRanks(alloc) {
+            ASSERT(radius > 0);
+        }
+
+        JTX_HOST
+        HashGrid(span<const Point3f> points, const float radius, Allocator alloc = {}) : HashGrid(radius, alloc) {
+            build(points);
+        }
+
+        // Replaces the grid's contents with points; indices reported by queries are positions in this span
+        JTX_HOST void build(span<const Point3f> points);
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        float getRadius() const { return radius; }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        size_t size() const { return points.size(); }
+
+        // The table, with empty slots; a cell's points are getPoints()[start, start + count)
+        [[nodiscard]]
+        JTX_HOSTDEV
+        span<const HashGridCell> getCells() const { return {cells.data(), cells.size()}; }
+
+        // Points grouped by cell, and the index of each in the span passed to build()
+        [[nodiscard]]
+        JTX_HOSTDEV
+        span<const Point3f> getPoints() const { return {points.data(), points.size()}; }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        span<const uint32_t> getPointIndices() const { return {pointIndices.data(), pointIndices.size()}; }
+
+        // The table and the sorted points; build scratch is not counted
+        [[nodiscard]]
+        JTX_HOSTDEV
+        size_t memoryBytes() const {
+            return cells.size() * sizeof(HashGridCell) + points.size() * (sizeof(Point3f) + sizeof(uint32_t));
+        }
+
+        // The cell containing p, or nullptr when no point fell in it
+        [[nodiscard]]
+        JTX_HOSTDEV
+        const HashGridCell *findCell(const Point3f &p) const { return find(cellKey(p, 0, 0, 0)); }
+
+        // Calls f(pointIndex, distanceSqr) for every point within the grid's radius of p, in no particular order
+        template<typename F>
+        JTX_HOST void radiusSearch(const Point3f &p, F &&f) const {
+            const float radiusSqr = radius * radius;
+            for (int dz = -1; dz <= 1; ++dz) {
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        const HashGridCell *cell = find(cellKey(p, dx, dy, dz));
+                        if (!cell) continue;
+                        for (uint32_t i = cell->start; i < cell->start + cell->count; ++i) {
+                            const float d2 = distanceSqr(points[i], p);
+                            if (d2 <= radiusSqr) f(pointIndices[i], d2);
+                        }
+                    }
+                }
+            }
+        }
+
+        /**
+         * Batch radius query, parallel over queries: calls f(queryIndex, pointIndex, distanceSqr) for every point
+         * within the grid's radius of each query. Calls for different queries may come from different threads at once.
+         */
+        template<typename F>
+        JTX_HOST void radiusSearch(span<const Point3f> queries, F &&f) const {
+            parallelFor(0, queries.size(), QUERY_CHUNK_SIZE, [&](const size_t b, const size_t e) {
+                for (size_t q = b; q < e; ++q) {
+                    radiusSearch(queries[q], [&](const uint32_t index, const float d2) { f(q, index, d2); });
+                }
+            });
+        }
+
+    private:
+        static constexpr size_t QUERY_CHUNK_SIZE = 256;
+        static constexpr int COORD_BITS = 21;
+        static constexpr int64_t COORD_BIAS = int64_t(1) << (COORD_BITS - 1);
+        static constexpr uint64_t COORD_MASK = (uint64_t(1) << COORD_BITS) - 1;
+
+        // Key of the cell (dx, dy, dz) away from the one containing p; biased so no cell's key is 0
+        [[nodiscard]]
+        JTX_HOSTDEV
+        uint64_t cellKey(const Point3f &p, const int dx, const int dy, const int dz) const {
+            auto coord = [&](const float f, const int d) {
+                const auto c = static_cast<int64_t>(std::floor(f * invCellSize)) + d + COORD_BIAS;
+                ASSERT(c >= 0 && uint64_t(c) <= COORD_MASK);
+                return uint64_t(c) & COORD_MASK;
+            };
+            return (coord(p.x, dx) | coord(p.y, dy) << COORD_BITS | coord(p.z, dz) << (2 * COORD_BITS)) + 1;
+        }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        size_t slotOf(const uint64_t key) const { return mixBits(key) & (cells.size() - 1); }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        const HashGridCell *find(const uint64_t key) const {
+            if (cells.empty()) return nullptr;
+            for (size_t i = slotOf(key);; i = (i + 1) & (cells.size() - 1)) {
+                const HashGridCell &cell = cells[i];
+                if (cell.key == key) return &cell;
+                if (cell.key == 0) return nullptr;
+            }
+        }
+
+        float radius, invCellSize;
+        vector<HashGridCell> cells;
+        vector<Point3f> points;
+        vector<uint32_t> pointIndices;
+
+        // Build scratch, kept so rebuilds reuse it
+        std::vector<std::atomic<uint64_t>> slotKeys;
+        std::vector<std::atomic<uint32_t>> slotCounts;
+        vector<uint32_t> pointSlots, pointRanks;
+    };
+}
@@ -0,0 +1,79 @@
+#include "kdtree.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace jtx {
+    namespace {
+        // Subtrees with at least this many points are built on another thread
+        constexpr size_t PARALLEL_BUILD_THRESHOLD = 64 * 1024;
+        constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+        // Points in the left subtree of a left-balanced tree of n > 0 points: its share of the complete levels, then
+        // the partial last level, which fills the left subtree first
+        size_t leftSubtreeSize(const size_t n) {
+            size_t width = 1; // ends as the width of the last level, with width - 1 points above it
+            while (2 * width - 1 <= n) width *= 2;
+            const size_t half = width / 2;
+            return (half - 1) + std::min(n - (width - 1), half);
+        }
+
+        class KdTreeBuilder {
+        public:
+            KdTreeBuilder(span<const Point3f> points, vector<KdTreeNode> &nodes) : points(points), nodes(nodes) {}
+
+            // Places the points indices[begin, end) in the subtree rooted at node
+            void build(uint32_t *indices, const size_t begin, const size_t end, const size_t node) {
+                const size_t n = end - begin;
+                if (n == 0) return;
+                ASSERT(node < nodes.size());
+
+                BBox3f bounds;
+                for (size_t i = begin; i < end; ++i) bounds.merge(points[indices[i]]);
+                const int axis = bounds.maxDim();
+                const size_t median = begin + leftSubtreeSize(n);
+                std::nth_element(indices + begin, indices + median, indices + end,
+                                 [&](const uint32_t a, const uint32_t b) { return points[a][axis] < points[b][axis]; });
+                nodes[node] = {points[indices[median]], indices[median] << 2 | uint32_t(axis)};
+
+                auto left = [&] { build(indices, begin, median, 2 * node + 1); };
+                auto right = [&] { build(indices, median + 1, end, 2 * node + 2); };
+                if (n >= PARALLEL_BUILD_THRESHOLD) {
+                    parallelInvoke(left, right);
+                } else {
+                    left();
+                    right();
+                }
+            }
+
+        private:
+            span<const Point3f> points;
+            vector<KdTreeNode> &nodes;
+        };
+    }
+
+    KdTree::KdTree(span<const Point3f> points, Allocator alloc) : nodes(alloc) {
+        ASSERT(points.size() < (size_t(1) << 30));
+        if (points.empty()) return;
+
+        std::vector<uint32_t> indices(points.size());
+        std::iota(indices.begin(), indices.end(), 0u);
+        nodes.resize(points.size());
+        KdTreeBuilder(points, nodes).build(indices.data(), 0, indices.size(), 0);
+        for (const Point3f &p : points) rootBounds.merge(p);
+    }
+
+    void KdTree::knn(span<const Point3f> queries, const int k, span<KdTreeNeighbor> neighbors, span<uint32_t> counts,
+                     const float maxDistanceSqr) const {
+        ASSERT(k >= 0);
+        ASSERT(neighbors.size() == queries.size() * size_t(k));
+        ASSERT(counts.size() == queries.size());
+        parallelFor(0, queries.size(), QUERY_CHUNK_SIZE, [&](const size_t b, const size_t e) {
+            for (size_t q = b; q < e; ++q) {
+                const span<KdTreeNeighbor> out(neighbors.data() + q * k, k);
+                counts[q] = static_cast<uint32_t>(knn(queries[q], out, maxDistanceSqr));
+            }
+        });
+    }
+}
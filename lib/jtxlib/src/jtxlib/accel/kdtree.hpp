@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <jtxlib.hpp>
+#include <jtxlib/math/bounds.hpp>
+#include <jtxlib/math/vec3.hpp>
+#include <jtxlib/math/vecmath.hpp>
+#include <jtxlib/std/memory_resource.hpp>
+#include <jtxlib/std/std.hpp>
+#include <jtxlib/util/assert.hpp>
+#include <jtxlib/util/parallel.hpp>
+
+/**
+ * k-d tree over points for nearest-neighbor queries, as used by photon mapping and density estimation. The layout is
+ * the left-balanced tree of Jensen's "Realistic Image Synthesis Using Photon Mapping" (2001): nodes live in one array in
+ * heap order, so the children of node i are 2i + 1 and 2i + 2 and the tree stores no pointers at all.
+ */
+namespace jtx {
+    // A point and its split axis; the point's index in the constructor's input and the axis share one word
+    struct alignas(16) KdTreeNode {
+        Point3f p;
+        uint32_t indexAndAxis;
+
+        [[nodiscard]] JTX_HOSTDEV uint32_t index() const { return indexAndAxis >> 2; }
+        [[nodiscard]] JTX_HOSTDEV int axis() const { return int(indexAndAxis & 3); }
+    };
+    static_assert(sizeof(KdTreeNode) == 16, "Four KdTreeNodes should share a cache line");
+
+    struct KdTreeNeighbor {
+        uint32_t index;    // in the points passed to the KdTree constructor
+        float distanceSqr;
+    };
+
+    /**
+     * Max-heap holding the k closest candidates seen so far, in caller-provided storage so queries never allocate.
+     * Once full, a candidate only gets in by replacing the farthest one, and that farthest distance is the search
+     * radius for the rest of the query.
+     */
+    class NeighborHeap {
+    public:
+        JTX_HOSTDEV
+        explicit NeighborHeap(span<KdTreeNeighbor> storage) : storage(storage) {}
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        size_t size() const { return count; }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        bool full() const { return count == storage.size(); }
+
+        // Squared distance of the farthest neighbor kept; only meaningful once the heap is non-empty
+        [[nodiscard]]
+        JTX_HOSTDEV
+        float maxDistanceSqr() const { return storage[0].distanceSqr; }
+
+        JTX_HOSTDEV void push(const uint32_t index, const float distanceSqr) {
+            if (!full()) {
+                storage[count++] = {index, distanceSqr};
+                std::push_heap(storage.begin(), storage.begin() + count, nearer);
+            } else if (distanceSqr < maxDistanceSqr()) {
+                std::pop_heap(storage.begin(), storage.begin() + count, nearer);
+                storage[count - 1] = {index, distanceSqr};
+                std::push_heap(storage.begin(), storage.begin() + count, nearer);
+            }
+        }
+
+        // Sorts the kept neighbors nearest first; the heap is no longer usable afterwards
+        JTX_HOSTDEV void sort() { std::sort_heap(storage.begin(), storage.begin() + count, nearer); }
+
+    private:
+        static bool nearer(const KdTreeNeighbor &a, const KdTreeNeighbor &b) { return a.distanceSqr < b.distanceSqr; }
+
+        span<KdTreeNeighbor> storage;
+        size_t count = 0;
+    };
+
+    /**
+     * Left-balanced k-d tree over a point set.
+     *
+     * Each node splits its points at the median along the largest axis of their bounds, with the median chosen so the
+     * tree is complete except for the right end of its last level. The tree is exactly n nodes of 16 bytes, and
+     * subtrees larger than 64K points are built in parallel.
+     *
+     * Queries walk the tree near child first and carry each subtree's bounds, clipped from the root bounds at every
+     * split. A subtree is skipped when distanceSqr from the query to its bounds exceeds the current search radius,
+     * which for k-nearest queries shrinks to the k-th nearest distance found so far. The traversal stack is a fixed
+     * array, so queries neither allocate nor lock and any number may run at once.
+     */
+    class KdTree {
+    public:
+        JTX_HOST
+        explicit KdTree(Allocator alloc = {}) : nodes(alloc) {}
+
+        JTX_HOST
+        explicit KdTree(span<const Point3f> points, Allocator alloc = {});
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        size_t size() const { return nodes.size(); }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        BBox3f bounds() const { return rootBounds; }
+
+        // Nodes in heap order: the children of node i are 2i + 1 and 2i + 2 where those are below size()
+        [[nodiscard]]
+        JTX_HOSTDEV
+        span<const KdTreeNode> getNodes() const { return {nodes.data(), nodes.size()}; }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        size_t memoryBytes() const { return nodes.size() * sizeof(KdTreeNode); }
+
+        /**
+         * Finds the neighbors.size() points nearest p within maxDistanceSqr and writes them to neighbors nearest
+         * first. Returns how many were found, fewer than requested when the tree is small or the radius tight.
+         */
+        JTX_HOST size_t knn(const Point3f &p, span<KdTreeNeighbor> neighbors,
+                            float maxDistanceSqr = INFINITY_F) const {
+            if (neighbors.empty()) return 0;
+            NeighborHeap heap(neighbors);
+            search(p, maxDistanceSqr, [&](const uint32_t index, const float d2, float &radiusSqr) {
+                heap.push(index, d2);
+                if (heap.full()) radiusSqr = heap.maxDistanceSqr();
+            });
+            heap.sort();
+            return heap.size();
+        }
+
+        // Calls f(pointIndex, distanceSqr) for every point within radius of p, in no particular order
+        template<typename F>
+        JTX_HOST void radiusSearch(const Point3f &p, const float radius, F &&f) const {
+            float radiusSqr = radius * radius;
+            search(p, radiusSqr, [&](const uint32_t index, const float d2, float &) { f(index, d2); });
+        }
+
+        /**
+         * Batch k-nearest query, parallel over queries. Query q gets neighbors [q k, q k + counts[q]), nearest first,
+         * of the neighbors span, which holds queries.size() * k entries.
+         */
+        JTX_HOST void knn(span<const Point3f> queries, int k, span<KdTreeNeighbor> neighbors, span<uint32_t> counts,
+                          float maxDistanceSqr = INFINITY_F) const;
+
+        /**
+         * Batch radius query, parallel over queries: calls f(queryIndex, pointIndex, distanceSqr) for every point
+         * within radius of each query. Calls for different queries may come from different threads at once.
+         */
+        template<typename F>
+        JTX_HOST void radiusSearch(span<const Point3f> queries, const float radius, F &&f) const {
+            parallelFor(0, queries.size(), QUERY_CHUNK_SIZE, [&](const size_t b, const size_t e) {
+                for (size_t q = b; q < e; ++q) {
+                    radiusSearch(queries[q], radius, [&](const uint32_t index, const float d2) { f(q, index, d2); });
+                }
+            });
+        }
+
+    private:
+        static constexpr size_t QUERY_CHUNK_SIZE = 256;
+
+        /**
+         * Visits the nodes that may hold points within radiusSqr of p, calling f(pointIndex, distanceSqr, radiusSqr)
+         * for each such point. f may shrink radiusSqr to prune the rest of the search.
+         */
+        template<typename F>
+        JTX_HOST void search(const Point3f &p, float radiusSqr, F &&f) const {
+            if (nodes.empty()) return;
+            struct Entry {
+                uint32_t node;
+                BBox3f bounds;
+            };
+            // One far child per level, and a left-balanced tree of 2^30 points is 30 levels deep
+            Entry toVisit[32];
+            int toVisitOffset = 0;
+            const auto n = static_cast<uint32_t>(nodes.size());
+            uint32_t current = 0;
+            BBox3f bounds = rootBounds;
+            while (true) {
+                if (distanceSqr(bounds, p) <= radiusSqr) {
+                    const KdTreeNode &node = nodes[current];
+                    const float d2 = distanceSqr(node.p, p);
+                    if (d2 <= radiusSqr) f(node.index(), d2, radiusSqr);
+
+                    const uint32_t left = 2 * current + 1;
+                    if (left < n) {
+                        const int axis = node.axis();
+                        const float split = node.p[axis];
+                        const bool leftIsNear = p[axis] < split;
+                        BBox3f nearBounds = bounds, farBounds = bounds;
+                        (leftIsNear ? nearBounds : farBounds).pmax[axis] = split;
+                        (leftIsNear ? farBounds : nearBounds).pmin[axis] = split;
+                        const uint32_t nearChild = leftIsNear ? left : left + 1;
+                        const uint32_t farChild = leftIsNear ? left + 1 : left;
+                        if (farChild < n) toVisit[toVisitOffset++] = {farChild, farBounds};
+                        if (nearChild < n) {
+                            current = nearChild;
+                            bounds = nearBounds;
+                            continue;
+                        }
+                    }
+                }
+                if (toVisitOffset == 0) break;
+                --toVisitOffset;
+                current = toVisit[toVisitOffset].node;
+                bounds = toVisit[toVisitOffset].bounds;
+            }
+        }
+
+        vector<KdTreeNode> nodes;
+        BBox3f rootBounds;
+    };
+}
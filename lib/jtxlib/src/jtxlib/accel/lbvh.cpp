@@ -0,0 +1,415 @@
+#include "bvh.hpp"
+
+#include <atomic>
+#include <bit>
+#include <vector>
+#include <jtxlib/math/numerical.hpp>
+#include <jtxlib/util/parallel.hpp>
+#include <jtxlib/util/radixsort.hpp>
+
+/**
+ * Linear BVH: primitives are sorted by the Morton code of their centroid and the hierarchy is read off the sorted codes.
+ * The radix tree is built as in "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees"
+ * (Karras 2012), where every internal node is found independently, and optionally improved with treelet
+ * restructuring from "Fast Parallel Construction of High-Quality Bounding Volume Hierarchies" (Karras and Aila 2013).
+ * Every stage is a parallel loop or a parallel bottom-up sweep, so per-frame rebuilds scale with cores.
+ */
+namespace jtx {
+    namespace {
+        constexpr size_t CHUNK_SIZE = 16 * 1024;
+        // Subtrees at least this large are flattened on another thread
+        constexpr uint32_t PARALLEL_EMIT_THRESHOLD = 64 * 1024;
+        // A surface crosses on the order of 1024^2 cells of a 1024^3 grid, so past that many primitives 30-bit codes
+        // start to collide and 63-bit codes are used
+        constexpr size_t MORTON63_THRESHOLD = 1024 * 1024;
+
+        // Same relative costs as the SAH builder: one for a primitive, half that for a traversal step
+        constexpr float TRAVERSAL_COST = 0.5f;
+
+        constexpr int TREELET_LEAVES = 7;
+        constexpr int TREELET_ROUNDS = 1;
+
+        // A reference to a radix tree node: internal node i, or sorted primitive i when LEAF is set
+        constexpr uint32_t LEAF = 0x80000000u;
+        constexpr uint32_t NONE = UINT32_MAX;
+
+        template<typename Key>
+        class LBVHBuilder {
+        public:
+            LBVHBuilder(const span<const BBox3f> primitiveBounds, const int maxPrimsInNode)
+                : primBounds(primitiveBounds), maxPrimsInNode(static_cast<uint32_t>(maxPrimsInNode)),
+                  n(static_cast<uint32_t>(primitiveBounds.size())) {}
+
+            void build(const bool restructure) {
+                sortByMortonCode();
+
+                const size_t nInternal = n - 1;
+                left.resize(nInternal);
+                right.resize(nInternal);
+                parent.resize(nInternal);
+                leafParent.resize(n);
+                bounds.resize(nInternal);
+                count.resize(nInternal);
+                cost.resize(nInternal);
+                size.resize(nInternal);
+                height.resize(nInternal);
+                visits = std::vector<std::atomic<uint32_t>>(nInternal);
+
+                parent[0] = NONE;
+                parallelFor(0, nInternal, CHUNK_SIZE, [&](const size_t b, const size_t e) {
+                    for (size_t i = b; i < e; ++i) buildInternal(static_cast<int64_t>(i));
+                });
+
+                // The first sweep computes bounds, each later one restructures larger treelets
+                sweepUp(0);
+                if (restructure) {
+                    for (int round = 0; round < TREELET_ROUNDS; ++round) sweepUp(TREELET_LEAVES << round);
+                }
+            }
+
+            [[nodiscard]] uint32_t nodeCount() const { return size[0]; }
+
+            // Interior nodes on the longest root-to-leaf path of the flattened tree
+            [[nodiscard]] uint32_t depth() const { return height[0]; }
+
+            // Writes the tree depth-first into nodes, and the primitives in leaf order into indices
+            void emit(vector<LinearBVHNode> &nodes, vector<uint32_t> &indices) const {
+                emit(0, 0, 0, nodes, indices);
+            }
+
+        private:
+            static constexpr int KEY_BITS = 8 * sizeof(Key);
+
+            //region Morton order
+            void sortByMortonCode() {
+                std::vector<BBox3f> partial((n + CHUNK_SIZE - 1) / CHUNK_SIZE);
+                parallelFor(0, n, CHUNK_SIZE, [&](const size_t b, const size_t e) {
+                    for (size_t i = b; i < e; ++i) partial[b / CHUNK_SIZE].merge(centroid(primBounds[i]));
+                });
+                BBox3f centroidBounds;
+                for (const BBox3f &b: partial) centroidBounds.merge(b);
+
+                constexpr uint32_t GRID = KEY_BITS == 32 ? 1u << 10 : 1u << 21;
+                keys.resize(n);
+                order.resize(n);
+                parallelFor(0, n, CHUNK_SIZE, [&](const size_t b, const size_t e) {
+                    for (size_t i = b; i < e; ++i) {
+                        Point3f c = centroid(primBounds[i]);
+                        const Vec3f o = centroidBounds.offset(c);
+                        auto quantize = [](const float f) {
+                            return std::min(static_cast<uint32_t>(f * GRID), GRID - 1);
+                        };
+                        if constexpr (KEY_BITS == 32) keys[i] = encodeMorton30(quantize(o.x), quantize(o.y), quantize(o.z));
+                        else keys[i] = encodeMorton63(quantize(o.x), quantize(o.y), quantize(o.z));
+                        order[i] = static_cast<uint32_t>(i);
+                    }
+                });
+                radixSort(span<Key>(keys), span<uint32_t>(order), KEY_BITS == 32 ? 30 : 63);
+
+                // Leaves are read in sorted order from here on
+                leafBounds.resize(n);
+                parallelFor(0, n, CHUNK_SIZE, [&](const size_t b, const size_t e) {
+                    for (size_t i = b; i < e; ++i) leafBounds[i] = primBounds[order[i]];
+                });
+            }
+
+            static Point3f centroid(const BBox3f &b) { return (b.pmin + b.pmax) * 0.5f; }
+            //endregion
+
+            //region Radix tree
+            // Length of the common prefix of keys i and j; equal keys fall back to their indices so all keys are unique
+            [[nodiscard]] int delta(const int64_t i, const int64_t j) const {
+                if (j < 0 || j >= n) return -1;
+                if (keys[i] == keys[j]) return KEY_BITS + std::countl_zero(static_cast<uint32_t>(i ^ j));
+                return std::countl_zero(static_cast<Key>(keys[i] ^ keys[j]));
+            }
+
+            // Karras 2012, figure 4: finds the range covered by internal node i and where it splits
+            void buildInternal(const int64_t i) {
+                const int64_t d = delta(i, i + 1) - delta(i, i - 1) > 0 ? 1 : -1;
+
+                const int deltaMin = delta(i, i - d);
+                int64_t lMax = 2;
+                while (delta(i, i + lMax * d) > deltaMin) lMax *= 2;
+                int64_t l = 0;
+                for (int64_t t = lMax / 2; t >= 1; t /= 2) {
+                    if (delta(i, i + (l + t) * d) > deltaMin) l += t;
+                }
+                const int64_t j = i + l * d;
+
+                const int deltaNode = delta(i, j);
+                int64_t s = 0;
+                for (int64_t div = 2, t;; div *= 2) {
+                    t = (l + div - 1) / div;
+                    if (delta(i, i + (s + t) * d) > deltaNode) s += t;
+                    if (t <= 1) break;
+                }
+                const int64_t split = i + s * d + std::min<int64_t>(d, 0);
+
+                const auto g = static_cast<uint32_t>(split);
+                left[i] = std::min(i, j) == split ? g | LEAF : g;
+                right[i] = std::max(i, j) == split + 1 ? (g + 1) | LEAF : g + 1;
+                setParent(left[i], static_cast<uint32_t>(i));
+                setParent(right[i], static_cast<uint32_t>(i));
+            }
+
+            void setParent(const uint32_t ref, const uint32_t p) {
+                if (ref & LEAF) leafParent[ref & ~LEAF] = p;
+                else parent[ref] = p;
+            }
+
+            [[nodiscard]] BBox3f boundsOf(const uint32_t ref) const {
+                return ref & LEAF ? leafBounds[ref & ~LEAF] : bounds[ref];
+            }
+
+            [[nodiscard]] uint32_t countOf(const uint32_t ref) const { return ref & LEAF ? 1 : count[ref]; }
+
+            [[nodiscard]] float costOf(const uint32_t ref) const {
+                return ref & LEAF ? leafBounds[ref & ~LEAF].surfaceArea() : cost[ref];
+            }
+
+            // Flattened node count; 1 for subtrees that become a single leaf
+            [[nodiscard]] uint32_t sizeOf(const uint32_t ref) const { return ref & LEAF ? 1 : size[ref]; }
+
+            [[nodiscard]] uint32_t heightOf(const uint32_t ref) const { return ref & LEAF ? 0 : height[ref]; }
+
+            // SAH cost of a subtree as a single leaf, or infinite when it holds too many primitives for one
+            [[nodiscard]] float leafCost(const uint32_t nPrims, const float area) const {
+                return nPrims <= maxPrimsInNode ? static_cast<float>(nPrims) * area : INFINITY_F;
+            }
+
+            // Recomputes node i from its children, collapsing it into a leaf when that is cheaper by SAH
+            void update(const uint32_t i) {
+                bounds[i] = merge(boundsOf(left[i]), boundsOf(right[i]));
+                count[i] = countOf(left[i]) + countOf(right[i]);
+                const float area = bounds[i].surfaceArea();
+                const float splitCost = TRAVERSAL_COST * area + costOf(left[i]) + costOf(right[i]);
+                const float asLeaf = leafCost(count[i], area);
+                if (asLeaf <= splitCost) {
+                    cost[i] = asLeaf;
+                    size[i] = 1;
+                    height[i] = 0;
+                } else {
+                    cost[i] = splitCost;
+                    size[i] = 1 + sizeOf(left[i]) + sizeOf(right[i]);
+                    height[i] = 1 + std::max(heightOf(left[i]), heightOf(right[i]));
+                }
+            }
+
+            /**
+             * Updates every internal node after both of its children, in parallel: each leaf walks towards the root and
+             * the second thread to arrive at a node processes it. When treeletMin > 0, nodes covering at least
+             * treeletMin primitives are also restructured.
+             */
+            void sweepUp(const uint32_t treeletMin) {
+                parallelFor(0, visits.size(), CHUNK_SIZE, [&](const size_t b, const size_t e) {
+                    for (size_t i = b; i < e; ++i) visits[i].store(0, std::memory_order_relaxed);
+                });
+                parallelFor(0, n, CHUNK_SIZE, [&](const size_t b, const size_t e) {
+                    for (size_t i = b; i < e; ++i) {
+                        for (uint32_t node = leafParent[i]; node != NONE; node = parent[node]) {
+                            // acq_rel makes the other child's results visible to whoever continues
+                            if (visits[node].fetch_add(1, std::memory_order_acq_rel) == 0) break;
+                            update(node);
+                            if (treeletMin > 0 && count[node] >= treeletMin) restructureTreelet(node);
+                        }
+                    }
+                });
+            }
+            //endregion
+
+            //region Treelet restructuring
+            /**
+             * Grows a treelet of up to 7 leaves below root by repeatedly opening the leaf with the largest surface
+             * area, then finds the SAH-optimal binary tree over those leaves by dynamic programming over all subsets
+             * and rebuilds the treelet with it, reusing the treelet's internal nodes.
+             */
+            void restructureTreelet(const uint32_t root) {
+                uint32_t leaves[TREELET_LEAVES] = {left[root], right[root]};
+                uint32_t internals[TREELET_LEAVES - 1] = {root};
+                int nLeaves = 2, nInternals = 1;
+                while (nLeaves < TREELET_LEAVES) {
+                    int open = -1;
+                    float maxArea = -1;
+                    for (int k = 0; k < nLeaves; ++k) {
+                        if (!(leaves[k] & LEAF) && bounds[leaves[k]].surfaceArea() > maxArea) {
+                            maxArea = bounds[leaves[k]].surfaceArea();
+                            open = k;
+                        }
+                    }
+                    if (open < 0) break;
+                    const uint32_t opened = leaves[open];
+                    internals[nInternals++] = opened;
+                    leaves[open] = left[opened];
+                    leaves[nLeaves++] = right[opened];
+                }
+                if (nLeaves < 3) return;
+
+                // Plain SoA floats rather than BBox3f, since this runs for most internal nodes
+                constexpr uint32_t N_SUBSETS = 1u << TREELET_LEAVES;
+                float lo[3][N_SUBSETS], hi[3][N_SUBSETS];
+                uint32_t subsetCount[N_SUBSETS];
+                float optimalCost[N_SUBSETS];
+                uint8_t optimalSplit[N_SUBSETS];
+                for (int k = 0; k < nLeaves; ++k) {
+                    const uint32_t s = 1u << k;
+                    const BBox3f b = boundsOf(leaves[k]);
+                    for (int a = 0; a < 3; ++a) {
+                        lo[a][s] = b.pmin[a];
+                        hi[a][s] = b.pmax[a];
+                    }
+                    subsetCount[s] = countOf(leaves[k]);
+                    optimalCost[s] = costOf(leaves[k]);
+                }
+
+                // Every proper subset of s is numerically smaller than s, so one ascending pass visits subsets first
+                const uint32_t full = (1u << nLeaves) - 1;
+                for (uint32_t s = 1; s <= full; ++s) {
+                    if ((s & (s - 1)) == 0) continue;
+                    const int lowest = std::countr_zero(s);
+                    const uint32_t low = 1u << lowest, rest = s & (s - 1);
+                    for (int a = 0; a < 3; ++a) {
+                        lo[a][s] = std::min(lo[a][rest], lo[a][low]);
+                        hi[a][s] = std::max(hi[a][rest], hi[a][low]);
+                    }
+                    subsetCount[s] = subsetCount[rest] + subsetCount[low];
+                    // Each split appears twice as p and s ^ p; only the one containing the lowest leaf is tried
+                    float best = INFINITY_F;
+                    uint8_t bestSplit = 0;
+                    for (uint32_t q = (rest - 1) & rest;; q = (q - 1) & rest) {
+                        const uint32_t p = q | low;
+                        const float c = optimalCost[p] + optimalCost[s ^ p];
+                        // Written to compile to conditional moves; the comparison is unpredictable
+                        bestSplit = c < best ? static_cast<uint8_t>(p) : bestSplit;
+                        best = c < best ? c : best;
+                        if (q == 0) break;
+                    }
+                    // A subset that becomes a leaf can be given any topology; update() collapses it again
+                    const float dx = hi[0][s] - lo[0][s], dy = hi[1][s] - lo[1][s], dz = hi[2][s] - lo[2][s];
+                    const float area = 2 * (dx * dy + dx * dz + dy * dz);
+                    optimalCost[s] = std::min(TRAVERSAL_COST * area + best, leafCost(subsetCount[s], area));
+                    optimalSplit[s] = bestSplit;
+                }
+                // The current topology is one of the candidates, so only rebuild when it is strictly worse
+                if (!(optimalCost[full] < cost[root])) return;
+
+                int nextInternal = 1;
+                rebuild(root, full, leaves, internals, nextInternal, optimalSplit);
+            }
+
+            void rebuild(const uint32_t node, const uint32_t s, const uint32_t *leaves, const uint32_t *internals,
+                         int &nextInternal, const uint8_t *optimalSplit) {
+                const uint32_t split[2] = {optimalSplit[s], s ^ optimalSplit[s]};
+                uint32_t children[2];
+                for (int c = 0; c < 2; ++c) {
+                    if ((split[c] & (split[c] - 1)) == 0) {
+                        children[c] = leaves[std::countr_zero(split[c])];
+                    } else {
+                        children[c] = internals[nextInternal++];
+                        rebuild(children[c], split[c], leaves, internals, nextInternal, optimalSplit);
+                    }
+                    setParent(children[c], node);
+                }
+                left[node] = children[0];
+                right[node] = children[1];
+                update(node);
+            }
+            //endregion
+
+            //region Flattening
+            void emit(const uint32_t ref, const uint32_t nodeOffset, const uint32_t primOffset,
+                      vector<LinearBVHNode> &nodes, vector<uint32_t> &indices) const {
+                LinearBVHNode &out = nodes[nodeOffset];
+                out.bounds = boundsOf(ref);
+                const uint32_t nPrims = countOf(ref);
+                if (sizeOf(ref) == 1) {
+                    // Gather the subtree's primitives into one leaf
+                    out.primitivesOffset = primOffset;
+                    out.nPrimitives = static_cast<uint16_t>(nPrims);
+                    uint32_t stack[BVH::MAX_PRIMS_IN_NODE + 1], *top = stack, next = primOffset;
+                    *top++ = ref;
+                    while (top != stack) {
+                        const uint32_t r = *--top;
+                        if (r & LEAF) {
+                            indices[next++] = order[r & ~LEAF];
+                        } else {
+                            *top++ = right[r];
+                            *top++ = left[r];
+                        }
+                    }
+                    return;
+                }
+
+                // Put the child with the lower centroid first on the axis that separates them most, which is what
+                // front-to-back traversal assumes
+                uint32_t a = left[ref], b = right[ref];
+                const BBox3f ba = boundsOf(a), bb = boundsOf(b);
+                const Vec3f sep = (bb.pmin + bb.pmax) - (ba.pmin + ba.pmax);
+                const Vec3f absSep(std::abs(sep.x), std::abs(sep.y), std::abs(sep.z));
+                const int axis = absSep.x > absSep.y ? (absSep.x > absSep.z ? 0 : 2) : (absSep.y > absSep.z ? 1 : 2);
+                if (sep[axis] < 0) std::swap(a, b);
+
+                out.axis = static_cast<uint8_t>(axis);
+                out.nPrimitives = 0;
+                out.secondChildOffset = nodeOffset + 1 + sizeOf(a);
+                const uint32_t secondPrimOffset = primOffset + countOf(a);
+                if (nPrims >= PARALLEL_EMIT_THRESHOLD) {
+                    parallelInvoke([&] { emit(a, nodeOffset + 1, primOffset, nodes, indices); },
+                                   [&] { emit(b, out.secondChildOffset, secondPrimOffset, nodes, indices); });
+                } else {
+                    emit(a, nodeOffset + 1, primOffset, nodes, indices);
+                    emit(b, out.secondChildOffset, secondPrimOffset, nodes, indices);
+                }
+            }
+            //endregion
+
+            span<const BBox3f> primBounds;
+            const uint32_t maxPrimsInNode;
+            const uint32_t n;
+
+            std::vector<Key> keys;
+            std::vector<uint32_t> order; // primitive index of each sorted position
+            std::vector<BBox3f> leafBounds;
+
+            // Internal nodes; node 0 is the root
+            std::vector<uint32_t> left, right, parent, leafParent;
+            std::vector<BBox3f> bounds;
+            std::vector<uint32_t> count, size, height;
+            std::vector<float> cost;
+            std::vector<std::atomic<uint32_t>> visits;
+        };
+
+        // Returns false, leaving nodes and indices alone, when the tree would be deeper than BVH::MAX_DEPTH
+        template<typename Key>
+        bool buildWithKey(const span<const BBox3f> primitiveBounds, const int maxPrimsInNode, const bool restructure,
+                          vector<LinearBVHNode> &nodes, vector<uint32_t> &indices) {
+            LBVHBuilder<Key> builder(primitiveBounds, maxPrimsInNode);
+            builder.build(restructure);
+            if (builder.depth() > BVH::MAX_DEPTH) return false;
+            nodes.resize(builder.nodeCount());
+            indices.resize(primitiveBounds.size());
+            builder.emit(nodes, indices);
+            return true;
+        }
+    }
+
+    void BVH::buildLBVH(const span<const BBox3f> primitiveBounds, const int maxPrimsInNode, const bool restructure) {
+        if (primitiveBounds.size() == 1) {
+            nodes.resize(1);
+            nodes[0].bounds = primitiveBounds[0];
+            nodes[0].primitivesOffset = 0;
+            nodes[0].nPrimitives = 1;
+            primitiveIndices.resize(1);
+            primitiveIndices[0] = 0;
+            return;
+        }
+        const bool built = primitiveBounds.size() < MORTON63_THRESHOLD
+                               ? buildWithKey<uint32_t>(primitiveBounds, maxPrimsInNode, restructure, nodes,
+                                                        primitiveIndices)
+                               : buildWithKey<uint64_t>(primitiveBounds, maxPrimsInNode, restructure, nodes,
+                                                        primitiveIndices);
+        // Radix trees are as deep as the longest shared key prefix, which tightly clustered inputs can push past the
+        // traversal stack; the SAH builder bounds its depth
+        if (!built) buildSAH(primitiveBounds, maxPrimsInNode);
+    }
+}
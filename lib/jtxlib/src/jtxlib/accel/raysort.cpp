@@ -0,0 +1,38 @@
+#include "raysort.hpp"
+
+#include <jtxlib/util/assert.hpp>
+#include <jtxlib/util/parallel.hpp>
+#include <jtxlib/util/radixsort.hpp>
+
+namespace jtx {
+    namespace {
+        constexpr size_t CHUNK_SIZE = 16 * 1024;
+    }
+
+    void RaySorter::sort(span<Rayf> rays, const BBox3f &bounds, span<uint32_t> order) {
+        ASSERT(order.size() == rays.size());
+        ASSERT(rays.size() < UINT32_MAX);
+        const size_t n = rays.size();
+
+        keys.resize(n);
+        unsorted.resize(n);
+        parallelFor(0, n, CHUNK_SIZE, [&](const size_t b, const size_t e) {
+            for (size_t i = b; i < e; ++i) {
+                keys[i] = rayKey(rays[i], bounds);
+                order[i] = static_cast<uint32_t>(i);
+                unsorted[i] = rays[i];
+            }
+        });
+        radixSort(span<uint32_t>(keys.data(), n), order, radixScratch, detail::RAY_KEY_BITS);
+
+        // Gather through the copy; the sort only moved keys and indices, which is cheaper than moving 28-byte rays
+        parallelFor(0, n, CHUNK_SIZE, [&](const size_t b, const size_t e) {
+            for (size_t i = b; i < e; ++i) rays[i] = unsorted[order[i]];
+        });
+    }
+
+    void sortRays(span<Rayf> rays, const BBox3f &bounds, span<uint32_t> order) {
+        RaySorter sorter;
+        sorter.sort(rays, bounds, order);
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <jtxlib.hpp>
+#include <jtxlib/math/bounds.hpp>
+#include <jtxlib/math/numerical.hpp>
+#include <jtxlib/math/ray.hpp>
+#include <jtxlib/std/memory_resource.hpp>
+#include <jtxlib/std/std.hpp>
+#include <jtxlib/util/radixsort.hpp>
+
+/**
+ * Ray reordering between bounces. Secondary rays come out of shading in pixel order but point every which way, so
+ * consecutive traversals touch unrelated parts of the BVH. Sorting a batch by direction octant, then by the Morton
+ * code of the origin, lets neighbouring rays share the nodes already in cache, in the spirit of "Sorted Deferred
+ * Shading for Production Path Tracing" (Eisenacher et al. 2013) and "Fast Ray Sorting and Breadth-First Packet
+ * Traversal for GPU Ray Tracing" (Garanzha and Loop 2010).
+ */
+namespace jtx {
+    namespace detail {
+        // Origins are quantized to a 512^3 grid, so the octant and the Morton code fit 30 bits
+        constexpr int RAY_ORIGIN_BITS = 9;
+        constexpr int RAY_KEY_BITS = 3 + 3 * RAY_ORIGIN_BITS;
+    }
+
+    /**
+     * Sort key of a ray: its direction octant (sign bits of x, y and z) in the top 3 of 30 bits, then the 27-bit Morton
+     * code of its origin within bounds. Origins outside bounds are clamped to it.
+     */
+    JTX_HOSTDEV JTX_INLINE uint32_t rayKey(const Rayf &ray, const BBox3f &bounds) {
+        constexpr uint32_t GRID = 1u << detail::RAY_ORIGIN_BITS;
+        Point3f origin = ray.origin;
+        const Vec3f o = bounds.offset(origin);
+        auto quantize = [](const float f) {
+            return std::min(static_cast<uint32_t>(std::clamp(f, 0.0f, 1.0f) * GRID), GRID - 1);
+        };
+        const uint32_t octant = uint32_t(ray.dir.x < 0) | uint32_t(ray.dir.y < 0) << 1 | uint32_t(ray.dir.z < 0) << 2;
+        return octant << (3 * detail::RAY_ORIGIN_BITS) | encodeMorton30(quantize(o.x), quantize(o.y), quantize(o.z));
+    }
+
+    /**
+     * Sorts batches of rays by rayKey with the parallel radix sort, as an optional pass before tracing. The keys, the
+     * gather buffer and the radix sort's scratch are kept between sorts, so sorting every bounce over similarly sized
+     * batches reuses them.
+     */
+    class RaySorter {
+    public:
+        JTX_HOST
+        explicit RaySorter(const Allocator alloc = {}) : keys(alloc), unsorted(alloc) {}
+
+        /**
+         * Sorts rays in place. order receives the permutation: sorted ray i was rays[order[i]] before the call, so
+         * results traced in sorted order go back to their pixels with results[order[i]] = traced[i]. bounds is usually
+         * the scene's.
+         */
+        JTX_HOST void sort(span<Rayf> rays, const BBox3f &bounds, span<uint32_t> order);
+
+    private:
+        vector<uint32_t> keys;
+        vector<Rayf> unsorted;
+        RadixSortScratch<uint32_t, uint32_t> radixScratch;
+    };
+
+    // Same as RaySorter::sort, for a one-off sort; allocates its buffers on every call
+    JTX_HOST void sortRays(span<Rayf> rays, const BBox3f &bounds, span<uint32_t> order);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <jtxlib.hpp>
+#include <jtxlib/accel/bvh.hpp>
+#include <jtxlib/math/bounds.hpp>
+#include <jtxlib/math/ray.hpp>
+#include <jtxlib/math/transform.hpp>
+#include <jtxlib/std/memory_resource.hpp>
+#include <jtxlib/std/std.hpp>
+#include <jtxlib/util/assert.hpp>
+#include <jtxlib/util/parallel.hpp>
+
+/**
+ * Two-level acceleration structure: a top-level BVH over instances of shared bottom-level structures, as with PBRT's
+ * TransformedPrimitive and the TLAS/BLAS split of DXR and Vulkan ray tracing
+ * https://pbr-book.org/4ed/Primitives_and_Intersection_Acceleration/Primitive_Interface_and_Geometric_Primitives
+ */
+namespace jtx {
+    /**
+     * One placement of a bottom-level structure. The BLAS is not owned and may be shared by any number of instances;
+     * renderFromObject places its object space in the scene.
+     */
+    template<typename BLAS>
+    struct BVHInstance {
+        const BLAS *blas = nullptr;
+        Transform renderFromObject;
+    };
+
+    /**
+     * Top-level BVH over instances of bottom-level BVHs (BVH or BVH8). Each instance costs one Transform and a
+     * pointer, so memory grows with the unique geometry rather than with every placed copy of it.
+     *
+     * Instance bounds are the BLAS bounds through Transform::applyToBBox. Traversal moves the ray into each instance's
+     * object space with the transform's cached inverse. The object-space direction is not renormalized, so a ray
+     * parameter t names the same point in both spaces and tMax carries across instances unchanged.
+     */
+    template<typename BLAS = BVH>
+    class TLAS {
+    public:
+        using Instance = BVHInstance<BLAS>;
+
+        JTX_HOST
+        explicit TLAS(Allocator alloc = {}) : instances(alloc), top(alloc) {}
+
+        JTX_HOST
+        explicit TLAS(span<const Instance> instances, BVHBuildMethod method = BVHBuildMethod::SAH, Allocator alloc = {})
+            : instances(instances.begin(), instances.end(), alloc),
+              top(instanceBounds(instances), 1, method, alloc) {}
+
+        [[nodiscard]]
+        JTX_HOST
+        BBox3f bounds() const { return top.bounds(); }
+
+        [[nodiscard]]
+        JTX_HOST
+        span<const Instance> getInstances() const { return {instances.data(), instances.size()}; }
+
+        [[nodiscard]]
+        JTX_HOST
+        const BVH &getTopLevel() const { return top; }
+
+        // The top level and the instances; the bottom-level structures are shared and counted by their owners
+        [[nodiscard]]
+        JTX_HOST
+        size_t memoryBytes() const { return top.memoryBytes() + instances.size() * sizeof(Instance); }
+
+        /**
+         * Finds the closest hit along ray within [0, tMax].
+         *
+         * Calls f(instanceIndex, primitiveIndex, objectRay, tMax) for each primitive whose leaf the ray reaches in an
+         * instance, where objectRay is the ray in that instance's object space. As with BVH::intersect, f returns
+         * true on a closer hit and lowers tMax to it, which prunes both levels.
+         */
+        template<typename F>
+        JTX_HOST bool intersect(const Rayf &ray, float tMax, F &&f, BVHTraversalStats *stats = nullptr) const {
+            return top.intersect(ray, tMax, [&](const uint32_t i, float &topTMax) {
+                const Instance &instance = instances[i];
+                const Rayf objectRay = instance.renderFromObject.applyInverseToRay(ray);
+                return instance.blas->intersect(objectRay, topTMax, [&](const uint32_t p, float &objectTMax) {
+                    if (!f(i, p, objectRay, objectTMax)) return false;
+                    topTMax = objectTMax;
+                    return true;
+                }, stats);
+            }, stats);
+        }
+
+        // Any-hit query: returns as soon as f(instanceIndex, primitiveIndex, objectRay, tMax) reports a hit
+        template<typename F>
+        JTX_HOST bool intersectP(const Rayf &ray, float tMax, F &&f, BVHTraversalStats *stats = nullptr) const {
+            return top.intersectP(ray, tMax, [&](const uint32_t i, const float topTMax) {
+                const Instance &instance = instances[i];
+                const Rayf objectRay = instance.renderFromObject.applyInverseToRay(ray);
+                return instance.blas->intersectP(objectRay, topTMax, [&](const uint32_t p, const float objectTMax) {
+                    return f(i, p, objectRay, objectTMax);
+                }, stats);
+            }, stats);
+        }
+
+    private:
+        static constexpr size_t BOUNDS_CHUNK_SIZE = 4096;
+
+        static std::vector<BBox3f> instanceBounds(span<const Instance> instances) {
+            std::vector<BBox3f> bounds(instances.size());
+            parallelFor(0, instances.size(), BOUNDS_CHUNK_SIZE, [&](const size_t b, const size_t e) {
+                for (size_t i = b; i < e; ++i) {
+                    const Instance &instance = instances[i];
+                    ASSERT(instance.blas != nullptr);
+                    const BBox3f objectBounds = instance.blas->bounds();
+                    if (objectBounds.isDegenerate()) {
+                        // An empty BLAS still needs a finite box for the build; its traversal never hits
+                        const Point3f origin = instance.renderFromObject.applyToPoint(Point3f{0, 0, 0});
+                        bounds[i] = BBox3f(origin, origin);
+                    } else {
+                        bounds[i] = instance.renderFromObject.applyToBBox(objectBounds);
+                    }
+                }
+            });
+            return bounds;
+        }
+
+        vector<Instance> instances;
+        BVH top;
+    };
+}
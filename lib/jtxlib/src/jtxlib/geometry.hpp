@@ -0,0 +1,4 @@
+#pragma once
+
+#include "geometry/triangle.hpp"
+#include "geometry/trianglemesh.hpp"
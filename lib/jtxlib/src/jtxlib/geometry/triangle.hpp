@@ -0,0 +1,344 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <jtxlib.hpp>
+#include <jtxlib/math/constants.hpp>
+#include <jtxlib/math/numerical.hpp>
+#include <jtxlib/math/ray.hpp>
+#include <jtxlib/math/vec3.hpp>
+#include <jtxlib/math/vecmath.hpp>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/**
+ * Ray-triangle intersection. The watertight test follows "Watertight Ray/Triangle Intersection" (Woop, Benthin and
+ * Wald 2013) as implemented in PBRT
+ * https://pbr-book.org/4ed/Shapes/Triangle_Meshes
+ * All tests are two-sided and report hits with t in (0, tMax].
+ */
+namespace jtx {
+    // A hit at t along the ray, at p = b0 * p0 + b1 * p1 + b2 * p2
+    struct TriangleIntersection {
+        float b0 = 0, b1 = 0, b2 = 0;
+        float t = INFINITY_F;
+    };
+
+    /**
+     * Per-ray setup of the watertight test. The axis where the direction is largest becomes z, and a shear maps the
+     * direction onto +z, so each triangle is then tested in 2D against the origin. Computed once per ray and shared
+     * by every triangle it is tested against.
+     */
+    struct TriangleRay {
+        Point3f origin;
+        int kx = 0, ky = 1, kz = 2;
+        float sx = 0, sy = 0, sz = 1;
+
+        JTX_HOSTDEV explicit TriangleRay(const Rayf &ray) : origin(ray.origin) {
+            const Vec3f absDir(std::abs(ray.dir.x), std::abs(ray.dir.y), std::abs(ray.dir.z));
+            kz = absDir.x > absDir.y ? (absDir.x > absDir.z ? 0 : 2) : (absDir.y > absDir.z ? 1 : 2);
+            kx = kz == 2 ? 0 : kz + 1;
+            ky = kx == 2 ? 0 : kx + 1;
+            sx = -ray.dir[kx] / ray.dir[kz];
+            sy = -ray.dir[ky] / ray.dir[kz];
+            sz = 1 / ray.dir[kz];
+        }
+    };
+
+    namespace detail {
+        // Conservative lower bound on t for a hit to be in front of the origin, given the error of the transformed
+        // vertices and edge functions (PBRT 6.5.3)
+        JTX_HOSTDEV JTX_INLINE float triangleTError(const float maxXt, const float maxYt, const float maxZt,
+                                                    const float maxE, const float invDet) {
+            const float deltaZ = gamma(3) * maxZt;
+            const float deltaX = gamma(5) * (maxXt + maxZt);
+            const float deltaY = gamma(5) * (maxYt + maxZt);
+            const float deltaE = 2 * (gamma(2) * maxXt * maxYt + deltaY * maxXt + deltaX * maxYt);
+            return 3 * (gamma(3) * maxE * maxZt + deltaE * maxZt + deltaZ * maxE) * std::abs(invDet);
+        }
+    }
+
+    /**
+     * Watertight test of one triangle. Edge functions that round to exactly zero are recomputed in double, so a ray
+     * through a shared edge or vertex hits at least one of the triangles that meet there.
+     */
+    JTX_HOSTDEV JTX_INLINE bool intersectTriangle(const TriangleRay &ray, const Point3f &p0, const Point3f &p1,
+                                                  const Point3f &p2, const float tMax,
+                                                  TriangleIntersection *isect = nullptr) {
+        // Translate to the ray origin, permute and shear so the ray runs along +z
+        const int kx = ray.kx, ky = ray.ky, kz = ray.kz;
+        float p0x = p0[kx] - ray.origin[kx], p0y = p0[ky] - ray.origin[ky], p0z = p0[kz] - ray.origin[kz];
+        float p1x = p1[kx] - ray.origin[kx], p1y = p1[ky] - ray.origin[ky], p1z = p1[kz] - ray.origin[kz];
+        float p2x = p2[kx] - ray.origin[kx], p2y = p2[ky] - ray.origin[ky], p2z = p2[kz] - ray.origin[kz];
+        p0x += ray.sx * p0z;
+        p0y += ray.sy * p0z;
+        p1x += ray.sx * p1z;
+        p1y += ray.sy * p1z;
+        p2x += ray.sx * p2z;
+        p2y += ray.sy * p2z;
+
+        float e0 = p1x * p2y - p1y * p2x;
+        float e1 = p2x * p0y - p2y * p0x;
+        float e2 = p0x * p1y - p0y * p1x;
+        if (e0 == 0 || e1 == 0 || e2 == 0) {
+            e0 = static_cast<float>(double(p1x) * double(p2y) - double(p1y) * double(p2x));
+            e1 = static_cast<float>(double(p2x) * double(p0y) - double(p2y) * double(p0x));
+            e2 = static_cast<float>(double(p0x) * double(p1y) - double(p0y) * double(p1x));
+        }
+
+        // The origin must be on the same side of all three edges
+        if ((e0 < 0 || e1 < 0 || e2 < 0) && (e0 > 0 || e1 > 0 || e2 > 0)) return false;
+        const float det = e0 + e1 + e2;
+        if (det == 0) return false;
+
+        // Compare the scaled hit distance against the interval before dividing by det
+        p0z *= ray.sz;
+        p1z *= ray.sz;
+        p2z *= ray.sz;
+        const float tScaled = e0 * p0z + e1 * p1z + e2 * p2z;
+        if (det < 0 && (tScaled >= 0 || tScaled < tMax * det)) return false;
+        if (det > 0 && (tScaled <= 0 || tScaled > tMax * det)) return false;
+
+        const float invDet = 1 / det;
+        const float t = tScaled * invDet;
+        const float maxXt = std::max({std::abs(p0x), std::abs(p1x), std::abs(p2x)});
+        const float maxYt = std::max({std::abs(p0y), std::abs(p1y), std::abs(p2y)});
+        const float maxZt = std::max({std::abs(p0z), std::abs(p1z), std::abs(p2z)});
+        const float maxE = std::max({std::abs(e0), std::abs(e1), std::abs(e2)});
+        // Negated so NaN vertices, e.g. unused Triangle8 lanes, miss
+        if (!(t > detail::triangleTError(maxXt, maxYt, maxZt, maxE, invDet))) return false;
+
+        if (isect) *isect = {e0 * invDet, e1 * invDet, e2 * invDet, t};
+        return true;
+    }
+
+    JTX_HOSTDEV JTX_INLINE bool intersectTriangle(const Rayf &ray, const Point3f &p0, const Point3f &p1,
+                                                  const Point3f &p2, const float tMax,
+                                                  TriangleIntersection *isect = nullptr) {
+        return intersectTriangle(TriangleRay(ray), p0, p1, p2, tMax, isect);
+    }
+
+    /**
+     * A triangle stored as the affine map into its own barycentric frame, from "Fast Ray-Triangle Intersections by
+     * Coordinate Transformation" (Baldwin and Weber 2016). Twelve floats and no per-ray setup make it the cheapest
+     * scalar test, but it is not watertight: a ray through a shared edge can slip between both triangles.
+     */
+    struct PrecomputedTriangle {
+        // Rows give b1, b2 and the distance to the plane along the normal's dominant axis, as m[i] . (p, 1)
+        float m[3][4] = {};
+
+        PrecomputedTriangle() = default;
+
+        JTX_HOSTDEV PrecomputedTriangle(const Point3f &p0, const Point3f &p1, const Point3f &p2) {
+            const Vec3f e1 = p1 - p0, e2 = p2 - p0;
+            const Vec3f n = cross(e1, e2);
+            const Vec3f v0(p0.x, p0.y, p0.z), v1(p1.x, p1.y, p1.z), v2(p2.x, p2.y, p2.z);
+            const Vec3f c20 = cross(v2, v0), c10 = cross(v1, v0);
+            const float n0 = dot(v0, n);
+
+            // Project along the dominant axis a; b and c are the other two, in cyclic order
+            const Vec3f absN(std::abs(n.x), std::abs(n.y), std::abs(n.z));
+            const int a = absN.x > absN.y ? (absN.x > absN.z ? 0 : 2) : (absN.y > absN.z ? 1 : 2);
+            if (n[a] == 0) {
+                // Degenerate: the plane row is all zero, so t is NaN and every test misses
+                return;
+            }
+            const int b = a == 2 ? 0 : a + 1, c = b == 2 ? 0 : b + 1;
+            const float inv = 1 / n[a];
+            m[0][a] = 0;
+            m[0][b] = e2[c] * inv;
+            m[0][c] = -e2[b] * inv;
+            m[0][3] = c20[a] * inv;
+            m[1][a] = 0;
+            m[1][b] = -e1[c] * inv;
+            m[1][c] = e1[b] * inv;
+            m[1][3] = -c10[a] * inv;
+            m[2][a] = 1;
+            m[2][b] = n[b] * inv;
+            m[2][c] = n[c] * inv;
+            m[2][3] = -n0 * inv;
+        }
+
+        JTX_HOSTDEV JTX_INLINE bool intersect(const Rayf &ray, const float tMax,
+                                              TriangleIntersection *isect = nullptr) const {
+            const Point3f &o = ray.origin;
+            const Vec3f &d = ray.dir;
+            const float s = m[2][0] * o.x + m[2][1] * o.y + m[2][2] * o.z + m[2][3];
+            const float dz = m[2][0] * d.x + m[2][1] * d.y + m[2][2] * d.z;
+            const float t = -s / dz;
+            // Written so NaN (degenerate triangles, rays in the plane) misses
+            if (!(t > 0 && t <= tMax)) return false;
+
+            const float x = o.x + t * d.x, y = o.y + t * d.y, z = o.z + t * d.z;
+            const float b1 = m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3];
+            if (b1 < 0 || b1 > 1) return false;
+            const float b2 = m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3];
+            if (b2 < 0 || b1 + b2 > 1) return false;
+
+            if (isect) *isect = {1 - b1 - b2, b1, b2, t};
+            return true;
+        }
+    };
+
+    /**
+     * Eight triangles in SoA form, so one ray is tested against all of them with one AVX instruction per step of the
+     * watertight test. Used for BVH leaves of up to eight triangles. Unused lanes hold NaN vertices, which fail every
+     * comparison and never hit.
+     */
+    struct alignas(32) Triangle8 {
+        static constexpr int WIDTH = 8;
+
+        float p[3][3][WIDTH]; // p[vertex][axis][lane]
+        uint32_t index[WIDTH]; // the caller's id for each lane's triangle
+
+        Triangle8() {
+            for (auto &vertex: p) {
+                for (auto &axis: vertex) {
+                    for (float &v: axis) v = std::numeric_limits<float>::quiet_NaN();
+                }
+            }
+            for (uint32_t &i: index) i = UINT32_MAX;
+        }
+
+        JTX_HOSTDEV void set(const int lane, const Point3f &p0, const Point3f &p1, const Point3f &p2,
+                             const uint32_t id) {
+            for (int a = 0; a < 3; ++a) {
+                p[0][a][lane] = p0[a];
+                p[1][a][lane] = p1[a];
+                p[2][a][lane] = p2[a];
+            }
+            index[lane] = id;
+        }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        Point3f vertex(const int lane, const int v) const { return {p[v][0][lane], p[v][1][lane], p[v][2][lane]}; }
+    };
+
+    /**
+     * Closest hit of one ray among the eight triangles, computed as intersectTriangle would for each lane; equal
+     * distances go to the lowest lane. Returns the lane hit, or -1. Lanes whose edge functions round to zero take
+     * the scalar path for its double-precision retry, so the packet is exactly as watertight.
+     */
+    JTX_HOST JTX_INLINE int intersectTriangle8(const Triangle8 &tris, const TriangleRay &ray, float tMax,
+                                               TriangleIntersection *isect = nullptr) {
+        int hitLane = -1;
+        TriangleIntersection hit;
+        uint32_t retryMask = 0;
+#ifdef __AVX2__
+        const int kx = ray.kx, ky = ray.ky, kz = ray.kz;
+        const __m256 ox = _mm256_set1_ps(ray.origin[kx]), oy = _mm256_set1_ps(ray.origin[ky]),
+                     oz = _mm256_set1_ps(ray.origin[kz]);
+        const __m256 sx = _mm256_set1_ps(ray.sx), sy = _mm256_set1_ps(ray.sy), sz = _mm256_set1_ps(ray.sz);
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        const __m256 zero = _mm256_setzero_ps();
+
+        __m256 px[3], py[3], pz[3];
+        for (int v = 0; v < 3; ++v) {
+            pz[v] = _mm256_sub_ps(_mm256_load_ps(tris.p[v][kz]), oz);
+            px[v] = _mm256_add_ps(_mm256_sub_ps(_mm256_load_ps(tris.p[v][kx]), ox), _mm256_mul_ps(sx, pz[v]));
+            py[v] = _mm256_add_ps(_mm256_sub_ps(_mm256_load_ps(tris.p[v][ky]), oy), _mm256_mul_ps(sy, pz[v]));
+        }
+        const __m256 e0 = _mm256_sub_ps(_mm256_mul_ps(px[1], py[2]), _mm256_mul_ps(py[1], px[2]));
+        const __m256 e1 = _mm256_sub_ps(_mm256_mul_ps(px[2], py[0]), _mm256_mul_ps(py[2], px[0]));
+        const __m256 e2 = _mm256_sub_ps(_mm256_mul_ps(px[0], py[1]), _mm256_mul_ps(py[0], px[1]));
+
+        const __m256 anyZero = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(e0, zero, _CMP_EQ_OQ),
+                                                         _mm256_cmp_ps(e1, zero, _CMP_EQ_OQ)),
+                                            _mm256_cmp_ps(e2, zero, _CMP_EQ_OQ));
+        retryMask = static_cast<uint32_t>(_mm256_movemask_ps(anyZero));
+
+        const __m256 anyNeg = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(e0, zero, _CMP_LT_OQ),
+                                                        _mm256_cmp_ps(e1, zero, _CMP_LT_OQ)),
+                                           _mm256_cmp_ps(e2, zero, _CMP_LT_OQ));
+        const __m256 anyPos = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(e0, zero, _CMP_GT_OQ),
+                                                        _mm256_cmp_ps(e1, zero, _CMP_GT_OQ)),
+                                           _mm256_cmp_ps(e2, zero, _CMP_GT_OQ));
+        const __m256 det = _mm256_add_ps(_mm256_add_ps(e0, e1), e2);
+        __m256 valid = _mm256_andnot_ps(_mm256_and_ps(anyNeg, anyPos), _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ));
+
+        for (int v = 0; v < 3; ++v) pz[v] = _mm256_mul_ps(pz[v], sz);
+        const __m256 tScaled = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e0, pz[0]), _mm256_mul_ps(e1, pz[1])),
+                                             _mm256_mul_ps(e2, pz[2]));
+        const __m256 tMaxDet = _mm256_mul_ps(_mm256_set1_ps(tMax), det);
+        const __m256 detNeg = _mm256_cmp_ps(det, zero, _CMP_LT_OQ);
+        const __m256 inNeg = _mm256_and_ps(_mm256_cmp_ps(tScaled, zero, _CMP_LT_OQ),
+                                           _mm256_cmp_ps(tScaled, tMaxDet, _CMP_GE_OQ));
+        const __m256 inPos = _mm256_and_ps(_mm256_cmp_ps(tScaled, zero, _CMP_GT_OQ),
+                                           _mm256_cmp_ps(tScaled, tMaxDet, _CMP_LE_OQ));
+        valid = _mm256_and_ps(valid, _mm256_blendv_ps(inPos, inNeg, detNeg));
+
+        uint32_t validMask = static_cast<uint32_t>(_mm256_movemask_ps(valid)) & ~retryMask;
+        if (validMask) {
+            const __m256 invDet = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+            const __m256 t = _mm256_mul_ps(tScaled, invDet);
+
+            auto absMax3 = [&](const __m256 a, const __m256 b, const __m256 c) {
+                return _mm256_max_ps(_mm256_max_ps(_mm256_and_ps(a, absMask), _mm256_and_ps(b, absMask)),
+                                     _mm256_and_ps(c, absMask));
+            };
+            const __m256 maxXt = absMax3(px[0], px[1], px[2]);
+            const __m256 maxYt = absMax3(py[0], py[1], py[2]);
+            const __m256 maxZt = absMax3(pz[0], pz[1], pz[2]);
+            const __m256 maxE = absMax3(e0, e1, e2);
+            const __m256 deltaZ = _mm256_mul_ps(_mm256_set1_ps(gamma(3)), maxZt);
+            const __m256 deltaX = _mm256_mul_ps(_mm256_set1_ps(gamma(5)), _mm256_add_ps(maxXt, maxZt));
+            const __m256 deltaY = _mm256_mul_ps(_mm256_set1_ps(gamma(5)), _mm256_add_ps(maxYt, maxZt));
+            const __m256 deltaE = _mm256_mul_ps(
+                    _mm256_set1_ps(2.0f),
+                    _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(gamma(2)), maxXt), maxYt),
+                                                _mm256_mul_ps(deltaY, maxXt)),
+                                  _mm256_mul_ps(deltaX, maxYt)));
+            const __m256 deltaT = _mm256_mul_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(3.0f),
+                                  _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(gamma(3)),
+                                                                                          maxE), maxZt),
+                                                              _mm256_mul_ps(deltaE, maxZt)),
+                                                _mm256_mul_ps(deltaZ, maxE))),
+                    _mm256_and_ps(invDet, absMask));
+            validMask &= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(t, deltaT, _CMP_GT_OQ)));
+
+            if (validMask) {
+                // Nearest valid lane; ties go to the lowest lane, as in the scalar loop
+                alignas(32) float ts[Triangle8::WIDTH];
+                _mm256_store_ps(ts, t);
+                for (uint32_t m = validMask; m; m &= m - 1) {
+                    const int lane = std::countr_zero(m);
+                    if (hitLane < 0 || ts[lane] < hit.t) {
+                        hitLane = lane;
+                        hit.t = ts[lane];
+                    }
+                }
+                alignas(32) float b[3][Triangle8::WIDTH];
+                _mm256_store_ps(b[0], _mm256_mul_ps(e0, invDet));
+                _mm256_store_ps(b[1], _mm256_mul_ps(e1, invDet));
+                _mm256_store_ps(b[2], _mm256_mul_ps(e2, invDet));
+                hit = {b[0][hitLane], b[1][hitLane], b[2][hitLane], hit.t};
+                tMax = hit.t;
+            }
+        }
+#else
+        retryMask = (1u << Triangle8::WIDTH) - 1;
+#endif
+        // Remaining lanes in order through the scalar test
+        for (; retryMask; retryMask &= retryMask - 1) {
+            const int lane = std::countr_zero(retryMask);
+            TriangleIntersection candidate;
+            if (intersectTriangle(ray, tris.vertex(lane, 0), tris.vertex(lane, 1), tris.vertex(lane, 2), tMax,
+                                  &candidate) &&
+                (hitLane < 0 || candidate.t < hit.t || (candidate.t == hit.t && lane < hitLane))) {
+                hitLane = lane;
+                hit = candidate;
+                tMax = hit.t;
+            }
+        }
+
+        if (hitLane >= 0 && isect) *isect = hit;
+        return hitLane;
+    }
+}
@@ -0,0 +1,62 @@
+#include "trianglemesh.hpp"
+
+#include <algorithm>
+#include <vector>
+#include <jtxlib/util/parallel.hpp>
+
+namespace jtx {
+    namespace {
+        constexpr size_t CHUNK_SIZE = 16 * 1024;
+    }
+
+    TriangleMesh::TriangleMesh(const span<const Point3f> positions, const span<const uint32_t> indices,
+                               const span<const Normal3f> normals, const span<const Point2f> uvs,
+                               const Allocator alloc)
+        : x(alloc), y(alloc), z(alloc), indices(indices.begin(), indices.end(), alloc),
+          normals(normals.begin(), normals.end(), alloc), uvs(uvs.begin(), uvs.end(), alloc) {
+        ASSERT(indices.size() % 3 == 0);
+        ASSERT(positions.size() < UINT32_MAX);
+        ASSERT(normals.empty() || normals.size() == positions.size());
+        ASSERT(uvs.empty() || uvs.size() == positions.size());
+
+        x.resize(positions.size());
+        y.resize(positions.size());
+        z.resize(positions.size());
+        for (size_t v = 0; v < positions.size(); ++v) {
+            x[v] = positions[v].x;
+            y[v] = positions[v].y;
+            z[v] = positions[v].z;
+        }
+        ASSERT(std::all_of(indices.begin(), indices.end(), [&](const uint32_t v) { return v < positions.size(); }));
+    }
+
+    void TriangleMesh::triangleBounds(span<BBox3f> out) const {
+        ASSERT(out.size() == nTriangles());
+        parallelFor(0, nTriangles(), CHUNK_SIZE, [&](const size_t b, const size_t e) {
+            for (size_t t = b; t < e; ++t) out[t] = triangleBounds(t);
+        });
+    }
+
+    BBox3f TriangleMesh::bounds() const {
+        const size_t nChunks = (nVertices() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        std::vector<BBox3f> partial(nChunks);
+        parallelFor(0, nVertices(), CHUNK_SIZE, [&](const size_t b, const size_t e) {
+            BBox3f chunk;
+            for (size_t v = b; v < e; ++v) chunk.merge(position(static_cast<uint32_t>(v)));
+            partial[b / CHUNK_SIZE] = chunk;
+        });
+        BBox3f result;
+        for (const BBox3f &b: partial) result.merge(b);
+        return result;
+    }
+
+    Triangle8 TriangleMesh::pack(const span<const uint32_t> triangles) const {
+        ASSERT(triangles.size() <= Triangle8::WIDTH);
+        Triangle8 packet;
+        for (size_t lane = 0; lane < triangles.size(); ++lane) {
+            const auto [p0, p1, p2] = vertices(triangles[lane]);
+            packet.set(static_cast<int>(lane), p0, p1, p2, triangles[lane]);
+        }
+        return packet;
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <jtxlib.hpp>
+#include <jtxlib/geometry/triangle.hpp>
+#include <jtxlib/math/bounds.hpp>
+#include <jtxlib/math/ray.hpp>
+#include <jtxlib/math/vec2.hpp>
+#include <jtxlib/math/vec3.hpp>
+#include <jtxlib/std/memory_resource.hpp>
+#include <jtxlib/std/std.hpp>
+#include <jtxlib/util/assert.hpp>
+
+/**
+ * Indexed triangle meshes, after PBRT's TriangleMesh
+ * https://pbr-book.org/4ed/Shapes/Triangle_Meshes
+ */
+namespace jtx {
+    /**
+     * An indexed triangle mesh with 32-bit vertex indices: triangle t uses vertices indices[3t], indices[3t + 1] and
+     * indices[3t + 2]. Positions are stored SoA, one array per axis, so bounds and Triangle8 packing stream through
+     * memory. Per-vertex normals and UVs are optional and empty when not given.
+     */
+    class TriangleMesh {
+    public:
+        JTX_HOST
+        explicit TriangleMesh(Allocator alloc = {}) : x(alloc), y(alloc), z(alloc), indices(alloc), normals(alloc),
+                                                      uvs(alloc) {}
+
+        JTX_HOST
+        TriangleMesh(span<const Point3f> positions, span<const uint32_t> indices, span<const Normal3f> normals = {},
+                     span<const Point2f> uvs = {}, Allocator alloc = {});
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        size_t nTriangles() const { return indices.size() / 3; }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        size_t nVertices() const { return x.size(); }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        bool hasNormals() const { return !normals.empty(); }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        bool hasUVs() const { return !uvs.empty(); }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        Point3f position(const uint32_t v) const { return {x[v], y[v], z[v]}; }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        Normal3f normal(const uint32_t v) const {
+            ASSERT(hasNormals());
+            return normals[v];
+        }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        Point2f uv(const uint32_t v) const {
+            ASSERT(hasUVs());
+            return uvs[v];
+        }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        std::array<uint32_t, 3> vertexIndices(const size_t t) const {
+            return {indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]};
+        }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        std::array<Point3f, 3> vertices(const size_t t) const {
+            const auto [v0, v1, v2] = vertexIndices(t);
+            return {position(v0), position(v1), position(v2)};
+        }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        BBox3f triangleBounds(const size_t t) const {
+            const auto [p0, p1, p2] = vertices(t);
+            return merge(BBox3f(p0, p1), p2);
+        }
+
+        // Bounds of every triangle, in parallel, e.g. as the primitive bounds of a BVH
+        JTX_HOST void triangleBounds(span<BBox3f> out) const;
+
+        [[nodiscard]] JTX_HOST BBox3f bounds() const;
+
+        // Positions along one axis; x, y and z are separate arrays
+        [[nodiscard]]
+        JTX_HOSTDEV
+        span<const float> getPositions(const int axis) const {
+            const vector<float> &p = axis == 0 ? x : axis == 1 ? y : z;
+            return {p.data(), p.size()};
+        }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        span<const uint32_t> getIndices() const { return {indices.data(), indices.size()}; }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        size_t memoryBytes() const {
+            return 3 * x.size() * sizeof(float) + indices.size() * sizeof(uint32_t) +
+                   normals.size() * sizeof(Normal3f) + uvs.size() * sizeof(Point2f);
+        }
+
+        // Watertight test of triangle t
+        [[nodiscard]]
+        JTX_HOSTDEV
+        bool intersect(const size_t t, const TriangleRay &ray, const float tMax,
+                       TriangleIntersection *isect = nullptr) const {
+            const auto [p0, p1, p2] = vertices(t);
+            return intersectTriangle(ray, p0, p1, p2, tMax, isect);
+        }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        PrecomputedTriangle precompute(const size_t t) const {
+            const auto [p0, p1, p2] = vertices(t);
+            return {p0, p1, p2};
+        }
+
+        // Packs up to 8 triangles, e.g. one BVH leaf, for intersectTriangle8; each lane's index is its triangle
+        [[nodiscard]] JTX_HOST Triangle8 pack(span<const uint32_t> triangles) const;
+
+    private:
+        vector<float> x, y, z;
+        vector<uint32_t> indices;
+        vector<Normal3f> normals;
+        vector<Point2f> uvs;
+    };
+}
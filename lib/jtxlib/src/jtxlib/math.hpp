@@ -2,6 +2,8 @@
 
 #include "math/bounds.hpp"
 #include "math/constants.hpp"
+#include "math/half.hpp"
+#include "math/mat3.hpp"
 #include "math/mat4.hpp"
 #include "math/math.hpp"
 #include "math/numerical.hpp"
@@ -75,6 +75,17 @@ namespace jtx {
         JTX_DEV JTX_INLINE bool operator!=(const AABB3 &other) const {
             return pmin != other.pmin || pmax != other.pmax;
         }
+
+        // 0 is pmin, 1 is pmax
+        JTX_DEV JTX_INLINE const Point3<T> &operator[](int i) const {
+            ASSERT(i == 0 || i == 1);
+            return i == 0 ? pmin : pmax;
+        }
+
+        JTX_DEV JTX_INLINE Point3<T> &operator[](int i) {
+            ASSERT(i == 0 || i == 1);
+            return i == 0 ? pmin : pmax;
+        }
         //endregion
 
         //region Member functions
@@ -176,6 +187,55 @@ namespace jtx {
             // PBRT: when would the center be outside the box?
             *radius = inside(*center) ? distance(*center, pmax) : 0;
         }
+
+        /**
+         * Slab test of the ray o + t d against the box for t in [0, tMax], as in PBRT's Bounds3::IntersectP.
+         * On a hit, the parametric range inside the box is written to hit0 and hit1 when given.
+         * The far distances are scaled by 1 + 2 gamma(3) so rounding never misses a box the ray grazes.
+         */
+        JTX_DEV JTX_INLINE bool intersectP(const Point3f &o, const Vec3f &d, const float tMax = INFINITY_F,
+                                           float *hit0 = nullptr, float *hit1 = nullptr) const {
+            float t0 = 0, t1 = tMax;
+            for (int i = 0; i < 3; ++i) {
+                const float invD = 1 / d[i];
+                float tNear = (static_cast<float>(pmin[i]) - o[i]) * invD;
+                float tFar = (static_cast<float>(pmax[i]) - o[i]) * invD;
+                if (tNear > tFar) std::swap(tNear, tFar);
+                tFar *= 1 + 2 * gamma(3);
+
+                t0 = tNear > t0 ? tNear : t0;
+                t1 = tFar < t1 ? tFar : t1;
+                if (t0 > t1) return false;
+            }
+            if (hit0) *hit0 = t0;
+            if (hit1) *hit1 = t1;
+            return true;
+        }
+
+        // Same test for one ray against many boxes: invDir and dirIsNeg (invDir < 0 per axis) are computed once per ray
+        JTX_DEV JTX_INLINE bool intersectP(const Point3f &o, const float raytMax, const Vec3f &invDir,
+                                           const int dirIsNeg[3]) const {
+            const AABB3 &b = *this;
+            float tMin = (static_cast<float>(b[dirIsNeg[0]].x) - o.x) * invDir.x;
+            float tMax = (static_cast<float>(b[1 - dirIsNeg[0]].x) - o.x) * invDir.x;
+            const float tyMin = (static_cast<float>(b[dirIsNeg[1]].y) - o.y) * invDir.y;
+            float tyMax = (static_cast<float>(b[1 - dirIsNeg[1]].y) - o.y) * invDir.y;
+
+            tMax *= 1 + 2 * gamma(3);
+            tyMax *= 1 + 2 * gamma(3);
+            if (tMin > tyMax || tyMin > tMax) return false;
+            if (tyMin > tMin) tMin = tyMin;
+            if (tyMax < tMax) tMax = tyMax;
+
+            const float tzMin = (static_cast<float>(b[dirIsNeg[2]].z) - o.z) * invDir.z;
+            float tzMax = (static_cast<float>(b[1 - dirIsNeg[2]].z) - o.z) * invDir.z;
+            tzMax *= 1 + 2 * gamma(3);
+            if (tMin > tzMax || tzMin > tMax) return false;
+            if (tzMin > tMin) tMin = tzMin;
+            if (tzMax < tMax) tMax = tzMax;
+
+            return tMin < raytMax && tMax > 0;
+        }
         //endregion
     };
 
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <jtxlib.hpp>
+#include <jtxlib/math/numerical.hpp>
+
+#if defined(__F16C__) && !defined(__CUDA_ARCH__)
+#include <immintrin.h>
+#endif
+
+#ifdef CUDA_ENABLED
+#include <cuda_fp16.h>
+#endif
+
+/**
+ * IEEE 754 binary16 conversions (round to nearest even), using F16C where available.
+ *
+ * Device code converts a single half with the CUDA intrinsics. The scalar fallback is the branch-free conversion
+ * from the FP16 library:
+ * https://github.com/Maratyszcza/FP16/blob/0a92994d729ff76a58f692d3028ca1b64b145d91/include/fp16/fp16.h
+ */
+namespace jtx {
+    JTX_HOST JTX_INLINE uint16_t floatToHalf(float f) {
+#if defined(__F16C__) && !defined(__CUDA_ARCH__)
+        return _cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT);
+#else
+        constexpr float scaleToInf = 0x1.0p+112f;
+        constexpr float scaleToZero = 0x1.0p-110f;
+        float base = (std::abs(f) * scaleToInf) * scaleToZero;
+
+        const uint32_t w = floatToBits(f);
+        const uint32_t shl1W = w + w;
+        const uint32_t sign = w & 0x80000000u;
+        uint32_t bias = shl1W & 0xFF000000u;
+        if (bias < 0x71000000u) bias = 0x71000000u;
+
+        base = bitsToFloat((bias >> 1) + 0x07800000u) + base;
+        const uint32_t bits = floatToBits(base);
+        const uint32_t expBits = (bits >> 13) & 0x00007C00u;
+        const uint32_t mantissaBits = bits & 0x00000FFFu;
+        const uint32_t nonSign = expBits + mantissaBits;
+        return static_cast<uint16_t>((sign >> 16) | (shl1W > 0xFF000000u ? 0x7E00u : nonSign));
+#endif
+    }
+
+    JTX_HOSTDEV JTX_INLINE float halfToFloat(uint16_t h) {
+#if defined(CUDA_ENABLED) && defined(__CUDA_ARCH__)
+        return __half2float(__ushort_as_half(h));
+#elif defined(__F16C__)
+        return _cvtsh_ss(h);
+#else
+        const uint32_t w = static_cast<uint32_t>(h) << 16;
+        const uint32_t sign = w & 0x80000000u;
+        const uint32_t twoW = w + w;
+
+        constexpr uint32_t expOffset = 0xE0u << 23;
+        constexpr float expScale = 0x1.0p-112f;
+        const float normalized = bitsToFloat((twoW >> 4) + expOffset) * expScale;
+
+        constexpr uint32_t magicMask = 126u << 23;
+        constexpr float magicBias = 0.5f;
+        const float denormalized = bitsToFloat((twoW >> 17) | magicMask) - magicBias;
+
+        constexpr uint32_t denormalizedCutoff = 1u << 27;
+        return bitsToFloat(sign | (twoW < denormalizedCutoff ? floatToBits(denormalized) : floatToBits(normalized)));
+#endif
+    }
+
+    // Converts n halfs to floats, 8 at a time with F16C
+    JTX_HOST JTX_INLINE void halfToFloat(const uint16_t *src, float *dst, size_t n) {
+        size_t i = 0;
+#if defined(__F16C__) && defined(__AVX__) && !defined(__CUDA_ARCH__)
+        for (; i + 8 <= n; i += 8) {
+            const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+        }
+#endif
+        for (; i < n; ++i) dst[i] = halfToFloat(src[i]);
+    }
+}// namespace jtx
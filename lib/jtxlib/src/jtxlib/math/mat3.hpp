@@ -0,0 +1,222 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cppcoreguidelines-pro-type-member-init"
+#pragma once
+
+#include <span>
+#include <optional>
+#include <jtxlib/math/constants.hpp>
+#include <jtxlib/math/math.hpp>
+#include <jtxlib/math/numerical.hpp>
+#include <jtxlib/util/assert.hpp>
+#include <jtxlib/math/vec3.hpp>
+
+#if defined(CUDA_ENABLED) && defined(__CUDA_ARCH__)
+
+#include <cuda/std/optional>
+#include <cuda/std/span>
+
+#endif
+
+namespace jtx {
+    /**
+     * Row-major 3x3 matrix, mostly for linear color transforms (RGB <-> XYZ, chromatic adaptation).
+     * Spatial transforms should use Mat4/Transform.
+     */
+    class Mat3 {
+    public:
+        float data[3][3];
+        //region Constructors
+        JTX_HOSTDEV Mat3() {
+            for (auto &i: data) {
+                for (float &j: i) {
+                    j = 0.0f;
+                }
+            }
+        }
+
+        JTX_HOSTDEV explicit Mat3(float diag) {
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    data[i][j] = (i == j) ? diag : 0.0f;
+                }
+            }
+        }
+
+        JTX_HOSTDEV Mat3(float m00, float m01, float m02,
+                         float m10, float m11, float m12,
+                         float m20, float m21, float m22) {
+            data[0][0] = m00;
+            data[0][1] = m01;
+            data[0][2] = m02;
+            data[1][0] = m10;
+            data[1][1] = m11;
+            data[1][2] = m12;
+            data[2][0] = m20;
+            data[2][1] = m21;
+            data[2][2] = m22;
+        }
+
+        JTX_HOSTDEV explicit Mat3(const float mat[3][3]) {
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    data[i][j] = mat[i][j];
+                }
+            }
+        }
+
+        JTX_HOSTDEV static Mat3 identity() {
+            return Mat3(1.0f);
+        }
+
+        JTX_HOSTDEV static Mat3 diagonal(float d0, float d1, float d2) {
+            Mat3 m;
+            m[0][0] = d0;
+            m[1][1] = d1;
+            m[2][2] = d2;
+            return m;
+        }
+        //endregion
+
+        //region Binary operators
+#if defined(CUDA_ENABLED) && defined(__CUDA_ARCH__)
+        JTX_HOSTDEV cuda::std::span<const float> operator[](int i) const {
+            return {data[i]};
+        }
+
+        JTX_HOSTDEV cuda::std::span<float> operator[](int i) {
+            return {data[i]};
+        }
+#else
+        JTX_HOST std::span<const float> operator[](int i) const {
+            return {data[i]};
+        }
+
+        JTX_HOST std::span<float> operator[](int i) {
+            return {data[i]};
+        }
+#endif
+
+        JTX_HOSTDEV Mat3 operator*(const float scalar) const {
+            Mat3 res = *this;
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    res[i][j] *= scalar;
+                }
+            }
+            return res;
+        }
+
+        JTX_HOSTDEV friend Mat3 operator*(const float scalar, const Mat3 &mat) {
+            return mat * scalar;
+        }
+
+        JTX_HOSTDEV bool operator==(const Mat3 &other) const {
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    if (data[i][j] != other[i][j]) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        JTX_HOSTDEV bool operator!=(const Mat3 &other) const {
+            return !(*this == other);
+        }
+        //endregion
+
+        //region In-line Methods
+        JTX_HOSTDEV bool equals(const Mat3 &other, float epsilon = EPSILON) const {
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    if (jtx::abs(data[i][j] - other[i][j]) > epsilon) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        [[nodiscard]] JTX_HOSTDEV bool isIdentity() const {
+            return *this == identity();
+        }
+
+        [[nodiscard]] JTX_HOSTDEV Vec3f mul(const Vec3f &v) const {
+            return {jtx::innerProdf(data[0][0], v.x, data[0][1], v.y, data[0][2], v.z),
+                    jtx::innerProdf(data[1][0], v.x, data[1][1], v.y, data[1][2], v.z),
+                    jtx::innerProdf(data[2][0], v.x, data[2][1], v.y, data[2][2], v.z)};
+        }
+
+        [[nodiscard]] JTX_HOSTDEV Mat3 mul(const Mat3 &mat) const {
+            Mat3 res;
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    res[i][j] = jtx::innerProdf(data[i][0], mat[0][j], data[i][1], mat[1][j], data[i][2], mat[2][j]);
+                }
+            }
+            return res;
+        }
+
+        JTX_HOSTDEV Mat3 operator*(const Mat3 &other) const {
+            return this->mul(other);
+        }
+
+        JTX_HOSTDEV Vec3f operator*(const Vec3f &v) const {
+            return this->mul(v);
+        }
+
+        [[nodiscard]] JTX_HOSTDEV Mat3 transpose() const {
+            return {data[0][0], data[1][0], data[2][0],
+                    data[0][1], data[1][1], data[2][1],
+                    data[0][2], data[1][2], data[2][2]};
+        }
+
+        [[nodiscard]] JTX_HOSTDEV float determinant() const {
+            float m12 = jtx::dop(data[1][1], data[2][2], data[1][2], data[2][1]);
+            float m02 = jtx::dop(data[1][0], data[2][2], data[1][2], data[2][0]);
+            float m01 = jtx::dop(data[1][0], data[2][1], data[1][1], data[2][0]);
+            return jtx::fma(data[0][2], m01, jtx::dop(data[0][0], m12, data[0][1], m02));
+        }
+
+#if defined(CUDA_ENABLED) && defined(__CUDA_ARCH__)
+        [[nodiscard]] JTX_HOSTDEV cuda::std::optional<Mat3> inverse() const {
+#else
+        [[nodiscard]] JTX_HOST std::optional<Mat3> inverse() const {
+#endif
+            const float det = determinant();
+            if (det == 0.0f) return {};
+            const float invDet = 1.0f / det;
+
+            Mat3 r;
+            for (int i = 0; i < 3; ++i) {
+                const int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+                for (int j = 0; j < 3; ++j) {
+                    const int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+                    // Cofactor of (i, j) lands at (j, i) in the adjugate
+                    r[j][i] = invDet * jtx::dop(data[i1][j1], data[i2][j2], data[i1][j2], data[i2][j1]);
+                }
+            }
+            return r;
+        }
+        //endregion
+    };
+
+    JTX_HOSTDEV JTX_INLINE Vec3f mul(const Mat3 &mat, const Vec3f &vec) { return mat.mul(vec); }
+
+    JTX_HOSTDEV JTX_INLINE Mat3 mul(const Mat3 &a, const Mat3 &b) { return a.mul(b); }
+
+    JTX_HOSTDEV JTX_INLINE Mat3 transpose(const Mat3 &mat) { return mat.transpose(); }
+
+#if defined(CUDA_ENABLED) && defined(__CUDA_ARCH__)
+    JTX_HOSTDEV JTX_INLINE cuda::std::optional<Mat3> inverse(const Mat3 &mat) { return mat.inverse(); }
+#else
+    JTX_HOST JTX_INLINE std::optional<Mat3> inverse(const Mat3 &mat) { return mat.inverse(); }
+#endif
+
+    JTX_HOSTDEV JTX_INLINE bool equals(const Mat3 &a, const Mat3 &b, float epsilon = EPSILON) {
+        return a.equals(b, epsilon);
+    }
+}// namespace jtx
+
+#pragma clang diagnostic pop
@@ -118,6 +118,45 @@ JTX_HOST JTX_INLINE float bitsToFloat(uint32_t v) {
     return std::bit_cast<float>(v);
 }
 
+// Bound on the relative error of n chained float operations, (n eps) / (1 - n eps) as in PBRT
+JTX_HOSTDEV constexpr float gamma(const int n) {
+    constexpr float machineEpsilon = std::numeric_limits<float>::epsilon() * 0.5f;
+    return (static_cast<float>(n) * machineEpsilon) / (1 - static_cast<float>(n) * machineEpsilon);
+}
+
+//region Morton Codes
+// Spreads the low 10 bits of x apart, leaving two zero bits between each
+JTX_HOSTDEV constexpr uint32_t leftShift3(uint32_t x) {
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8)) & 0x0300f00f;
+    x = (x | (x << 4)) & 0x030c30c3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
+
+// Spreads the low 21 bits of x apart, leaving two zero bits between each
+JTX_HOSTDEV constexpr uint64_t leftShift3(uint64_t x) {
+    x &= 0x1fffff;
+    x = (x | (x << 32)) & 0x001f00000000ffffull;
+    x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+    x = (x | (x << 8)) & 0x100f00f00f00f00full;
+    x = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+    x = (x | (x << 2)) & 0x1249249249249249ull;
+    return x;
+}
+
+// 30-bit Morton code of a point on a 1024^3 grid, z in the highest bit of each triple as in PBRT
+JTX_HOSTDEV constexpr uint32_t encodeMorton30(const uint32_t x, const uint32_t y, const uint32_t z) {
+    return (leftShift3(z) << 2) | (leftShift3(y) << 1) | leftShift3(x);
+}
+
+// 63-bit Morton code of a point on a 2^21 grid per axis
+JTX_HOSTDEV constexpr uint64_t encodeMorton63(const uint32_t x, const uint32_t y, const uint32_t z) {
+    return (leftShift3(uint64_t(z)) << 2) | (leftShift3(uint64_t(y)) << 1) | leftShift3(uint64_t(x));
+}
+//endregion
+
 //region Basic Math Functions
 template<typename T, typename U, typename V>
 JTX_HOST constexpr
@@ -39,6 +39,10 @@ namespace jtx {
         static inline AVXFloat load(const float *ptr) {
             return _mm256_load_ps(ptr);
         }
+        // Loads 8 floats from ptr into AVXFloat, ptr does not need to be aligned
+        static inline AVXFloat loadu(const float *ptr) {
+            return _mm256_loadu_ps(ptr);
+        }
         // Stores 8 floats from AVXFloat into ptr
         inline void store(float *ptr) const {
             _mm256_store_ps(ptr, data);
@@ -55,6 +59,14 @@ namespace jtx {
         return _mm256_mul_ps(a, b);
     }
 
+    // Sums all 8 lanes
+    inline float hsum(AVXFloat a) {
+        __m128 v = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        v = _mm_hadd_ps(v, v);
+        v = _mm_hadd_ps(v, v);
+        return _mm_cvtss_f32(v);
+    }
+
     /**
      * AVXVec3f and AVXVec4f are SoA structs for 3D and 4D vectors
      * Each holds an AVXFloat per component, meaning they hold 8 vectors at a time
@@ -85,7 +97,7 @@ namespace jtx {
         AVXVec4f(AVXFloat v) : x(v), y(v), z(v), w(v) {}
     };
 
-    AVXVec3f::AVXVec3f(const AVXVec4f &v) : x(v.x), y(v.y), z(v.z) {}
+    inline AVXVec3f::AVXVec3f(const AVXVec4f &v) : x(v.x), y(v.y), z(v.z) {}
 
     inline AVXVec4f transformVec(const AVXVec4f &v, const jtx::Mat4 &m) {
         AVXFloat x = m.data[0][0] * v.x + m.data[0][1] * v.y + m.data[0][2] * v.z + m.data[0][3] * v.w;
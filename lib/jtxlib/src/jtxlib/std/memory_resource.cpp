@@ -1,5 +1,7 @@
 #include "memory_resource.hpp"
 
+#include <algorithm>
+#include <cstdint>
 #include <new>
 
 #if defined(JTX__ALIGNED_MALLOC)
@@ -71,4 +73,36 @@ memory_resource *set_default_resource(memory_resource *r) noexcept {
 
 memory_resource *get_default_resource() noexcept { return def; }
 
+void *monotonic_buffer_resource::do_allocate(size_t bytes, size_t alignment) {
+    size_t pad = (alignment - reinterpret_cast<uintptr_t>(m_current) % alignment) % alignment;
+    if (m_current == nullptr || pad + bytes > m_remaining) {
+        // Block layout is [header | data]; reserve enough slack to align the request inside the data
+        constexpr size_t header = (sizeof(block_header) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+        const size_t size = std::max(m_next_size, header + bytes + alignment);
+        auto *block = static_cast<block_header *>(m_upstream->allocate(size, alignof(std::max_align_t)));
+        block->prev = m_blocks;
+        block->size = size;
+        m_blocks = block;
+        m_current = reinterpret_cast<char *>(block) + header;
+        m_remaining = size - header;
+        m_next_size = std::max(m_next_size, size) * growth_factor;
+        pad = (alignment - reinterpret_cast<uintptr_t>(m_current) % alignment) % alignment;
+    }
+
+    void *p = m_current + pad;
+    m_current += pad + bytes;
+    m_remaining -= pad + bytes;
+    return p;
+}
+
+void monotonic_buffer_resource::release() noexcept {
+    while (m_blocks) {
+        block_header *prev = m_blocks->prev;
+        m_upstream->deallocate(m_blocks, m_blocks->size, alignof(std::max_align_t));
+        m_blocks = prev;
+    }
+    m_current = nullptr;
+    m_remaining = 0;
+}
+
 }// namespace jtx::pmr
\ No newline at end of file
@@ -73,6 +73,61 @@ private:
 [[nodiscard]] memory_resource *get_default_resource() noexcept;
 #pragma endregion Global Memory Resources
 
+#pragma region Monotonic Buffer Resource
+/**
+ * Implementation of the C++17 monotonic buffer resource (arena).
+ *
+ * Memory is carved out of blocks requested from the upstream resource, each block larger than the
+ * last. deallocate() is a no-op; everything is returned to upstream by release() or the destructor.
+ * Not thread-safe.
+ *
+ * References:
+ *  - https://en.cppreference.com/w/cpp/memory/monotonic_buffer_resource
+ */
+class monotonic_buffer_resource final : public memory_resource {
+    static constexpr size_t default_initial_size = 4096;
+    static constexpr size_t growth_factor = 2;
+public:
+    explicit monotonic_buffer_resource(memory_resource *upstream = get_default_resource()) noexcept
+        : monotonic_buffer_resource(default_initial_size, upstream) {}
+
+    explicit monotonic_buffer_resource(size_t initial_size, memory_resource *upstream = get_default_resource()) noexcept
+        : m_upstream(upstream), m_next_size(initial_size > 0 ? initial_size : default_initial_size) {}
+
+    monotonic_buffer_resource(const monotonic_buffer_resource &) = delete;
+
+    monotonic_buffer_resource &operator=(const monotonic_buffer_resource &) = delete;
+
+    ~monotonic_buffer_resource() override { release(); }
+
+    /**
+     * Returns all blocks to upstream; pointers handed out so far are invalidated
+     */
+    void release() noexcept;
+
+    [[nodiscard]] memory_resource *upstream_resource() const noexcept { return m_upstream; }
+
+private:
+    struct block_header {
+        block_header *prev;
+        size_t size;
+    };
+
+    void *do_allocate(size_t bytes, size_t alignment) override;
+
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override {}
+
+    [[nodiscard]]
+    bool do_is_equal(const memory_resource &other) const noexcept override { return this == &other; }
+
+    memory_resource *m_upstream;
+    size_t m_next_size;
+    block_header *m_blocks = nullptr;
+    char *m_current = nullptr;
+    size_t m_remaining = 0;
+};
+#pragma endregion Monotonic Buffer Resource
+
 #pragma region Polymorphic Allocator
 /**
  * Implementation of the C++17 polymorphic allocator interface.
@@ -23,18 +23,18 @@ public:
     array() = default;
 
     JTX_HOSTDEV
-    array(std::initializer_list<T> v) {
+    constexpr array(std::initializer_list<T> v) {
         size_t i = 0;
         for (const T &val: v) _data[i++] = val;
     }
 
     JTX_HOSTDEV
-    void fill (const T &v) {
+    constexpr void fill (const T &v) {
         for (int i = 0; i < N; ++i) _data[i] = v;
     }
 
     JTX_HOSTDEV
-    bool operator==(const array<T, N> &a) const {
+    constexpr bool operator==(const array<T, N> &a) const {
         for (int i = 0; i < N; ++i) {
             if (_data[i] != a[i]) return false;
         }
@@ -42,34 +42,34 @@ public:
     }
 
     JTX_HOSTDEV
-    bool operator!=(const array<T, N> &a) const { return !(*this == a); }
+    constexpr bool operator!=(const array<T, N> &a) const { return !(*this == a); }
 
     JTX_HOSTDEV
-    iterator begin() { return _data; }
+    constexpr iterator begin() { return _data; }
 
     JTX_HOSTDEV
-    iterator end() { return _data + N; }
+    constexpr iterator end() { return _data + N; }
 
     JTX_HOSTDEV
-    const_iterator begin() const { return _data; }
+    constexpr const_iterator begin() const { return _data; }
 
     JTX_HOSTDEV
-    const_iterator end() const { return _data + N; }
+    constexpr const_iterator end() const { return _data + N; }
 
     JTX_HOSTDEV
-    size_t size() const { return N; }
+    constexpr size_t size() const { return N; }
 
     JTX_HOSTDEV
-    T &operator[](size_t i) { return _data[i]; }
+    constexpr T &operator[](size_t i) { return _data[i]; }
 
     JTX_HOSTDEV
-    const T &operator[](size_t i) const { return _data[i]; }
+    constexpr const T &operator[](size_t i) const { return _data[i]; }
 
     JTX_HOSTDEV
-    T *data() { return _data; }
+    constexpr T *data() { return _data; }
 
     JTX_HOSTDEV
-    const T *data() const { return _data; }
+    constexpr const T *data() const { return _data; }
 
 private:
     T _data[N] = {};
@@ -1,3 +1,4 @@
 #pragma once
 
-#include "util/assert.hpp"
\ No newline at end of file
+#include "util/assert.hpp"
+#include "util/hash.hpp"
\ No newline at end of file
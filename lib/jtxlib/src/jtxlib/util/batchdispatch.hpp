@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <jtxlib.hpp>
+#include <jtxlib/std/memory_resource.hpp>
+#include <jtxlib/std/std.hpp>
+#include <jtxlib/util/assert.hpp>
+
+namespace jtx {
+    /**
+     * Runs a callable over many TaggedPtr handles once per type rather than once per handle.
+     *
+     * Handles are counting-sorted by tag. Then f(span<T *const> ptrs, span<const uint32_t> indices) is called for
+     * each type present, in tag order. ptrs are already cast, and indices[k] is the position of ptrs[k] in the input,
+     * so results can be written back in the caller's order. Null handles are skipped; permutation() holds the whole
+     * sort with them first. const handles give const T pointers.
+     *
+     * Per-handle dispatch is an unpredictable branch when types are mixed. Here there is one dispatch per type, and
+     * f sees a run of same-typed objects it can hoist work out of or vectorize.
+     * Keeps its scratch storage between calls, so reuse one instance per thread.
+     */
+    template<typename Handle>
+    class BatchDispatcher {
+    public:
+        JTX_HOST
+        explicit BatchDispatcher(const Allocator alloc = {}) : order(alloc), ptrStorage(alloc) {}
+
+        template<typename H, typename F>
+        JTX_HOST void dispatch(span<H> handles, F &&f) {
+            static_assert(std::is_same_v<std::remove_const_t<H>, Handle>, "Handles must be of the dispatcher's type");
+            ASSERT(handles.size() <= UINT32_MAX);
+
+            // Counting sort by tag
+            for (uint32_t &s : start) s = 0;
+            for (const Handle &h : handles) ++start[h.getTag() + 1];
+            for (unsigned int t = 0; t < N_TAGS; ++t) start[t + 1] += start[t];
+
+            uint32_t next[N_TAGS];
+            for (unsigned int t = 0; t < N_TAGS; ++t) next[t] = start[t];
+            order.resize(handles.size());
+            // Room for the largest group, plus slack to align it
+            ptrStorage.resize(handles.size() * sizeof(void *) + alignof(void *));
+            for (uint32_t i = 0; i < handles.size(); ++i) order[next[handles[i].getTag()]++] = i;
+
+            for (unsigned int t = 1; t < N_TAGS; ++t) {
+                const uint32_t begin = start[t], count = start[t + 1] - start[t];
+                if (count == 0) continue;
+                const span<const uint32_t> indices(order.data() + begin, count);
+                auto op = [&](auto first) {
+                    // Same pointer type dispatch gives each handle, so T * or const T *
+                    using P = decltype(first);
+                    static_assert(sizeof(P) <= sizeof(void *) && alignof(P) <= alignof(void *));
+                    // Each group is an array of P created in the storage, which replaces the previous group's
+                    void *raw = ptrStorage.data();
+                    size_t space = ptrStorage.size();
+                    P *cast = ::new (std::align(alignof(P), count * sizeof(P), raw, space)) P[count];
+                    for (uint32_t k = 0; k < count; ++k) cast[k] = static_cast<P>(handles[indices[k]].getPtr());
+                    f(span<const P>(cast, count), indices);
+                };
+                handles[indices[0]].dispatch(op);
+            }
+        }
+
+        // Input indices sorted by tag, valid until the next dispatch()
+        [[nodiscard]]
+        JTX_HOST
+        span<const uint32_t> permutation() const { return {order.data(), order.size()}; }
+
+        // Positions of the null handles in the last dispatch()
+        [[nodiscard]]
+        JTX_HOST
+        span<const uint32_t> nullIndices() const { return {order.data(), start[1]}; }
+
+    private:
+        static constexpr unsigned int N_TAGS = Handle::maxTag() + 1;
+
+        vector<uint32_t> order;
+        // Raw storage for the current group's cast pointers
+        vector<std::byte> ptrStorage;
+        uint32_t start[N_TAGS + 1] = {};
+    };
+
+    // One-off batch dispatch; use a BatchDispatcher to reuse scratch storage between batches
+    template<typename Handle, typename F>
+    JTX_HOST void dispatchBatch(span<Handle> handles, F &&f) {
+        BatchDispatcher<std::remove_const_t<Handle>> dispatcher;
+        dispatcher.dispatch(handles, f);
+    }
+}
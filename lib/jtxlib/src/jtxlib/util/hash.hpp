@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <jtxlib.hpp>
+
+/**
+ * Hashing utilities, same as PBRTv4
+ * https://github.com/mmp/pbrt-v4/blob/39e01e61f8de07b99859df04b271a02a53d9aeb2/src/pbrt/util/hash.h
+ */
+namespace jtx {
+    // https://github.com/explosion/murmurhash/blob/master/murmurhash/MurmurHash2.cpp
+    JTX_HOSTDEV JTX_INLINE uint64_t murmurHash64A(const unsigned char *key, size_t len, uint64_t seed) {
+        constexpr uint64_t m = 0xc6a4a7935bd1e995ull;
+        constexpr int r = 47;
+
+        uint64_t h = seed ^ (len * m);
+
+        const unsigned char *end = key + 8 * (len / 8);
+        while (key != end) {
+            uint64_t k;
+            std::memcpy(&k, key, sizeof(uint64_t));
+            key += 8;
+
+            k *= m;
+            k ^= k >> r;
+            k *= m;
+
+            h ^= k;
+            h *= m;
+        }
+
+        switch (len & 7) {
+            case 7: h ^= uint64_t(key[6]) << 48; [[fallthrough]];
+            case 6: h ^= uint64_t(key[5]) << 40; [[fallthrough]];
+            case 5: h ^= uint64_t(key[4]) << 32; [[fallthrough]];
+            case 4: h ^= uint64_t(key[3]) << 24; [[fallthrough]];
+            case 3: h ^= uint64_t(key[2]) << 16; [[fallthrough]];
+            case 2: h ^= uint64_t(key[1]) << 8; [[fallthrough]];
+            case 1:
+                h ^= uint64_t(key[0]);
+                h *= m;
+        }
+
+        h ^= h >> r;
+        h *= m;
+        h ^= h >> r;
+
+        return h;
+    }
+
+    // http://zimbry.blogspot.ch/2011/09/better-bit-mixing-improving-on.html
+    JTX_HOSTDEV JTX_INLINE uint64_t mixBits(uint64_t v) {
+        v ^= (v >> 31);
+        v *= 0x7fb5d329728ea185ull;
+        v ^= (v >> 27);
+        v *= 0x81dadef4bc2dd44dull;
+        v ^= (v >> 33);
+        return v;
+    }
+
+    template<typename T>
+    JTX_HOSTDEV JTX_INLINE uint64_t hashBuffer(const T *ptr, size_t size, uint64_t seed = 0) {
+        return murmurHash64A(reinterpret_cast<const unsigned char *>(ptr), size, seed);
+    }
+}// namespace jtx
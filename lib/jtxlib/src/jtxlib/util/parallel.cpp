@@ -0,0 +1,39 @@
+#include "parallel.hpp"
+
+namespace jtx {
+    namespace {
+        int hardwareThreads() {
+            return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        }
+
+        std::atomic<int> threadLimit{hardwareThreads()};
+        // Extra threads that may still be started; the calling thread is not counted
+        std::atomic<int> spareThreads{hardwareThreads() - 1};
+    }
+
+    int maxThreads() {
+        return threadLimit.load(std::memory_order_relaxed);
+    }
+
+    void setMaxThreads(const int n) {
+        const int limit = n > 0 ? n : hardwareThreads();
+        threadLimit.store(limit);
+        spareThreads.store(limit - 1);
+    }
+
+    namespace detail {
+        int acquireThreads(const int n) {
+            if (n <= 0) return 0;
+            int spare = spareThreads.load(std::memory_order_relaxed);
+            while (spare > 0) {
+                const int granted = std::min(spare, n);
+                if (spareThreads.compare_exchange_weak(spare, spare - granted)) return granted;
+            }
+            return 0;
+        }
+
+        void releaseThreads(const int n) {
+            if (n > 0) spareThreads.fetch_add(n);
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <jtxlib.hpp>
+
+/**
+ * Minimal fork-join parallelism on std::thread, in the spirit of PBRT's ParallelFor.
+ *
+ * There is no pool: workers start per call and are joined before it returns. A global budget caps the extra threads
+ * alive at once at maxThreads() - 1, so nested calls (e.g. a parallelFor inside a parallelInvoke branch) run inline
+ * once the cores are busy instead of oversubscribing. Host only.
+ */
+namespace jtx {
+    // Threads parallel work may use, including the caller; the hardware thread count unless set
+    JTX_HOST int maxThreads();
+
+    // n <= 0 restores the hardware thread count. Call while no parallel work is running.
+    JTX_HOST void setMaxThreads(int n);
+
+    namespace detail {
+        // Takes up to n threads from the budget and returns how many were granted
+        JTX_HOST int acquireThreads(int n);
+
+        JTX_HOST void releaseThreads(int n);
+    }
+
+    // Calls f(chunkBegin, chunkEnd) for consecutive chunks of [begin, end), at most chunkSize long, concurrently
+    template<typename F>
+    JTX_HOST void parallelFor(const size_t begin, const size_t end, size_t chunkSize, F &&f) {
+        if (begin >= end) return;
+        chunkSize = std::max<size_t>(chunkSize, 1);
+        const size_t nChunks = (end - begin + chunkSize - 1) / chunkSize;
+        const int nWorkers = detail::acquireThreads(static_cast<int>(std::min<size_t>(nChunks - 1, 1024)));
+
+        std::atomic<size_t> next{0};
+        auto work = [&] {
+            for (size_t c = next.fetch_add(1, std::memory_order_relaxed); c < nChunks;
+                 c = next.fetch_add(1, std::memory_order_relaxed)) {
+                const size_t b = begin + c * chunkSize;
+                f(b, std::min(end, b + chunkSize));
+            }
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(nWorkers);
+        for (int i = 0; i < nWorkers; ++i) workers.emplace_back(work);
+        work();
+        for (std::thread &t : workers) t.join();
+        detail::releaseThreads(nWorkers);
+    }
+
+    // Runs a and b, with b on another thread if the budget has one spare
+    template<typename A, typename B>
+    JTX_HOST void parallelInvoke(A &&a, B &&b) {
+        if (detail::acquireThreads(1) == 0) {
+            a();
+            b();
+            return;
+        }
+        std::thread t(std::ref(b));
+        a();
+        t.join();
+        detail::releaseThreads(1);
+    }
+}
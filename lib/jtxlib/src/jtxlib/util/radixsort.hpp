@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include <jtxlib.hpp>
+#include <jtxlib/std/std.hpp>
+#include <jtxlib/util/assert.hpp>
+#include <jtxlib/util/parallel.hpp>
+
+/**
+ * Parallel LSD radix sort of (key, value) pairs on unsigned integer keys, e.g. Morton codes with primitive indices.
+ *
+ * Each pass sorts on 8 bits: chunks build digit histograms in parallel, an exclusive scan over (digit, chunk) gives
+ * every chunk its output offsets, and chunks then scatter in parallel. Chunks scatter in order, so the sort is stable
+ * and the result does not depend on the thread count. Passes whose digit is the same for every key are skipped.
+ */
+namespace jtx {
+    namespace detail {
+        constexpr int RADIX_BITS = 8;
+        constexpr size_t RADIX_BUCKETS = 1 << RADIX_BITS;
+        constexpr size_t RADIX_CHUNK_SIZE = 64 * 1024;
+    }
+
+    // Buffers for radixSort, which callers sorting every frame can keep so repeated sorts reuse them
+    template<typename Key, typename Value>
+    struct RadixSortScratch {
+        std::vector<Key> keys;
+        std::vector<Value> values;
+        std::vector<size_t> offsets;
+    };
+
+    /**
+     * Sorts keys ascending, applying the same permutation to values.
+     * Only the low keyBits bits of the keys are compared, so 30-bit Morton codes take 4 passes rather than 4 bytes' worth
+     * of a wider key type. Bits above keyBits should be zero.
+     */
+    template<typename Key, typename Value>
+    JTX_HOST void radixSort(span<Key> keys, span<Value> values, RadixSortScratch<Key, Value> &scratch,
+                            const int keyBits = 8 * sizeof(Key)) {
+        static_assert(std::is_unsigned_v<Key>, "radixSort needs unsigned integer keys");
+        ASSERT(keys.size() == values.size());
+        ASSERT(keyBits > 0 && keyBits <= 8 * static_cast<int>(sizeof(Key)));
+        using detail::RADIX_BUCKETS, detail::RADIX_CHUNK_SIZE;
+
+        const size_t n = keys.size();
+        if (n < 2) return;
+        const size_t nChunks = (n + RADIX_CHUNK_SIZE - 1) / RADIX_CHUNK_SIZE;
+
+        scratch.keys.resize(n);
+        scratch.values.resize(n);
+        Key *srcKeys = keys.data(), *dstKeys = scratch.keys.data();
+        Value *srcValues = values.data(), *dstValues = scratch.values.data();
+        // offsets[chunk * RADIX_BUCKETS + digit]: histogram, then where the chunk writes that digit
+        std::vector<size_t> &offsets = scratch.offsets;
+        offsets.resize(nChunks * RADIX_BUCKETS);
+
+        for (int shift = 0; shift < keyBits; shift += detail::RADIX_BITS) {
+            auto digit = [shift](const Key k) { return static_cast<size_t>(k >> shift) & (RADIX_BUCKETS - 1); };
+
+            parallelFor(0, n, RADIX_CHUNK_SIZE, [&, sk = srcKeys](const size_t b, const size_t e) {
+                size_t histogram[RADIX_BUCKETS] = {};
+                for (size_t i = b; i < e; ++i) ++histogram[digit(sk[i])];
+                std::copy_n(histogram, RADIX_BUCKETS, &offsets[b / RADIX_CHUNK_SIZE * RADIX_BUCKETS]);
+            });
+
+            // Exclusive scan, digit-major so equal digits keep their chunk order
+            size_t total = 0;
+            bool trivial = false;
+            for (size_t d = 0; d < RADIX_BUCKETS; ++d) {
+                size_t digitCount = 0;
+                for (size_t c = 0; c < nChunks; ++c) {
+                    size_t &o = offsets[c * RADIX_BUCKETS + d];
+                    const size_t count = o;
+                    o = total;
+                    total += count;
+                    digitCount += count;
+                }
+                if (digitCount == n) trivial = true;
+            }
+            if (trivial) continue;
+
+            parallelFor(0, n, RADIX_CHUNK_SIZE, [&, sk = srcKeys, sv = srcValues, dk = dstKeys, dv = dstValues](
+                                const size_t b, const size_t e) {
+                // A local copy of the offsets, since uint64_t keys could otherwise alias them on every store
+                size_t offset[RADIX_BUCKETS];
+                std::copy_n(&offsets[b / RADIX_CHUNK_SIZE * RADIX_BUCKETS], RADIX_BUCKETS, offset);
+                for (size_t i = b; i < e; ++i) {
+                    const Key k = sk[i];
+                    const size_t o = offset[digit(k)]++;
+                    dk[o] = k;
+                    dv[o] = sv[i];
+                }
+            });
+            std::swap(srcKeys, dstKeys);
+            std::swap(srcValues, dstValues);
+        }
+
+        // An odd number of scatters leaves the result in the scratch buffers
+        if (srcKeys != keys.data()) {
+            std::copy(srcKeys, srcKeys + n, keys.data());
+            std::copy(srcValues, srcValues + n, values.data());
+        }
+    }
+
+    // Same, with buffers that live only for this call
+    template<typename Key, typename Value>
+    JTX_HOST void radixSort(span<Key> keys, span<Value> values, const int keyBits = 8 * sizeof(Key)) {
+        RadixSortScratch<Key, Value> scratch;
+        radixSort(keys, values, scratch, keyBits);
+    }
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <jtxlib.hpp>
+#include <jtxlib/std/memory_resource.hpp>
+#include <jtxlib/std/std.hpp>
+#include <jtxlib/util/assert.hpp>
+#include <jtxlib/util/taggedptr.hpp>
+
+namespace jtx {
+    template<typename... Ts>
+    class TypedArenas;
+
+    /**
+     * A 32-bit counterpart to TaggedPtr: a type tag and an index into that type's array in a TypedArenas.
+     *
+     * Tag and index share one uint32_t. The tag takes as few high bits as the type count needs, with 0 as null, and
+     * the index gets the rest (28 bits for 8 types). References are half the size of a TaggedPtr, which matters
+     * when a scene holds hundreds of millions of them. is() and tag queries need only the handle; cast() and
+     * dispatch() also take the arenas the index points into. A const arena gives const pointers.
+     */
+    template<typename... Ts>
+    class TaggedIndex {
+    public:
+        using Arenas = TypedArenas<Ts...>;
+
+        static constexpr int TAG_BITS = std::bit_width(sizeof...(Ts));
+        static constexpr int INDEX_BITS = 32 - TAG_BITS;
+        static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+        static_assert(TAG_BITS <= 16, "Too many types for a 32-bit tagged index");
+
+        //region Constructors
+        JTX_HOSTDEV TaggedIndex() = default;
+        JTX_HOSTDEV explicit TaggedIndex(std::nullptr_t) {}
+
+        template<typename T>
+        [[nodiscard]]
+        JTX_HOSTDEV
+        static TaggedIndex create(const uint32_t index) {
+            ASSERT(index <= INDEX_MASK);
+            TaggedIndex h;
+            h.bits = (tagIndex<T>() << INDEX_BITS) | index;
+            return h;
+        }
+        //endregion
+
+        //region Operators
+        JTX_HOSTDEV bool operator==(const TaggedIndex &h) const { return bits == h.bits; }
+        JTX_HOSTDEV bool operator!=(const TaggedIndex &h) const { return bits != h.bits; }
+
+        JTX_HOSTDEV
+        explicit operator bool() const { return bits != 0; }
+        //endregion
+
+        //region Getters
+        [[nodiscard]] JTX_HOSTDEV unsigned int getTag() const { return bits >> INDEX_BITS; }
+        [[nodiscard]] JTX_HOSTDEV uint32_t getIndex() const { return bits & INDEX_MASK; }
+
+        [[nodiscard]] JTX_HOSTDEV void *getPtr(Arenas &arenas) const {
+            return const_cast<void *>(getPtr(std::as_const(arenas)));
+        }
+
+        [[nodiscard]] JTX_HOSTDEV const void *getPtr(const Arenas &arenas) const {
+            if (!*this) return nullptr;
+            const unsigned int t = getTag() - 1;
+            ASSERT(getIndex() < arenas.sizes[t]);
+            return static_cast<const std::byte *>(arenas.bases[t]) + size_t(getIndex()) * Arenas::STRIDES[t];
+        }
+        //endregion
+
+        template<typename T>
+        [[nodiscard]] JTX_HOSTDEV bool is() const { return getTag() == tagIndex<T>(); }
+
+        //region Casting
+        template<typename T>
+        JTX_HOSTDEV T *cast(Arenas &arenas) const {
+            ASSERT(is<T>());
+            return static_cast<T *>(getPtr(arenas));
+        }
+
+        template<typename T>
+        JTX_HOSTDEV const T *cast(const Arenas &arenas) const {
+            ASSERT(is<T>());
+            return static_cast<const T *>(getPtr(arenas));
+        }
+
+        template<typename T>
+        JTX_HOSTDEV T *castOrNp(Arenas &arenas) const { return is<T>() ? cast<T>(arenas) : nullptr; }
+
+        template<typename T>
+        JTX_HOSTDEV const T *castOrNp(const Arenas &arenas) const { return is<T>() ? cast<T>(arenas) : nullptr; }
+        //endregion
+
+        template<typename T>
+        JTX_HOSTDEV static constexpr unsigned int tagIndex() { return TaggedPtr<Ts...>::template tagIndex<T>(); }
+
+        // Largest valid tag; tags run from 1 to maxTag(), 0 is null
+        JTX_HOSTDEV static constexpr unsigned int maxTag() { return sizeof...(Ts); }
+
+        template<typename F>
+        JTX_HOSTDEV decltype(auto) dispatch(Arenas &arenas, F &&f) const {
+            ASSERT(*this);
+            using R = typename detail::ReturnType<F, Ts...>::type;
+            return detail::dispatch<R, std::remove_reference_t<F>, void *, Ts...>(f, getPtr(arenas), getTag() - 1);
+        }
+
+        template<typename F>
+        JTX_HOSTDEV decltype(auto) dispatch(const Arenas &arenas, F &&f) const {
+            ASSERT(*this);
+            using R = typename detail::ReturnType<F, const Ts...>::type;
+            return detail::dispatch<R, std::remove_reference_t<F>, const void *, Ts...>(f, getPtr(arenas),
+                                                                                        getTag() - 1);
+        }
+
+    private:
+        uint32_t bits = 0;
+    };
+
+    /**
+     * Per-type pmr::vector storage that TaggedIndex<Ts...> handles point into.
+     *
+     * Each type's base pointer is kept in a small table, so resolving a handle is one load and a multiply-add
+     * with no branch on the type. Growing a vector moves its elements, so raw pointers from cast() are only
+     * valid until the next emplace() of that type; the handles themselves stay valid. Reserve up front when
+     * the counts are known.
+     */
+    template<typename... Ts>
+    class TypedArenas {
+    public:
+        using Handle = TaggedIndex<Ts...>;
+
+        JTX_HOST
+        explicit TypedArenas(const Allocator alloc = {}) : storage(AllocatorFor<Ts>(alloc)...) {}
+
+        // Not copyable: handles from one set of arenas would silently resolve into the other
+        TypedArenas(const TypedArenas &) = delete;
+        TypedArenas &operator=(const TypedArenas &) = delete;
+
+        template<typename T, typename... Args>
+        JTX_HOST Handle emplace(Args &&...args) {
+            vector<T> &v = get<T>();
+            ASSERT(v.size() <= Handle::INDEX_MASK);
+            const auto index = static_cast<uint32_t>(v.size());
+            v.emplace_back(std::forward<Args>(args)...);
+            update<T>();
+            return Handle::template create<T>(index);
+        }
+
+        template<typename T>
+        JTX_HOST void reserve(const size_t n) {
+            get<T>().reserve(n);
+            update<T>();
+        }
+
+        template<typename T>
+        [[nodiscard]] JTX_HOSTDEV span<T> view() {
+            vector<T> &v = get<T>();
+            return {v.data(), v.size()};
+        }
+
+        template<typename T>
+        [[nodiscard]] JTX_HOSTDEV span<const T> view() const {
+            const vector<T> &v = get<T>();
+            return {v.data(), v.size()};
+        }
+
+        template<typename T>
+        [[nodiscard]] JTX_HOSTDEV size_t size() const { return get<T>().size(); }
+
+    private:
+        friend Handle;
+
+        template<typename T>
+        using AllocatorFor = Allocator;
+
+        static constexpr size_t STRIDES[] = {sizeof(Ts)...};
+
+        template<typename T>
+        JTX_HOSTDEV vector<T> &get() { return std::get<vector<T>>(storage); }
+
+        template<typename T>
+        JTX_HOSTDEV const vector<T> &get() const { return std::get<vector<T>>(storage); }
+
+        template<typename T>
+        JTX_HOST void update() {
+            constexpr unsigned int t = Handle::template tagIndex<T>() - 1;
+            bases[t] = get<T>().data();
+            sizes[t] = static_cast<uint32_t>(get<T>().size());
+        }
+
+        std::tuple<vector<Ts>...> storage;
+        const void *bases[sizeof...(Ts)] = {};
+        uint32_t sizes[sizeof...(Ts)] = {};
+    };
+}
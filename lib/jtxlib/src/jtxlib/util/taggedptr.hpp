@@ -1,6 +1,8 @@
 #pragma once
 
 #include <tuple>
+#include <type_traits>
+#include <utility>
 #include <jtxlib.hpp>
 #include <jtxlib/util/assert.hpp>
 
@@ -10,257 +12,61 @@
 */
 namespace jtx {
     namespace detail {
-        //region const dispatch
-        template<typename F, typename R, typename T>
-        JTX_HOSTDEV R dispatch(F &&f, const void *ptr, int tag) {
-            ASSERT(tag == 0);
-            return f((const T *)ptr);
-        }
-
-        template<typename F, typename R, typename T0, typename T1>
-        JTX_HOSTDEV R dispatch(F &&f, const void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 1);
-            if (tag == 0) {
-                return f((const T0 *)ptr);
-            } else {
-                return f((const T1 *)ptr);
-            }
-        }
-
-        template<typename F, typename R, typename T0, typename T1, typename T2>
-        JTX_HOSTDEV R dispatch(F &&f, const void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 2);
-            switch(tag) {
-                case 0:
-                    return f((const T0 *)ptr);
-                case 1:
-                    return f((const T1 *)ptr);
+        // T, const if Ptr points to const
+        template<typename T, typename Ptr>
+        using MatchConst = std::conditional_t<std::is_const_v<std::remove_pointer_t<Ptr>>, const T, T>;
+
+        template<size_t I, typename... Ts>
+        using NthType = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+        // ptr is const void * for const dispatch and the type gets the same qualifier
+        template<typename R, typename F, typename Ptr, size_t I, typename... Ts>
+        JTX_HOSTDEV JTX_INLINE R dispatchCall(F &f, Ptr ptr) {
+            return f(static_cast<MatchConst<NthType<I, Ts...>, Ptr> *>(ptr));
+        }
+
+#define JTX_DISPATCH_CASE(K)                                                                                \
+    case K:                                                                                                 \
+        if constexpr (Base + K < sizeof...(Ts) - 1) return dispatchCall<R, F, Ptr, Base + K, Ts...>(f, ptr); \
+        break;
+
+        /**
+         * Calls f with ptr cast to the tag-th type in Ts, for tags from Base on.
+         *
+         * Same layout as PBRTv4: one switch per block of 8 types, which compilers turn into a jump table with f
+         * inlined into every case, so dispatch costs one range check and an indirect jump per block rather than
+         * a compare per type. The last type takes the fall-through, so every path returns f's result directly
+         * and results can be void, references, move-only or not default constructible.
+         */
+        template<typename R, typename F, typename Ptr, size_t Base, typename... Ts>
+        JTX_HOSTDEV R dispatchFrom(F &f, Ptr ptr, const unsigned int tag) {
+            switch (tag - Base) {
+                JTX_DISPATCH_CASE(0)
+                JTX_DISPATCH_CASE(1)
+                JTX_DISPATCH_CASE(2)
+                JTX_DISPATCH_CASE(3)
+                JTX_DISPATCH_CASE(4)
+                JTX_DISPATCH_CASE(5)
+                JTX_DISPATCH_CASE(6)
+                JTX_DISPATCH_CASE(7)
                 default:
-                    return f((const T2 *)ptr);
+                    break;
             }
-        }
-
-        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3>
-        JTX_HOSTDEV R dispatch(F &&f, const void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 3);
-            switch(tag) {
-                case 0:
-                    return f((const T0 *)ptr);
-                case 1:
-                    return f((const T1 *)ptr);
-                case 2:
-                    return f((const T2 *)ptr);
-                default:
-                    return f((const T3 *)ptr);
-            }
-        }
-
-        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3, typename T4>
-        JTX_HOSTDEV R dispatch(F &&f, const void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 4);
-            switch(tag) {
-                case 0:
-                    return f((const T0 *)ptr);
-                case 1:
-                    return f((const T1 *)ptr);
-                case 2:
-                    return f((const T2 *)ptr);
-                case 3:
-                    return f((const T3 *)ptr);
-                default:
-                    return f((const T4 *)ptr);
-            }
-        }
-
-        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3, typename T4, typename T5>
-        JTX_HOSTDEV R dispatch(F &&f, const void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 5);
-            switch(tag) {
-                case 0:
-                    return f((const T0 *)ptr);
-                case 1:
-                    return f((const T1 *)ptr);
-                case 2:
-                    return f((const T2 *)ptr);
-                case 3:
-                    return f((const T3 *)ptr);
-                case 4:
-                    return f((const T4 *)ptr);
-                default:
-                    return f((const T5 *)ptr);
-            }
-        }
-
-        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
-        JTX_HOSTDEV R dispatch(F &&f, const void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 6);
-            switch(tag) {
-                case 0:
-                    return f((const T0 *)ptr);
-                case 1:
-                    return f((const T1 *)ptr);
-                case 2:
-                    return f((const T2 *)ptr);
-                case 3:
-                    return f((const T3 *)ptr);
-                case 4:
-                    return f((const T4 *)ptr);
-                case 5:
-                    return f((const T5 *)ptr);
-                default:
-                    return f((const T6 *)ptr);
-            }
-        }
-
-        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
-        JTX_HOSTDEV R dispatch(F &&f, const void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 7);
-            switch(tag) {
-                case 0:
-                    return f((const T0 *)ptr);
-                case 1:
-                    return f((const T1 *)ptr);
-                case 2:
-                    return f((const T2 *)ptr);
-                case 3:
-                    return f((const T3 *)ptr);
-                case 4:
-                    return f((const T4 *)ptr);
-                case 5:
-                    return f((const T5 *)ptr);
-                case 6:
-                    return f((const T6 *)ptr);
-                default:
-                    return f((const T7 *)ptr);
-            }
-        }
-        //endregion
-
-        //region non-const dispatch
-        template<typename F, typename R, typename T>
-        JTX_HOSTDEV R dispatch(F &&f, void *ptr, int tag) {
-            ASSERT(tag == 0);
-            return f((T *)ptr);
-        }
-
-        template<typename F, typename R, typename T0, typename T1>
-        JTX_HOSTDEV R dispatch(F &&f, void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 1);
-            if (tag == 0) {
-                return f((T0 *)ptr);
+            if constexpr (Base + 8 < sizeof...(Ts)) {
+                return dispatchFrom<R, F, Ptr, Base + 8, Ts...>(f, ptr, tag);
             } else {
-                return f((T1 *)ptr);
-            }
-        }
-
-        template<typename F, typename R, typename T0, typename T1, typename T2>
-        JTX_HOSTDEV R dispatch(F &&f, void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 2);
-            switch(tag) {
-                case 0:
-                    return f((T0 *)ptr);
-                case 1:
-                    return f((T1 *)ptr);
-                default:
-                    return f((T2 *)ptr);
-            }
-        }
-
-        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3>
-        JTX_HOSTDEV R dispatch(F &&f, void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 3);
-            switch(tag) {
-                case 0:
-                    return f((T0 *)ptr);
-                case 1:
-                    return f((T1 *)ptr);
-                case 2:
-                    return f((T2 *)ptr);
-                default:
-                    return f((T3 *)ptr);
-            }
-        }
-
-        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3, typename T4>
-        JTX_HOSTDEV R dispatch(F &&f, void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 4);
-            switch(tag) {
-                case 0:
-                    return f((T0 *)ptr);
-                case 1:
-                    return f((T1 *)ptr);
-                case 2:
-                    return f((T2 *)ptr);
-                case 3:
-                    return f((T3 *)ptr);
-                default:
-                    return f((T4 *)ptr);
-            }
-        }
-
-        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3, typename T4, typename T5>
-        JTX_HOSTDEV R dispatch(F &&f, void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 5);
-            switch(tag) {
-                case 0:
-                    return f((T0 *)ptr);
-                case 1:
-                    return f((T1 *)ptr);
-                case 2:
-                    return f((T2 *)ptr);
-                case 3:
-                    return f((T3 *)ptr);
-                case 4:
-                    return f((T4 *)ptr);
-                default:
-                    return f((T5 *)ptr);
+                ASSERT(tag == sizeof...(Ts) - 1);
+                return dispatchCall<R, F, Ptr, sizeof...(Ts) - 1, Ts...>(f, ptr);
             }
         }
 
-        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
-        JTX_HOSTDEV R dispatch(F &&f, void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 6);
-            switch(tag) {
-                case 0:
-                    return f((T0 *)ptr);
-                case 1:
-                    return f((T1 *)ptr);
-                case 2:
-                    return f((T2 *)ptr);
-                case 3:
-                    return f((T3 *)ptr);
-                case 4:
-                    return f((T4 *)ptr);
-                case 5:
-                    return f((T5 *)ptr);
-                default:
-                    return f((T6 *)ptr);
-            }
-        }
+#undef JTX_DISPATCH_CASE
 
-        template<typename F, typename R, typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
-        JTX_HOSTDEV R dispatch(F &&f, void *ptr, int tag) {
-            ASSERT(tag >= 0 && tag <= 7);
-            switch(tag) {
-                case 0:
-                    return f((T0 *)ptr);
-                case 1:
-                    return f((T1 *)ptr);
-                case 2:
-                    return f((T2 *)ptr);
-                case 3:
-                    return f((T3 *)ptr);
-                case 4:
-                    return f((T4 *)ptr);
-                case 5:
-                    return f((T5 *)ptr);
-                case 6:
-                    return f((T6 *)ptr);
-                default:
-                    return f((T7 *)ptr);
-            }
+        template<typename R, typename F, typename Ptr, typename... Ts>
+        JTX_HOSTDEV R dispatch(F &f, Ptr ptr, const unsigned int tag) {
+            ASSERT(tag < sizeof...(Ts));
+            return dispatchFrom<R, F, Ptr, 0, Ts...>(f, ptr, tag);
         }
-        //endregion
 
         template<typename... Ts>
         struct IsSameType;
@@ -382,18 +188,36 @@ namespace jtx {
         else return 1 + getTagIndex<Tp, Ts...>();
       }
 
+      // Largest valid tag; tags run from 1 to maxTag(), 0 is nullptr
+      JTX_HOSTDEV static constexpr unsigned int maxTag() { return sizeof...(Ts); }
+
       template <typename F>
       JTX_HOSTDEV decltype(auto) dispatch(F &&f) {
         ASSERT(getPtr() != nullptr);
         using R = typename detail::ReturnType<F, Ts...>::type;
-        return detail::dispatch<F, R, Ts...>(f, getPtr(), getTag() - 1);
+        return detail::dispatch<R, std::remove_reference_t<F>, void *, Ts...>(f, getPtr(), getTag() - 1);
       }
 
       template <typename F>
       JTX_HOSTDEV decltype(auto) dispatch(F &&f) const {
         ASSERT(getPtr() != nullptr);
-        using R = typename detail::ReturnType<F, Ts...>::type;
-        return detail::dispatch<F, R, Ts...>(f, getPtr(), getTag() - 1);
+        using R = typename detail::ReturnType<F, const Ts...>::type;
+        return detail::dispatch<R, std::remove_reference_t<F>, const void *, Ts...>(f, getPtr(), getTag() - 1);
+      }
+
+      /**
+       * Double dispatch: calls f(const T *, const U *) with this and other both cast, so binary operations
+       * can pick a kernel by type pair. The two dispatches nest, which gives one inlined body of f per pair.
+       * f must return the same type for every pair.
+       */
+      template <typename... Us, typename F>
+      JTX_HOSTDEV decltype(auto) dispatch(const TaggedPtr<Us...> &other, F &&f) const {
+        ASSERT(other.getPtr() != nullptr);
+        auto outer = [&](auto a) -> decltype(auto) {
+          auto inner = [&](auto b) -> decltype(auto) { return f(a, b); };
+          return other.dispatch(inner);
+        };
+        return dispatch(outer);
       }
 
     private:
@@ -408,6 +232,7 @@ namespace jtx {
       static constexpr int TAG_BITS      = 64 - TAG_SHIFT;
       static constexpr uint64_t TAG_MASK = ((1ull << TAG_BITS) - 1) << TAG_SHIFT;
       static constexpr uint64_t PTR_MASK = ~TAG_MASK;
+      static_assert(sizeof...(Ts) < (1u << TAG_BITS), "More types than the tag bits can index");
 
       template <typename T, typename U, typename ...Us>
       JTX_HOSTDEV static constexpr int getTagIndex() {
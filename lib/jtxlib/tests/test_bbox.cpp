@@ -252,6 +252,40 @@ TEST_CASE("BB3f bounding sphere", "[BB3f]") {
     REQUIRE(center == jtx::Point3f{2.0f, 2.0f, 2.0f});
     REQUIRE(radius == std::sqrt(3.0f));
 }
+
+TEST_CASE("BB3f intersectP", "[BB3f]") {
+    jtx::BBox3f bb(jtx::Point3f{-1.0f, -1.0f, -1.0f}, jtx::Point3f{1.0f, 1.0f, 1.0f});
+    float t0, t1;
+
+    SECTION("Ray through the box reports the entry and exit distances") {
+        REQUIRE(bb.intersectP(jtx::Point3f{-3.0f, 0.0f, 0.0f}, jtx::Vec3f{1.0f, 0.0f, 0.0f}, jtx::INFINITY_F, &t0, &t1));
+        REQUIRE_THAT(t0, Catch::Matchers::WithinAbs(2.0f, T_EPS));
+        REQUIRE_THAT(t1, Catch::Matchers::WithinAbs(4.0f, T_EPS));
+    }
+
+    SECTION("Origin inside the box starts at 0") {
+        REQUIRE(bb.intersectP(jtx::Point3f{0.0f, 0.0f, 0.0f}, jtx::Vec3f{0.0f, 1.0f, 0.0f}, jtx::INFINITY_F, &t0, &t1));
+        REQUIRE(t0 == 0.0f);
+        REQUIRE_THAT(t1, Catch::Matchers::WithinAbs(1.0f, T_EPS));
+    }
+
+    SECTION("Misses") {
+        REQUIRE_FALSE(bb.intersectP(jtx::Point3f{-3.0f, 2.0f, 0.0f}, jtx::Vec3f{1.0f, 0.0f, 0.0f}));
+        REQUIRE_FALSE(bb.intersectP(jtx::Point3f{-3.0f, 0.0f, 0.0f}, jtx::Vec3f{-1.0f, 0.0f, 0.0f}));
+        REQUIRE_FALSE(bb.intersectP(jtx::Point3f{-3.0f, 0.0f, 0.0f}, jtx::Vec3f{1.0f, 0.0f, 0.0f}, 1.5f));
+    }
+
+    SECTION("Precomputed inverse direction agrees") {
+        const jtx::Point3f o{-3.0f, 0.5f, 0.25f};
+        for (const jtx::Vec3f d : {jtx::Vec3f{1.0f, 0.0f, 0.0f}, jtx::Vec3f{1.0f, -0.2f, 0.1f},
+                                   jtx::Vec3f{-1.0f, 0.0f, 0.0f}, jtx::Vec3f{1.0f, 1.0f, 0.0f}}) {
+            const jtx::Vec3f invDir(1 / d.x, 1 / d.y, 1 / d.z);
+            const int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+            REQUIRE(bb.intersectP(o, jtx::INFINITY_F, invDir, dirIsNeg) == bb.intersectP(o, d));
+            REQUIRE(bb.intersectP(o, 1.0f, invDir, dirIsNeg) == bb.intersectP(o, d, 1.0f));
+        }
+    }
+}
 //endregion
 
 //region BB3f static functions
@@ -0,0 +1,496 @@
+#include <catch2/catch_test_macros.hpp>
+#include <jtxlib/accel/bvh.hpp>
+#include <jtxlib/accel/bvh8.hpp>
+#include <jtxlib/accel/raysort.hpp>
+#include <jtxlib/accel/tlas.hpp>
+#include "trandom.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace jtx;
+
+namespace {
+    // Small random boxes in the unit cube, used as their own primitives
+    std::vector<BBox3f> randomBoxes(const size_t n, const uint32_t seed, const float size = 0.02f) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> u(0, 1);
+        std::vector<BBox3f> boxes;
+        for (size_t i = 0; i < n; ++i) {
+            const Point3f p{u(rng), u(rng), u(rng)};
+            boxes.emplace_back(p, p + Vec3f{size * u(rng), size * u(rng), size * u(rng)});
+        }
+        return boxes;
+    }
+
+    struct Hit {
+        float t = INFINITY_F;
+        int64_t index = -1;
+    };
+
+    Hit closestBruteForce(const std::vector<BBox3f> &boxes, const Rayf &ray) {
+        Hit hit;
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            float t0;
+            if (boxes[i].intersectP(ray.origin, ray.dir, hit.t, &t0) && t0 < hit.t) hit = {t0, int64_t(i)};
+        }
+        return hit;
+    }
+
+    template<typename Accel>
+    Hit closestBVH(const Accel &bvh, const std::vector<BBox3f> &boxes, const Rayf &ray,
+                   BVHTraversalStats *stats = nullptr) {
+        Hit hit;
+        bvh.intersect(ray, INFINITY_F, [&](const uint32_t i, float &tMax) {
+            float t0;
+            if (!boxes[i].intersectP(ray.origin, ray.dir, tMax, &t0) || t0 >= tMax) return false;
+            tMax = t0;
+            hit = {t0, int64_t(i)};
+            return true;
+        }, stats);
+        return hit;
+    }
+
+    template<typename Accel>
+    bool anyHitBVH(const Accel &bvh, const std::vector<BBox3f> &boxes, const Rayf &ray) {
+        return bvh.intersectP(ray, INFINITY_F, [&](const uint32_t i, const float tMax) {
+            return boxes[i].intersectP(ray.origin, ray.dir, tMax);
+        });
+    }
+
+    // Every primitive in exactly one leaf, every node's bounds enclosing what is below it, and no path deeper than the
+    // traversal stack
+    void checkStructure(const BVH &bvh, const std::vector<BBox3f> &boxes, const int maxPrimsInNode) {
+        const span<const LinearBVHNode> nodes = bvh.getNodes();
+        const span<const uint32_t> indices = bvh.getPrimitiveIndices();
+        REQUIRE(indices.size() == boxes.size());
+
+        std::vector<int> seen(boxes.size(), 0);
+        // Interior nodes above each node; children always follow their parent in the array
+        std::vector<int> depth(nodes.size(), 0);
+        for (size_t n = 0; n < nodes.size(); ++n) {
+            const LinearBVHNode &node = nodes[n];
+            REQUIRE(depth[n] <= BVH::MAX_DEPTH);
+            if (!node.isLeaf()) depth[n + 1] = depth[node.secondChildOffset] = depth[n] + 1;
+            if (node.isLeaf()) {
+                REQUIRE(node.nPrimitives <= std::max(maxPrimsInNode, 1));
+                for (uint32_t i = 0; i < node.nPrimitives; ++i) {
+                    const uint32_t p = indices[node.primitivesOffset + i];
+                    ++seen[p];
+                    REQUIRE(merge(node.bounds, boxes[p]) == node.bounds);
+                }
+            } else {
+                REQUIRE(node.secondChildOffset > n + 1);
+                REQUIRE(node.secondChildOffset < nodes.size());
+                REQUIRE(merge(node.bounds, nodes[n + 1].bounds) == node.bounds);
+                REQUIRE(merge(node.bounds, nodes[node.secondChildOffset].bounds) == node.bounds);
+            }
+        }
+        REQUIRE(std::all_of(seen.begin(), seen.end(), [](const int c) { return c == 1; }));
+    }
+}
+
+TEST_CASE("BVH structure", "[BVH]") {
+    SECTION("Empty") {
+        const BVH bvh(span<const BBox3f>{});
+        REQUIRE(bvh.getNodes().empty());
+        REQUIRE_FALSE(bvh.intersect(Rayf({0, 0, 0}, {0, 0, 1}), INFINITY_F, [](uint32_t, float &) { return true; }));
+    }
+
+    SECTION("Random boxes") {
+        const std::vector<BBox3f> boxes = randomBoxes(5000, 1);
+        const BVH bvh(boxes, 4);
+        checkStructure(bvh, boxes, 4);
+        REQUIRE(bvh.bounds().pmin.x >= 0.0f);
+        REQUIRE(bvh.memoryBytes() == bvh.getNodes().size() * sizeof(LinearBVHNode) + boxes.size() * sizeof(uint32_t));
+    }
+
+    SECTION("Coincident boxes still respect the leaf size") {
+        const std::vector<BBox3f> boxes(1000, BBox3f(Point3f{0, 0, 0}, Point3f{1, 1, 1}));
+        const BVH bvh(boxes, 4);
+        checkStructure(bvh, boxes, 4);
+    }
+
+    SECTION("Large enough for the parallel build paths") {
+        const std::vector<BBox3f> boxes = randomBoxes(300000, 2, 0.001f);
+        const BVH bvh(boxes, 8);
+        checkStructure(bvh, boxes, 8);
+    }
+}
+
+TEST_CASE("BVH traversal matches brute force", "[BVH]") {
+    const std::vector<BBox3f> boxes = randomBoxes(2000, 3);
+    const BVH bvh(boxes, 4);
+
+    int hits = 0;
+    for (const Rayf &ray : randomRays(500, 4)) {
+        const Hit expected = closestBruteForce(boxes, ray), actual = closestBVH(bvh, boxes, ray);
+        REQUIRE(actual.index == expected.index);
+        REQUIRE(actual.t == expected.t);
+
+        const bool any = anyHitBVH(bvh, boxes, ray);
+        REQUIRE(any == (expected.index >= 0));
+        hits += any;
+    }
+    // Make sure the rays actually exercise both outcomes
+    REQUIRE(hits > 50);
+    REQUIRE(hits < 500);
+}
+
+TEST_CASE("LBVH", "[BVH]") {
+    const BVHBuildMethod methods[] = {BVHBuildMethod::LBVH, BVHBuildMethod::TreeletLBVH};
+
+    SECTION("Single primitive") {
+        const std::vector<BBox3f> boxes{BBox3f(Point3f{0, 0, 0}, Point3f{1, 1, 1})};
+        for (const BVHBuildMethod method : methods) checkStructure(BVH(boxes, 4, method), boxes, 4);
+    }
+
+    SECTION("Coincident boxes") {
+        // Every Morton code is equal, so the tree comes entirely from the index tie-break
+        const std::vector<BBox3f> boxes(1000, BBox3f(Point3f{0, 0, 0}, Point3f{1, 1, 1}));
+        for (const BVHBuildMethod method : methods) checkStructure(BVH(boxes, 4, method), boxes, 4);
+    }
+
+    SECTION("Structure and traversal") {
+        const std::vector<BBox3f> boxes = randomBoxes(3000, 8);
+        const std::vector<Rayf> rays = randomRays(300, 9);
+        for (const BVHBuildMethod method : methods) {
+            for (const int maxPrims : {1, 4}) {
+                const BVH bvh(boxes, maxPrims, method);
+                checkStructure(bvh, boxes, maxPrims);
+                REQUIRE(bvh.bounds() == BVH(boxes).bounds());
+
+                for (const Rayf &ray : rays) {
+                    const Hit expected = closestBruteForce(boxes, ray), actual = closestBVH(bvh, boxes, ray);
+                    REQUIRE(actual.index == expected.index);
+                    REQUIRE(actual.t == expected.t);
+                    REQUIRE(anyHitBVH(bvh, boxes, ray) == (expected.index >= 0));
+                }
+            }
+        }
+    }
+
+    SECTION("Large enough for parallel flattening") {
+        const std::vector<BBox3f> boxes = randomBoxes(300000, 10, 0.001f);
+        for (const BVHBuildMethod method : methods) checkStructure(BVH(boxes, 4, method), boxes, 4);
+    }
+
+    SECTION("Large enough for 63-bit codes") {
+        // The builder switches to 63-bit Morton codes at 2^20 primitives
+        const std::vector<BBox3f> boxes = randomBoxes(1 << 20, 11, 0.0005f);
+        const std::vector<Rayf> rays = randomRays(30, 12);
+        for (const BVHBuildMethod method : methods) {
+            const BVH bvh(boxes, 4, method);
+            checkStructure(bvh, boxes, 4);
+            for (const Rayf &ray : rays) REQUIRE(closestBVH(bvh, boxes, ray).t == closestBruteForce(boxes, ray).t);
+        }
+    }
+}
+
+TEST_CASE("BVH depth is bounded", "[BVH]") {
+    // Centroids whose 63-bit Morton codes are 1, 2, 4, ..., 2^62 make the LBVH radix tree a chain, and 2^20 coincident
+    // boxes at the origin hang below its deepest end
+    std::vector<BBox3f> boxes(1 << 20, BBox3f(Point3f{0, 0, 0}));
+    for (int level = 0; level < 21; ++level) {
+        const float f = std::ldexp(1.0f, level - 21);
+        for (const Point3f &p : {Point3f{f, 0, 0}, Point3f{0, f, 0}, Point3f{0, 0, f}}) boxes.emplace_back(p);
+    }
+    boxes.emplace_back(Point3f{1, 1, 1});
+
+    const std::vector<Rayf> rays{Rayf({0.1f, 0.1f, -1}, {-0.1f, -0.1f, 1}), Rayf({-1, 0, 0}, {1, 0, 0}),
+                                 Rayf({0.5f, 0.5f, -1}, {0.5f, 0.5f, 2})};
+    for (const BVHBuildMethod method : {BVHBuildMethod::SAH, BVHBuildMethod::LBVH, BVHBuildMethod::TreeletLBVH}) {
+        const BVH bvh(boxes, 4, method);
+        checkStructure(bvh, boxes, 4);
+        // Coincident boxes tie, so only the distance is compared
+        for (const Rayf &ray : rays) REQUIRE(closestBVH(bvh, boxes, ray).t == closestBruteForce(boxes, ray).t);
+    }
+}
+
+TEST_CASE("BVH8 collapse", "[BVH8]") {
+    SECTION("Empty") {
+        const BVH8 bvh8(BVH(span<const BBox3f>{}));
+        REQUIRE(bvh8.getNodes().empty());
+        REQUIRE_FALSE(bvh8.intersect(Rayf({0, 0, 0}, {0, 0, 1}), INFINITY_F, [](uint32_t, float &) { return true; }));
+    }
+
+    SECTION("Single primitive") {
+        const std::vector<BBox3f> boxes{BBox3f(Point3f{0, 0, 0}, Point3f{1, 1, 1})};
+        const BVH8 bvh8{BVH(boxes)};
+        REQUIRE(bvh8.getNodes().size() == 1);
+        REQUIRE(bvh8.getNodes()[0].nChildren == 1);
+        REQUIRE(closestBVH(bvh8, boxes, Rayf({0.5f, 0.5f, -1}, {0, 0, 1})).index == 0);
+        REQUIRE(closestBVH(bvh8, boxes, Rayf({2, 0.5f, -1}, {0, 0, 1})).index == -1);
+    }
+
+    SECTION("Structure") {
+        const std::vector<BBox3f> boxes = randomBoxes(20000, 5);
+        const BVH bvh(boxes, 4);
+        const BVH8 bvh8(bvh);
+        REQUIRE(bvh8.bounds() == bvh.bounds());
+        REQUIRE(bvh8.memoryBytes() < bvh.memoryBytes());
+
+        const span<const BVH8Node> nodes = bvh8.getNodes();
+        const span<const uint32_t> indices = bvh8.getPrimitiveIndices();
+        std::vector<int> seen(boxes.size(), 0), parents(nodes.size(), 0);
+        for (size_t n = 0; n < nodes.size(); ++n) {
+            const BVH8Node &node = nodes[n];
+            REQUIRE(node.nChildren >= 1);
+            for (int i = 0; i < BVH8Node::WIDTH; ++i) {
+                const BBox3f b = node.childBounds(i);
+                if (i >= node.nChildren) {
+                    // Unused slots are inverted so they never hit
+                    for (int a = 0; a < 3; ++a) REQUIRE(node.lo[a][i] > node.hi[a][i]);
+                } else if (node.isLeaf(i)) {
+                    for (uint32_t k = 0; k < node.nPrimitives[i]; ++k) {
+                        const uint32_t p = indices[node.child[i] + k];
+                        ++seen[p];
+                        REQUIRE(merge(b, boxes[p]) == b);
+                    }
+                } else {
+                    // Children follow their parent depth-first and are referenced once
+                    REQUIRE(node.child[i] > n);
+                    REQUIRE(node.child[i] < nodes.size());
+                    ++parents[node.child[i]];
+                    const BVH8Node &child = nodes[node.child[i]];
+                    for (int k = 0; k < child.nChildren; ++k) REQUIRE(merge(b, child.childBounds(k)) == b);
+                }
+            }
+        }
+        REQUIRE(std::all_of(seen.begin(), seen.end(), [](const int c) { return c == 1; }));
+        REQUIRE(parents[0] == 0);
+        REQUIRE(std::all_of(parents.begin() + 1, parents.end(), [](const int c) { return c == 1; }));
+    }
+}
+
+TEST_CASE("BVH8 traversal matches BVH", "[BVH8]") {
+    const std::vector<BBox3f> boxes = randomBoxes(2000, 6);
+    const BVH bvh(boxes, 4);
+    const BVH8 bvh8(bvh);
+
+    BVHTraversalStats binaryStats, wideStats;
+    for (const Rayf &ray : randomRays(500, 7)) {
+        const Hit expected = closestBVH(bvh, boxes, ray, &binaryStats);
+        const Hit actual = closestBVH(bvh8, boxes, ray, &wideStats);
+        REQUIRE(actual.index == expected.index);
+        REQUIRE(actual.t == expected.t);
+        REQUIRE(anyHitBVH(bvh8, boxes, ray) == (expected.index >= 0));
+    }
+    REQUIRE(wideStats.nodesVisited < binaryStats.nodesVisited);
+}
+
+TEST_CASE("BVH refit", "[BVH]") {
+    const std::vector<BBox3f> boxes = randomBoxes(3000, 11);
+    const std::vector<Rayf> rays = randomRays(300, 12);
+
+    SECTION("Unchanged bounds keep the tree") {
+        BVH bvh(boxes, 4);
+        const float cost = bvh.sahCost();
+        REQUIRE(cost > 0);
+        bvh.refit(boxes);
+        checkStructure(bvh, boxes, 4);
+        REQUIRE(bvh.sahCost() == cost);
+        REQUIRE(bvh.sahCostRatio() == 1.0f);
+    }
+
+    SECTION("Moved primitives") {
+        // Every box jumps somewhere else, about the worst a refit can see
+        const std::vector<BBox3f> moved = randomBoxes(boxes.size(), 13);
+        for (const BVHBuildMethod method : {BVHBuildMethod::SAH, BVHBuildMethod::LBVH}) {
+            BVH refit(boxes, 4, method), rotated(boxes, 4, method);
+            refit.refit(moved);
+            rotated.refit(moved, true);
+
+            for (const BVH *bvh : {&refit, &rotated}) {
+                checkStructure(*bvh, moved, 4);
+                REQUIRE(bvh->bounds() == BVH(moved).bounds());
+                for (const Rayf &ray : rays) {
+                    const Hit expected = closestBruteForce(moved, ray), actual = closestBVH(*bvh, moved, ray);
+                    REQUIRE(actual.index == expected.index);
+                    REQUIRE(actual.t == expected.t);
+                    REQUIRE(anyHitBVH(*bvh, moved, ray) == (expected.index >= 0));
+                }
+            }
+            REQUIRE(refit.sahCostRatio() > 2.0f);
+            // Rotations only ever lower the cost
+            REQUIRE(rotated.sahCost() < refit.sahCost());
+        }
+    }
+
+    SECTION("Many rotating refits") {
+        // Each frame relinks and lays the tree out again; it must stay valid and within the traversal stack throughout
+        BVH bvh(boxes, 4);
+        for (uint32_t frame = 0; frame < 20; ++frame) {
+            const std::vector<BBox3f> moved = randomBoxes(boxes.size(), 100 + frame);
+            bvh.refit(moved, true);
+            checkStructure(bvh, moved, 4);
+            for (size_t r = 0; r < rays.size(); r += 10) {
+                REQUIRE(closestBVH(bvh, moved, rays[r]).index == closestBruteForce(moved, rays[r]).index);
+            }
+        }
+    }
+
+    SECTION("Large enough for the parallel refit") {
+        const std::vector<BBox3f> large = randomBoxes(300000, 14, 0.001f);
+        std::vector<BBox3f> moved = large;
+        for (BBox3f &b : moved) b = BBox3f(b.pmin * 0.5f, b.pmax * 0.5f + Vec3f{0, b.pmax.x, 0});
+        BVH bvh(large, 4);
+        bvh.refit(moved, true);
+        checkStructure(bvh, moved, 4);
+    }
+}
+
+TEST_CASE("TLAS", "[TLAS]") {
+    const std::vector<BBox3f> rocks = randomBoxes(400, 15, 0.05f), trees = randomBoxes(200, 16, 0.1f);
+    const BVH rockBVH(rocks, 4), treeBVH(trees, 4);
+    const BVH8 rockBVH8(rockBVH), treeBVH8(treeBVH);
+
+    // A 6x6 grid of rotated, scaled copies alternating between the two BLAS, slightly overlapping
+    std::vector<TLAS<>::Instance> instances;
+    std::vector<TLAS<BVH8>::Instance> wideInstances;
+    for (int i = 0; i < 36; ++i) {
+        const Transform t = Transform::translate(0.8f * float(i % 6), 0.8f * float(i / 6), 0.1f * float(i % 3)) *
+                            Transform::rotateZ(10.0f * float(i)) *
+                            Transform::scale(1.0f, 1.0f + 0.05f * float(i % 4), 1.0f);
+        instances.push_back({i % 2 ? &treeBVH : &rockBVH, t});
+        wideInstances.push_back({i % 2 ? &treeBVH8 : &rockBVH8, t});
+    }
+    const TLAS<> tlas(instances);
+    const TLAS<BVH8> wideTlas(wideInstances);
+
+    SECTION("Empty") {
+        const TLAS<> empty(span<const TLAS<>::Instance>{});
+        REQUIRE_FALSE(empty.intersect(Rayf({0, 0, 0}, {0, 0, 1}), INFINITY_F,
+                                      [](uint32_t, uint32_t, const Rayf &, float &) { return true; }));
+    }
+
+    SECTION("Structure") {
+        REQUIRE(tlas.getInstances().size() == instances.size());
+        checkStructure(tlas.getTopLevel(), [&] {
+            std::vector<BBox3f> bounds;
+            for (const auto &instance : instances) {
+                bounds.push_back(instance.renderFromObject.applyToBBox(instance.blas->bounds()));
+            }
+            return bounds;
+        }(), 1);
+        // Only the instances and the top level; the shared geometry is not copied
+        REQUIRE(tlas.memoryBytes() == tlas.getTopLevel().memoryBytes() + instances.size() * sizeof(TLAS<>::Instance));
+    }
+
+    SECTION("Traversal matches brute force over every instance") {
+        std::mt19937 rng(17);
+        std::uniform_real_distribution<float> u(0, 1), v(-1, 1);
+        int hits = 0;
+        for (int r = 0; r < 400; ++r) {
+            const Rayf ray(Point3f{-1.0f, 5.0f * u(rng) - 0.5f, 0.5f * u(rng)},
+                           Vec3f{1.0f, 0.3f * v(rng), 0.1f * v(rng)});
+
+            // Reference: the same object-space rays, every box of every instance
+            Hit expected;
+            int64_t expectedInstance = -1;
+            for (size_t i = 0; i < instances.size(); ++i) {
+                const Rayf objectRay = instances[i].renderFromObject.applyInverseToRay(ray);
+                const Hit h = closestBruteForce(instances[i].blas == &treeBVH ? trees : rocks, objectRay);
+                if (h.t < expected.t) {
+                    expected = h;
+                    expectedInstance = int64_t(i);
+                }
+            }
+
+            auto check = [&](const auto &accel) {
+                Hit actual;
+                int64_t actualInstance = -1;
+                auto closest = [&](const uint32_t i, const uint32_t p, const Rayf &objectRay, float &tMax) {
+                    float t0;
+                    const BBox3f &box = (i % 2 ? trees : rocks)[p];
+                    if (!box.intersectP(objectRay.origin, objectRay.dir, tMax, &t0) || t0 >= tMax) return false;
+                    tMax = t0;
+                    actual = {t0, int64_t(p)};
+                    actualInstance = i;
+                    return true;
+                };
+                accel.intersect(ray, INFINITY_F, closest);
+                REQUIRE(actualInstance == expectedInstance);
+                REQUIRE(actual.index == expected.index);
+                REQUIRE(actual.t == expected.t);
+
+                auto anyHit = [&](const uint32_t i, const uint32_t p, const Rayf &objectRay, const float tMax) {
+                    return (i % 2 ? trees : rocks)[p].intersectP(objectRay.origin, objectRay.dir, tMax);
+                };
+                REQUIRE(accel.intersectP(ray, INFINITY_F, anyHit) == (expected.index >= 0));
+            };
+            check(tlas);
+            check(wideTlas);
+            hits += expected.index >= 0;
+        }
+        REQUIRE(hits > 40);
+        REQUIRE(hits < 400);
+    }
+}
+
+TEST_CASE("Ray sorting", "[RaySort]") {
+    const BBox3f bounds(Point3f{0, 0, 0}, Point3f{1, 1, 1});
+
+    SECTION("Keys") {
+        // Octant in the top bits, then the origin's Morton code; origins outside the bounds clamp to them
+        REQUIRE(rayKey(Rayf({0, 0, 0}, {1, 1, 1}), bounds) == 0);
+        REQUIRE(rayKey(Rayf({0, 0, 0}, {-1, 1, -1}), bounds) == 5u << 27);
+        REQUIRE(rayKey(Rayf({1, 1, 1}, {1, 1, 1}), bounds) == (1u << 27) - 1);
+        REQUIRE(rayKey(Rayf({-5, 0, 0}, {1, 1, 1}), bounds) == 0);
+        REQUIRE(rayKey(Rayf({0.5f, 0, 0}, {1, 1, 1}), bounds) == encodeMorton30(256, 0, 0));
+    }
+
+    SECTION("Sorted batch") {
+        // Large enough for several radix sort chunks
+        std::mt19937 rng(18);
+        std::uniform_real_distribution<float> u(-0.1f, 1.1f), v(-1, 1);
+        std::vector<Rayf> rays;
+        for (int i = 0; i < 200000; ++i) {
+            rays.emplace_back(Point3f{u(rng), u(rng), u(rng)}, Vec3f{v(rng), v(rng), v(rng)});
+        }
+        const std::vector<Rayf> original = rays;
+        std::vector<uint32_t> order(rays.size());
+        sortRays(rays, bounds, order);
+
+        std::vector<int> seen(rays.size(), 0);
+        for (size_t i = 0; i < rays.size(); ++i) {
+            REQUIRE(rays[i] == original[order[i]]);
+            ++seen[order[i]];
+            if (i > 0) {
+                const uint32_t previous = rayKey(rays[i - 1], bounds), key = rayKey(rays[i], bounds);
+                REQUIRE(previous <= key);
+                // Stable: equal keys keep their original order
+                if (previous == key) REQUIRE(order[i - 1] < order[i]);
+            }
+        }
+        REQUIRE(std::all_of(seen.begin(), seen.end(), [](const int c) { return c == 1; }));
+    }
+
+    SECTION("Empty batch") {
+        std::vector<Rayf> rays;
+        std::vector<uint32_t> order;
+        sortRays(rays, bounds, order);
+        REQUIRE(rays.empty());
+    }
+
+    SECTION("Reused sorter") {
+        // Growing, shrinking and emptying batches through one sorter give the same result as a fresh sort
+        std::mt19937 rng(19);
+        std::uniform_real_distribution<float> u(-0.1f, 1.1f), v(-1, 1);
+        RaySorter sorter;
+        for (const size_t n : {1000, 100000, 7, 0, 50000}) {
+            std::vector<Rayf> rays;
+            for (size_t i = 0; i < n; ++i) {
+                rays.emplace_back(Point3f{u(rng), u(rng), u(rng)}, Vec3f{v(rng), v(rng), v(rng)});
+            }
+            std::vector<Rayf> expected = rays;
+            std::vector<uint32_t> order(n), expectedOrder(n);
+            sortRays(expected, bounds, expectedOrder);
+            sorter.sort(rays, bounds, order);
+            REQUIRE(rays == expected);
+            REQUIRE(order == expectedOrder);
+        }
+    }
+}
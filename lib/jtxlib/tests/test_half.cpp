@@ -0,0 +1,60 @@
+#include <jtxlib/math/half.hpp>
+#include <cmath>
+#include <limits>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace jtx;
+
+TEST_CASE("Half exact values", "[Half]") {
+    REQUIRE(floatToHalf(0.0f) == 0x0000);
+    REQUIRE(floatToHalf(-0.0f) == 0x8000);
+    REQUIRE(floatToHalf(1.0f) == 0x3C00);
+    REQUIRE(floatToHalf(-2.0f) == 0xC000);
+    REQUIRE(floatToHalf(65504.0f) == 0x7BFF);
+    REQUIRE(floatToHalf(0.5f) == 0x3800);
+
+    REQUIRE(halfToFloat(0x3C00) == 1.0f);
+    REQUIRE(halfToFloat(0xC000) == -2.0f);
+    REQUIRE(halfToFloat(0x7BFF) == 65504.0f);
+    // Smallest subnormal
+    REQUIRE(halfToFloat(0x0001) == std::ldexp(1.0f, -24));
+}
+
+TEST_CASE("Half special values", "[Half]") {
+    REQUIRE(floatToHalf(std::numeric_limits<float>::infinity()) == 0x7C00);
+    REQUIRE(floatToHalf(-std::numeric_limits<float>::infinity()) == 0xFC00);
+    // Overflow rounds to infinity
+    REQUIRE(floatToHalf(1e6f) == 0x7C00);
+    REQUIRE(std::isnan(halfToFloat(floatToHalf(std::numeric_limits<float>::quiet_NaN()))));
+    REQUIRE(std::isinf(halfToFloat(0x7C00)));
+}
+
+TEST_CASE("Half round trip", "[Half]") {
+    SECTION("Every finite half converts back to itself") {
+        for (uint32_t h = 0; h < 0x10000; ++h) {
+            if ((h & 0x7C00) == 0x7C00) continue;
+            REQUIRE(floatToHalf(halfToFloat(static_cast<uint16_t>(h))) == h);
+        }
+    }
+
+    SECTION("Rounding error is within half an ulp") {
+        for (float f = 1e-3f; f < 6e4f; f *= 1.0137f) {
+            const float r = halfToFloat(floatToHalf(f));
+            REQUIRE(std::abs(r - f) <= std::abs(f) * 0x1.0p-11f);
+        }
+    }
+
+    SECTION("Ties round to even") {
+        // 1 + 2^-11 is halfway between 1 and the next half; 1 has the even mantissa
+        REQUIRE(floatToHalf(1.0f + 0x1.0p-11f) == 0x3C00);
+        REQUIRE(floatToHalf(1.0f + 3 * 0x1.0p-11f) == 0x3C02);
+    }
+
+    SECTION("Batch conversion matches scalar") {
+        uint16_t src[37];
+        float dst[37];
+        for (int i = 0; i < 37; ++i) src[i] = floatToHalf(static_cast<float>(i) * 0.37f - 5.0f);
+        halfToFloat(src, dst, 37);
+        for (int i = 0; i < 37; ++i) REQUIRE(dst[i] == halfToFloat(src[i]));
+    }
+}
@@ -0,0 +1,123 @@
+#include <catch2/catch_test_macros.hpp>
+#include <jtxlib/accel/hashgrid.hpp>
+#include "trandom.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+using namespace jtx;
+
+namespace {
+    // Every point appears once, cells tile the sorted points, and each point sits in its own cell
+    void checkLayout(const HashGrid &grid, const std::vector<Point3f> &points) {
+        REQUIRE(grid.size() == points.size());
+        const span<const HashGridCell> cells = grid.getCells();
+        REQUIRE((cells.size() & (cells.size() - 1)) == 0);
+        REQUIRE(cells.size() >= 2 * points.size());
+
+        std::vector<int> covered(points.size(), 0);
+        for (const HashGridCell &cell : cells) {
+            if (cell.key == 0) {
+                REQUIRE(cell.count == 0);
+                continue;
+            }
+            REQUIRE(cell.count > 0);
+            for (uint32_t i = cell.start; i < cell.start + cell.count; ++i) {
+                ++covered[i];
+                REQUIRE(grid.findCell(grid.getPoints()[i]) == &cell);
+            }
+        }
+        REQUIRE(std::all_of(covered.begin(), covered.end(), [](const int c) { return c == 1; }));
+
+        std::vector<int> seen(points.size(), 0);
+        for (size_t i = 0; i < points.size(); ++i) {
+            const uint32_t index = grid.getPointIndices()[i];
+            REQUIRE(grid.getPoints()[i] == points[index]);
+            ++seen[index];
+        }
+        REQUIRE(std::all_of(seen.begin(), seen.end(), [](const int s) { return s == 1; }));
+    }
+
+    std::vector<uint32_t> radiusBruteForce(const std::vector<Point3f> &points, const Point3f &p, const float radius) {
+        std::vector<uint32_t> found;
+        for (size_t i = 0; i < points.size(); ++i) {
+            if (distanceSqr(points[i], p) <= radius * radius) found.push_back(uint32_t(i));
+        }
+        return found;
+    }
+}
+
+TEST_CASE("HashGrid layout", "[HashGrid]") {
+    SECTION("Empty") {
+        const HashGrid grid(span<const Point3f>{}, 0.1f);
+        REQUIRE(grid.size() == 0);
+        REQUIRE(grid.findCell(Point3f{0, 0, 0}) == nullptr);
+        int found = 0;
+        grid.radiusSearch(Point3f{0, 0, 0}, [&](uint32_t, float) { ++found; });
+        REQUIRE(found == 0);
+    }
+
+    SECTION("Random points, built in parallel") {
+        // Negative coordinates too, so cells on both sides of the origin are covered
+        const std::vector<Point3f> points = randomPoints(100000, 1, -1, 1);
+        const HashGrid grid(points, 0.05f);
+        checkLayout(grid, points);
+        REQUIRE(grid.memoryBytes() == grid.getCells().size() * sizeof(HashGridCell) + points.size() * 16);
+    }
+
+    SECTION("Clustered points share cells") {
+        std::vector<Point3f> points(1000, Point3f{0.5f, 0.5f, 0.5f});
+        points.emplace_back(2.5f, 0.5f, 0.5f);
+        const HashGrid grid(points, 1.0f);
+        checkLayout(grid, points);
+        REQUIRE(grid.findCell(Point3f{0.9f, 0.1f, 0.2f})->count == 1000);
+        REQUIRE(grid.findCell(Point3f{2, 0, 0})->count == 1);
+        REQUIRE(grid.findCell(Point3f{1.5f, 0.5f, 0.5f}) == nullptr);
+    }
+
+    SECTION("Rebuild reuses the grid") {
+        HashGrid grid(0.1f);
+        for (const size_t n : {size_t(5000), size_t(5000), size_t(20000), size_t(300), size_t(0), size_t(700)}) {
+            const std::vector<Point3f> points = randomPoints(n, uint32_t(n) + 7);
+            grid.build(points);
+            checkLayout(grid, points);
+        }
+    }
+}
+
+TEST_CASE("HashGrid radius search matches brute force", "[HashGrid]") {
+    const std::vector<Point3f> points = randomPoints(20000, 2, -1, 1);
+    // Queries inside and around the point bounds
+    const std::vector<Point3f> queries = randomPoints(300, 3, -1.2f, 1.2f);
+
+    for (const float radius : {0.03f, 0.1f, 0.5f}) {
+        const HashGrid grid(points, radius);
+        for (const Point3f &q : queries) {
+            std::vector<uint32_t> actual;
+            grid.radiusSearch(q, [&](const uint32_t index, const float d2) {
+                REQUIRE(d2 == distanceSqr(points[index], q));
+                actual.push_back(index);
+            });
+            std::sort(actual.begin(), actual.end());
+            REQUIRE(actual == radiusBruteForce(points, q, radius));
+        }
+
+        // Points exactly on cell boundaries and at the radius
+        const Point3f corner{radius * 3, radius * -2, 0};
+        const std::vector<Point3f> edges{corner, corner + Vec3f{radius, 0, 0}, corner - Vec3f{0, 0, radius}};
+        const HashGrid edgeGrid(edges, radius);
+        int found = 0;
+        edgeGrid.radiusSearch(corner, [&](uint32_t, float) { ++found; });
+        REQUIRE(found == int(radiusBruteForce(edges, corner, radius).size()));
+    }
+
+    SECTION("Batch queries") {
+        const HashGrid grid(points, 0.1f);
+        std::vector<std::atomic<int>> found(queries.size());
+        grid.radiusSearch(queries, [&](const size_t q, uint32_t, float) { found[q].fetch_add(1); });
+        for (size_t q = 0; q < queries.size(); ++q) {
+            REQUIRE(found[q].load() == int(radiusBruteForce(points, queries[q], 0.1f).size()));
+        }
+    }
+}
@@ -0,0 +1,179 @@
+#include <catch2/catch_test_macros.hpp>
+#include <jtxlib/accel/kdtree.hpp>
+#include "trandom.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+using namespace jtx;
+
+namespace {
+    // The k nearest by brute force, nearest first, ties broken by index
+    std::vector<KdTreeNeighbor> knnBruteForce(const std::vector<Point3f> &points, const Point3f &p, const size_t k,
+                                              const float maxDistanceSqr = INFINITY_F) {
+        // Sorted as pairs; std::sort on jtx types is ambiguous between std::swap and jtx::swap
+        std::vector<std::pair<float, uint32_t>> all;
+        for (size_t i = 0; i < points.size(); ++i) {
+            const float d2 = distanceSqr(points[i], p);
+            if (d2 <= maxDistanceSqr) all.emplace_back(d2, uint32_t(i));
+        }
+        std::sort(all.begin(), all.end());
+        std::vector<KdTreeNeighbor> nearest;
+        for (size_t i = 0; i < std::min(all.size(), k); ++i) nearest.push_back({all[i].second, all[i].first});
+        return nearest;
+    }
+
+    // Every point is stored once, and each subtree lies on its side of its ancestors' splits
+    void checkStructure(const KdTree &tree, const std::vector<Point3f> &points) {
+        const span<const KdTreeNode> nodes = tree.getNodes();
+        REQUIRE(nodes.size() == points.size());
+        std::vector<int> seen(points.size(), 0);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            REQUIRE(nodes[i].index() < points.size());
+            REQUIRE(nodes[i].p == points[nodes[i].index()]);
+            ++seen[nodes[i].index()];
+
+            const int axis = nodes[i].axis();
+            const float split = nodes[i].p[axis];
+            for (const size_t child : {2 * i + 1, 2 * i + 2}) {
+                std::vector<size_t> subtree{child};
+                while (!subtree.empty()) {
+                    const size_t c = subtree.back();
+                    subtree.pop_back();
+                    if (c >= nodes.size()) continue;
+                    if (child == 2 * i + 1) REQUIRE(nodes[c].p[axis] <= split);
+                    else REQUIRE(nodes[c].p[axis] >= split);
+                    subtree.push_back(2 * c + 1);
+                    subtree.push_back(2 * c + 2);
+                }
+            }
+        }
+        REQUIRE(std::all_of(seen.begin(), seen.end(), [](const int s) { return s == 1; }));
+    }
+}
+
+TEST_CASE("KdTree structure", "[KdTree]") {
+    SECTION("Empty") {
+        const KdTree tree(span<const Point3f>{});
+        REQUIRE(tree.size() == 0);
+        KdTreeNeighbor neighbors[4];
+        REQUIRE(tree.knn(Point3f{0, 0, 0}, neighbors) == 0);
+        int found = 0;
+        tree.radiusSearch(Point3f{0, 0, 0}, 10.0f, [&](uint32_t, float) { ++found; });
+        REQUIRE(found == 0);
+    }
+
+    SECTION("Every size up to a few levels") {
+        // Covers each way the last level can split between the two subtrees
+        for (size_t n = 1; n <= 70; ++n) {
+            const std::vector<Point3f> points = randomPoints(n, uint32_t(n));
+            const KdTree tree(points);
+            checkStructure(tree, points);
+            REQUIRE(tree.memoryBytes() == n * sizeof(KdTreeNode));
+        }
+    }
+
+    SECTION("Large, built in parallel") {
+        const std::vector<Point3f> points = randomPoints(200000, 1);
+        const KdTree tree(points);
+        checkStructure(tree, points);
+        BBox3f bounds;
+        for (const Point3f &p : points) bounds.merge(p);
+        REQUIRE(tree.bounds() == bounds);
+    }
+
+    SECTION("Duplicate points") {
+        const std::vector<Point3f> points(500, Point3f{0.5f, 0.5f, 0.5f});
+        const KdTree tree(points);
+        checkStructure(tree, points);
+        KdTreeNeighbor neighbors[8];
+        REQUIRE(tree.knn(Point3f{0, 0, 0}, neighbors) == 8);
+        REQUIRE(neighbors[7].distanceSqr == 0.75f);
+    }
+}
+
+TEST_CASE("KdTree queries match brute force", "[KdTree]") {
+    const std::vector<Point3f> points = randomPoints(5000, 2);
+    const KdTree tree(points);
+    // Queries inside and around the point bounds
+    std::vector<Point3f> queries = randomPoints(200, 3);
+    for (Point3f &q : queries) q = q * 1.4f - Vec3f{0.2f, 0.2f, 0.2f};
+
+    SECTION("k nearest") {
+        for (const size_t k : {size_t(1), size_t(8), size_t(50)}) {
+            std::vector<KdTreeNeighbor> neighbors(k);
+            for (const Point3f &q : queries) {
+                const std::vector<KdTreeNeighbor> expected = knnBruteForce(points, q, k);
+                REQUIRE(tree.knn(q, neighbors) == k);
+                for (size_t i = 0; i < k; ++i) {
+                    // Ties may come back in either order, the distances may not
+                    REQUIRE(neighbors[i].distanceSqr == expected[i].distanceSqr);
+                    REQUIRE(distanceSqr(points[neighbors[i].index], q) == neighbors[i].distanceSqr);
+                }
+            }
+        }
+    }
+
+    SECTION("k nearest within a radius") {
+        std::vector<KdTreeNeighbor> neighbors(30);
+        for (const Point3f &q : queries) {
+            const std::vector<KdTreeNeighbor> expected = knnBruteForce(points, q, 30, 0.01f);
+            const size_t count = tree.knn(q, neighbors, 0.01f);
+            REQUIRE(count == expected.size());
+            for (size_t i = 0; i < count; ++i) REQUIRE(neighbors[i].distanceSqr == expected[i].distanceSqr);
+        }
+    }
+
+    SECTION("More neighbors than points") {
+        const std::vector<Point3f> few = randomPoints(5, 4);
+        std::vector<KdTreeNeighbor> neighbors(10);
+        REQUIRE(KdTree(few).knn(Point3f{0, 0, 0}, neighbors) == 5);
+        REQUIRE(std::is_sorted(neighbors.begin(), neighbors.begin() + 5, [](const auto &a, const auto &b) {
+            return a.distanceSqr < b.distanceSqr;
+        }));
+    }
+
+    SECTION("Radius search") {
+        for (const float radius : {0.0f, 0.05f, 0.2f}) {
+            for (const Point3f &q : queries) {
+                std::vector<uint32_t> expected, actual;
+                for (size_t i = 0; i < points.size(); ++i) {
+                    if (distanceSqr(points[i], q) <= radius * radius) expected.push_back(uint32_t(i));
+                }
+                tree.radiusSearch(q, radius, [&](const uint32_t index, const float d2) {
+                    REQUIRE(d2 == distanceSqr(points[index], q));
+                    actual.push_back(index);
+                });
+                std::sort(actual.begin(), actual.end());
+                REQUIRE(actual == expected);
+            }
+        }
+        // Every stored point finds itself at radius 0
+        for (size_t i = 0; i < 100; ++i) {
+            int found = 0;
+            tree.radiusSearch(points[i], 0.0f, [&](const uint32_t index, float) { found += index == i; });
+            REQUIRE(found == 1);
+        }
+    }
+
+    SECTION("Batch queries") {
+        const int k = 6;
+        std::vector<KdTreeNeighbor> neighbors(queries.size() * k);
+        std::vector<uint32_t> counts(queries.size());
+        tree.knn(queries, k, neighbors, counts);
+        for (size_t q = 0; q < queries.size(); ++q) {
+            std::vector<KdTreeNeighbor> single(k);
+            REQUIRE(counts[q] == tree.knn(queries[q], single));
+            for (int i = 0; i < k; ++i) REQUIRE(neighbors[q * k + i].distanceSqr == single[i].distanceSqr);
+        }
+
+        std::vector<std::atomic<int>> found(queries.size());
+        tree.radiusSearch(queries, 0.1f, [&](const size_t q, uint32_t, float) { found[q].fetch_add(1); });
+        for (size_t q = 0; q < queries.size(); ++q) {
+            int expected = 0;
+            tree.radiusSearch(queries[q], 0.1f, [&](uint32_t, float) { ++expected; });
+            REQUIRE(found[q].load() == expected);
+        }
+    }
+}
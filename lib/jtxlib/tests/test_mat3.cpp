@@ -0,0 +1,47 @@
+#include <jtxlib/math/mat3.hpp>
+#include "tconstants.h"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+TEST_CASE("Mat3 constructors", "[Mat3]") {
+    REQUIRE(jtx::Mat3{1.0f}.isIdentity());
+    REQUIRE(jtx::Mat3::identity().isIdentity());
+    REQUIRE(jtx::Mat3{1, 0, 0, 0, 1, 0, 0, 0, 1}.isIdentity());
+
+    jtx::Mat3 zero;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) REQUIRE(zero[i][j] == 0.0f);
+    }
+
+    jtx::Mat3 d = jtx::Mat3::diagonal(1, 2, 3);
+    REQUIRE(d == jtx::Mat3{1, 0, 0, 0, 2, 0, 0, 0, 3});
+    REQUIRE(d != jtx::Mat3::identity());
+}
+
+TEST_CASE("Mat3 mul", "[Mat3]") {
+    jtx::Mat3 a{1, 2, 3, 4, 5, 6, 7, 8, 9};
+    jtx::Mat3 b{9, 8, 7, 6, 5, 4, 3, 2, 1};
+
+    REQUIRE(a.mul(jtx::Vec3f{1, 0, -1}) == jtx::Vec3f{-2, -2, -2});
+    REQUIRE(a * jtx::Vec3f{1, 1, 1} == jtx::Vec3f{6, 15, 24});
+    REQUIRE(a * b == jtx::Mat3{30, 24, 18, 84, 69, 54, 138, 114, 90});
+    REQUIRE(a * jtx::Mat3::identity() == a);
+    REQUIRE(2.0f * a == jtx::Mat3{2, 4, 6, 8, 10, 12, 14, 16, 18});
+}
+
+TEST_CASE("Mat3 transpose and determinant", "[Mat3]") {
+    jtx::Mat3 a{1, 2, 3, 4, 5, 6, 7, 8, 10};
+    REQUIRE(a.transpose() == jtx::Mat3{1, 4, 7, 2, 5, 8, 3, 6, 10});
+    REQUIRE_THAT(a.determinant(), Catch::Matchers::WithinAbs(-3.0f, T_EPS));
+    REQUIRE_THAT(jtx::Mat3::diagonal(2, 3, 4).determinant(), Catch::Matchers::WithinAbs(24.0f, T_EPS));
+}
+
+TEST_CASE("Mat3 inverse", "[Mat3]") {
+    jtx::Mat3 a{1, 2, 3, 4, 5, 6, 7, 8, 10};
+    auto inv = a.inverse();
+    REQUIRE(inv.has_value());
+    REQUIRE(jtx::equals(a * *inv, jtx::Mat3::identity(), T_EPS));
+    REQUIRE(jtx::equals(*inv * a, jtx::Mat3::identity(), T_EPS));
+
+    REQUIRE_FALSE(jtx::Mat3{1, 2, 3, 4, 5, 6, 7, 8, 9}.inverse().has_value());
+}
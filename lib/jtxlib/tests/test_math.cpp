@@ -16,4 +16,27 @@ TEST_CASE("Fast exp gives sames result as std::exp", "[Math]") {
     float result = jtx::fastExp(2.5f);
 
     REQUIRE_THAT(result, Catch::Matchers::WithinRel(ref, T_EPS));
-}
\ No newline at end of file
+}
+
+TEST_CASE("Morton codes interleave the coordinate bits", "[Math]") {
+    // Reference: bit b of x, y, z goes to bit 3b, 3b + 1, 3b + 2
+    auto reference = [](const uint32_t x, const uint32_t y, const uint32_t z, const int bits) {
+        uint64_t code = 0;
+        for (int b = 0; b < bits; ++b) {
+            code |= uint64_t((x >> b) & 1) << (3 * b);
+            code |= uint64_t((y >> b) & 1) << (3 * b + 1);
+            code |= uint64_t((z >> b) & 1) << (3 * b + 2);
+        }
+        return code;
+    };
+
+    uint32_t state = 1;
+    for (int i = 0; i < 1000; ++i) {
+        state = state * 1664525u + 1013904223u;
+        const uint32_t x = state >> 11, y = (state * 7u) >> 11, z = (state * 13u) >> 11;
+        REQUIRE(jtx::encodeMorton30(x & 0x3ff, y & 0x3ff, z & 0x3ff) == reference(x, y, z, 10));
+        REQUIRE(jtx::encodeMorton63(x, y, z) == reference(x, y, z, 21));
+    }
+    REQUIRE(jtx::encodeMorton30(1023, 1023, 1023) == (1u << 30) - 1);
+    REQUIRE(jtx::encodeMorton63(0x1fffff, 0x1fffff, 0x1fffff) == (uint64_t(1) << 63) - 1);
+}
@@ -1,6 +1,9 @@
 #include <jtxlib/std/memory_resource.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <cstring>
+#include <vector>
+
 // Unit tests written o1-mini with manual revisions
 
 using namespace jtx;
@@ -265,6 +268,89 @@ TEST_CASE("Memory resource behavior under stress", "[memory_resource][stress]")
 }
 #pragma endregion memory_resource
 
+#pragma region monotonic_buffer_resource
+// Forwards to new_delete_resource and counts outstanding upstream blocks
+class counting_resource final : public memory_resource {
+public:
+    int outstanding = 0;
+    int total = 0;
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        ++outstanding;
+        ++total;
+        return new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+        --outstanding;
+        new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const memory_resource &other) const noexcept override { return this == &other; }
+};
+
+TEST_CASE("monotonic_buffer_resource allocation", "[monotonic_buffer_resource]") {
+    counting_resource upstream;
+    monotonic_buffer_resource mr(256, &upstream);
+    REQUIRE(mr.upstream_resource() == &upstream);
+
+    SECTION("Allocations respect alignment and do not overlap") {
+        std::vector<std::pair<char *, size_t>> blocks;
+        for (size_t i = 1; i <= 64; ++i) {
+            const size_t alignment = size_t(1) << (i % 7);
+            auto *p = static_cast<char *>(mr.allocate(i * 3, alignment));
+            REQUIRE(p != nullptr);
+            REQUIRE(is_aligned(p, alignment));
+            std::memset(p, static_cast<int>(i), i * 3);
+            blocks.emplace_back(p, i * 3);
+        }
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            for (size_t j = 0; j < blocks[i].second; ++j) REQUIRE(blocks[i].first[j] == static_cast<char>(i + 1));
+        }
+    }
+
+    SECTION("Small allocations share upstream blocks") {
+        for (int i = 0; i < 32; ++i) (void) mr.allocate(sizeof(int), alignof(int));
+        REQUIRE(upstream.total == 1);
+    }
+
+    SECTION("Requests larger than the next block size get their own block") {
+        void *p = mr.allocate(10000);
+        REQUIRE(p != nullptr);
+        REQUIRE(is_aligned(p, max_align));
+        REQUIRE(upstream.outstanding == 1);
+    }
+
+    SECTION("Deallocate is a no-op") {
+        void *p = mr.allocate(64);
+        mr.deallocate(p, 64);
+        REQUIRE(upstream.outstanding == 1);
+    }
+
+    SECTION("Release returns all blocks upstream") {
+        for (int i = 0; i < 100; ++i) (void) mr.allocate(100);
+        REQUIRE(upstream.outstanding > 1);
+        mr.release();
+        REQUIRE(upstream.outstanding == 0);
+        REQUIRE(mr.allocate(16) != nullptr);
+        REQUIRE(upstream.outstanding == 1);
+    }
+}
+
+TEST_CASE("monotonic_buffer_resource destructor releases memory", "[monotonic_buffer_resource]") {
+    counting_resource upstream;
+    {
+        monotonic_buffer_resource mr(&upstream);
+        polymorphic_allocator<int> alloc(&mr);
+        pmr_vector<int> v(alloc);
+        for (int i = 0; i < 1000; ++i) v.push_back(i);
+        for (int i = 0; i < 1000; ++i) REQUIRE(v[i] == i);
+        REQUIRE(upstream.outstanding > 0);
+    }
+    REQUIRE(upstream.outstanding == 0);
+}
+#pragma endregion monotonic_buffer_resource
+
 #pragma region polymorphic_allocator
 TEST_CASE("polymorphic_allocator constructors", "[polymorphic_allocator][constructors]") {
     memory_resource* custom_mr = null_memory_resource();
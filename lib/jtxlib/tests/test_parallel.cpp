@@ -0,0 +1,46 @@
+#include <catch2/catch_test_macros.hpp>
+#include <jtxlib/util/parallel.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+using namespace jtx;
+
+TEST_CASE("parallelFor covers every index once", "[Parallel]") {
+    std::vector<std::atomic<int>> counts(10007);
+    parallelFor(0, counts.size(), 100, [&](const size_t b, const size_t e) {
+        REQUIRE(e - b <= 100);
+        for (size_t i = b; i < e; ++i) counts[i].fetch_add(1);
+    });
+    REQUIRE(std::all_of(counts.begin(), counts.end(), [](const std::atomic<int> &c) { return c.load() == 1; }));
+
+    SECTION("Empty range") {
+        bool called = false;
+        parallelFor(5, 5, 1, [&](size_t, size_t) { called = true; });
+        REQUIRE_FALSE(called);
+    }
+}
+
+TEST_CASE("parallelInvoke runs both and nests", "[Parallel]") {
+    std::atomic<int> sum{0};
+    parallelInvoke([&] {
+        parallelFor(0, 1000, 10, [&](const size_t b, const size_t e) { sum.fetch_add(int(e - b)); });
+    }, [&] {
+        parallelInvoke([&] { sum.fetch_add(1); }, [&] { sum.fetch_add(2); });
+    });
+    REQUIRE(sum.load() == 1003);
+}
+
+TEST_CASE("Thread limit", "[Parallel]") {
+    setMaxThreads(1);
+    REQUIRE(maxThreads() == 1);
+
+    std::vector<int> order;
+    // With one thread everything runs inline, in order
+    parallelFor(0, 4, 1, [&](const size_t b, size_t) { order.push_back(int(b)); });
+    REQUIRE(order == std::vector<int>{0, 1, 2, 3});
+
+    setMaxThreads(0);
+    REQUIRE(maxThreads() >= 1);
+}
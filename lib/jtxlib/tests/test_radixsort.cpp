@@ -0,0 +1,52 @@
+#include <catch2/catch_test_macros.hpp>
+#include <jtxlib/util/radixsort.hpp>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace jtx;
+
+TEST_CASE("radixSort", "[RadixSort]") {
+    std::mt19937_64 rng(11);
+
+    SECTION("Matches a stable sort, across chunk boundaries") {
+        for (const size_t n : {size_t(0), size_t(1), size_t(1000), size_t(200001)}) {
+            for (const int keyBits : {30, 63}) {
+                std::vector<uint64_t> keys(n);
+                std::vector<uint32_t> values(n);
+                for (size_t i = 0; i < n; ++i) {
+                    // Few distinct keys so stability matters
+                    keys[i] = (rng() % 5000) << (keyBits - 13);
+                    values[i] = static_cast<uint32_t>(i);
+                }
+
+                std::vector<std::pair<uint64_t, uint32_t>> expected(n);
+                for (size_t i = 0; i < n; ++i) expected[i] = {keys[i], values[i]};
+                std::stable_sort(expected.begin(), expected.end(),
+                                 [](const auto &x, const auto &y) { return x.first < y.first; });
+
+                radixSort(span<uint64_t>(keys), span<uint32_t>(values), keyBits);
+                bool same = true;
+                for (size_t i = 0; i < n; ++i) same &= keys[i] == expected[i].first && values[i] == expected[i].second;
+                REQUIRE(same);
+            }
+        }
+    }
+
+    SECTION("32-bit keys with an odd number of passes") {
+        // Only the top byte varies, so three passes are skipped and one scatter leaves data in scratch
+        std::vector<uint32_t> keys(100000);
+        std::vector<float> values(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            keys[i] = static_cast<uint32_t>(rng() & 0xff) << 24;
+            values[i] = static_cast<float>(keys[i]);
+        }
+        radixSort(span<uint32_t>(keys), span<float>(values));
+        REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+        bool same = true;
+        for (size_t i = 0; i < keys.size(); ++i) same &= values[i] == static_cast<float>(keys[i]);
+        REQUIRE(same);
+    }
+}
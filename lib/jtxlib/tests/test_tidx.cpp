@@ -0,0 +1,90 @@
+#include <catch2/catch_test_macros.hpp>
+#include <jtxlib/util/taggedindex.hpp>
+
+#include <vector>
+
+using namespace jtx;
+
+struct Sphere {
+    float radius;
+
+    [[nodiscard]] float size() const { return radius; }
+
+    void scale(const float s) { radius *= s; }
+};
+
+struct Box {
+    float width, height;
+
+    [[nodiscard]] float size() const { return width * height; }
+
+    void scale(const float s) {
+        width *= s;
+        height *= s;
+    }
+};
+
+using Shape = TaggedIndex<Sphere, Box>;
+
+TEST_CASE("TaggedIndex layout", "[TaggedIndex]") {
+    STATIC_REQUIRE(sizeof(Shape) == sizeof(uint32_t));
+    STATIC_REQUIRE(Shape::TAG_BITS == 2);
+    STATIC_REQUIRE(Shape::INDEX_BITS == 30);
+
+    SECTION("Tags and indices") {
+        Shape s = Shape::create<Box>(12345);
+        REQUIRE(s.getTag() == 2);
+        REQUIRE(s.getIndex() == 12345);
+        REQUIRE(s.is<Box>());
+        REQUIRE_FALSE(s.is<Sphere>());
+
+        Shape last = Shape::create<Sphere>(Shape::INDEX_MASK);
+        REQUIRE(last.getTag() == 1);
+        REQUIRE(last.getIndex() == Shape::INDEX_MASK);
+    }
+
+    SECTION("Null handle") {
+        Shape s{nullptr};
+        REQUIRE_FALSE(s);
+        REQUIRE(s.getTag() == 0);
+        REQUIRE(s == Shape{});
+    }
+}
+
+TEST_CASE("TaggedIndex resolves through arenas", "[TaggedIndex]") {
+    Shape::Arenas arenas;
+    std::vector<Shape> handles;
+    for (int i = 0; i < 100; ++i) {
+        // Enough elements that both vectors grow and move several times
+        handles.push_back(i % 3 == 0 ? arenas.emplace<Box>(float(i), 2.0f) : arenas.emplace<Sphere>(float(i)));
+    }
+
+    REQUIRE(arenas.size<Box>() == 34);
+    REQUIRE(arenas.size<Sphere>() == 66);
+
+    SECTION("cast and castOrNp") {
+        REQUIRE(handles[3].cast<Box>(arenas)->width == 3.0f);
+        REQUIRE(handles[4].cast<Sphere>(arenas)->radius == 4.0f);
+        REQUIRE(handles[4].castOrNp<Box>(arenas) == nullptr);
+        REQUIRE(handles[4].getPtr(arenas) == &arenas.view<Sphere>()[handles[4].getIndex()]);
+    }
+
+    SECTION("dispatch") {
+        for (int i = 0; i < 100; ++i) {
+            const float expected = i % 3 == 0 ? float(i) * 2.0f : float(i);
+            REQUIRE(handles[i].dispatch(arenas, [](auto p) { return p->size(); }) == expected);
+        }
+    }
+
+    SECTION("const arenas give const pointers") {
+        const Shape::Arenas &carenas = arenas;
+        auto isConst = [](auto p) { return std::is_const_v<std::remove_pointer_t<decltype(p)>>; };
+        REQUIRE(handles[0].dispatch(carenas, isConst));
+        REQUIRE_FALSE(handles[0].dispatch(arenas, isConst));
+    }
+
+    SECTION("Writes through dispatch land in the arena") {
+        handles[1].dispatch(arenas, [](auto p) { p->scale(0.5f); });
+        REQUIRE(arenas.view<Sphere>()[handles[1].getIndex()].radius == 0.5f);
+    }
+}
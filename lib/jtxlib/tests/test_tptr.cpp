@@ -1,5 +1,10 @@
 #include <catch2/catch_test_macros.hpp>
 #include <jtxlib/util/taggedptr.hpp>
+#include <jtxlib/util/batchdispatch.hpp>
+
+#include <memory>
+#include <tuple>
+#include <vector>
 
 // Simple CRTP class to test tagged pointer dispatch
 using namespace jtx;
@@ -51,6 +56,11 @@ TEST_CASE("TaggedPtr default constructor", "[TaggedPtr]") {
     REQUIRE(ptr.getTag() == 0);
     REQUIRE(ptr.getPtr() == nullptr);
   }
+
+  SECTION("maxTag == number of types") {
+    REQUIRE(TaggedPtr<Square, Circle>::maxTag() == 2);
+    REQUIRE(TaggedPtr<Square>::maxTag() == 1);
+  }
 }
 
 
@@ -70,4 +80,135 @@ TEST_CASE("TaggedPtr dispatch", "[TaggedPtr]") {
     auto i = ptr.dispatch(code);
     REQUIRE(i == 1);
   }
-}
\ No newline at end of file
+}
+
+template<int N>
+class Numbered {
+public:
+    int value = N;
+
+    [[nodiscard]] int code() const { return N; }
+};
+
+template<size_t... Is>
+auto makeNumbered(std::index_sequence<Is...>) -> TaggedPtr<Numbered<Is>...>;
+
+// More types than the old hand-written dispatch supported
+using ManyPtr = decltype(makeNumbered(std::make_index_sequence<20>{}));
+
+template<size_t... Is>
+void checkAllTags(std::index_sequence<Is...>) {
+    std::tuple<Numbered<Is>...> objects;
+    auto code = [](auto p) { return p->code(); };
+    const int codes[] = {ManyPtr(&std::get<Is>(objects)).dispatch(code)...};
+    for (int i = 0; i < int(sizeof...(Is)); ++i) REQUIRE(codes[i] == i);
+}
+
+TEST_CASE("TaggedPtr dispatch over many types", "[TaggedPtr]") {
+    REQUIRE(ManyPtr::maxTag() == 20);
+
+    SECTION("Every tag reaches its type") {
+        checkAllTags(std::make_index_sequence<20>{});
+    }
+
+    Numbered<17> n17;
+    ManyPtr ptr{&n17};
+
+    SECTION("Const dispatch passes const pointers") {
+        const ManyPtr &cptr = ptr;
+        auto isConst = [](auto p) { return std::is_const_v<std::remove_pointer_t<decltype(p)>>; };
+        REQUIRE(cptr.dispatch(isConst));
+        REQUIRE_FALSE(ptr.dispatch(isConst));
+    }
+
+    SECTION("Void and reference results") {
+        int seen = -1;
+        ptr.dispatch([&](auto p) { seen = p->code(); });
+        REQUIRE(seen == 17);
+
+        int &value = ptr.dispatch([](auto p) -> int & { return p->value; });
+        value = 42;
+        REQUIRE(n17.value == 42);
+    }
+
+    SECTION("Move-only, non-default-constructible and rvalue reference results") {
+        std::unique_ptr<int> owned = ptr.dispatch([](auto p) { return std::make_unique<int>(p->code()); });
+        REQUIRE(*owned == 17);
+
+        struct NoDefault {
+            explicit NoDefault(const int code) : code(code) {}
+            int code;
+        };
+        REQUIRE(ptr.dispatch([](auto p) { return NoDefault(p->code()); }).code == 17);
+
+        int &&moved = ptr.dispatch([](auto p) -> int && { return std::move(p->value); });
+        REQUIRE(&moved == &n17.value);
+    }
+}
+
+TEST_CASE("Batch dispatch groups handles by type", "[TaggedPtr]") {
+    using Ptr = TaggedPtr<Square, Circle>;
+    Square square{};
+    Circle circle{};
+    std::vector<Ptr> handles = {Ptr{&circle}, Ptr{&square}, Ptr{nullptr}, Ptr{&circle}, Ptr{&square}, Ptr{&circle}};
+
+    SECTION("One call per type, in tag order, with input positions") {
+        std::vector<int> codes(handles.size(), 0);
+        std::vector<size_t> groupSizes;
+        dispatchBatch(span<Ptr>(handles), [&](auto ptrs, span<const uint32_t> indices) {
+            REQUIRE(ptrs.size() == indices.size());
+            groupSizes.push_back(ptrs.size());
+            for (size_t k = 0; k < ptrs.size(); ++k) {
+                REQUIRE(ptrs[k] == handles[indices[k]].getPtr());
+                codes[indices[k]] = ptrs[k]->code();
+            }
+        });
+
+        REQUIRE(groupSizes == std::vector<size_t>{2, 3});
+        REQUIRE(codes == std::vector<int>{1, 2, 0, 1, 2, 1});
+    }
+
+    SECTION("Permutation is stable and lists null handles first") {
+        BatchDispatcher<Ptr> dispatcher;
+        dispatcher.dispatch(span<const Ptr>(handles), [](auto ptrs, span<const uint32_t>) {
+            using T = std::remove_pointer_t<typename decltype(ptrs)::value_type>;
+            STATIC_REQUIRE(std::is_const_v<T>);
+        });
+
+        const span<const uint32_t> perm = dispatcher.permutation();
+        REQUIRE(std::vector<uint32_t>(perm.begin(), perm.end()) == std::vector<uint32_t>{2, 1, 4, 0, 3, 5});
+        REQUIRE(dispatcher.nullIndices().size() == 1);
+        REQUIRE(dispatcher.nullIndices()[0] == 2);
+    }
+
+    SECTION("Empty input makes no calls") {
+        int calls = 0;
+        dispatchBatch(span<Ptr>(), [&](auto, span<const uint32_t>) { ++calls; });
+        REQUIRE(calls == 0);
+    }
+}
+
+TEST_CASE("TaggedPtr double dispatch", "[TaggedPtr]") {
+    using Ptr = TaggedPtr<Square, Circle>;
+    Square square{};
+    Circle circle{};
+    const Ptr s{&square}, c{&circle};
+
+    // Kernels picked by overloading on the type pair
+    struct Kernel {
+        int operator()(const Square *, const Square *) const { return 22; }
+        int operator()(const Circle *a, const Square *b) const { return 10 * a->code() + b->code(); }
+        int operator()(const Square *, const Circle *) const { return -1; }
+        int operator()(const Circle *, const Circle *) const { return 11; }
+    };
+
+    REQUIRE(s.dispatch(s, Kernel{}) == 22);
+    REQUIRE(c.dispatch(s, Kernel{}) == 12);
+    REQUIRE(s.dispatch(c, Kernel{}) == -1);
+    REQUIRE(c.dispatch(c, Kernel{}) == 11);
+
+    SECTION("Handles of different TaggedPtr types") {
+        const TaggedPtr<Circle> other{&circle};
+        REQUIRE(s.dispatch(other, [](auto a, auto b) { return a->code() - b->code(); }) == 1);
+    }
+}
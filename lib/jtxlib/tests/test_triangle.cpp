@@ -0,0 +1,243 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <jtxlib/accel/bvh.hpp>
+#include <jtxlib/geometry/triangle.hpp>
+#include <jtxlib/geometry/trianglemesh.hpp>
+#include "trandom.h"
+
+#include <random>
+#include <vector>
+
+using namespace jtx;
+using Catch::Matchers::WithinAbs;
+using Catch::Matchers::WithinRel;
+
+namespace {
+    struct RandomTriangle {
+        Point3f p0, p1, p2;
+    };
+
+    std::vector<RandomTriangle> randomTriangles(const size_t n, const uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> u(0, 1), v(-0.1f, 0.1f);
+        std::vector<RandomTriangle> tris;
+        for (size_t i = 0; i < n; ++i) {
+            const Point3f c{u(rng), u(rng), u(rng)};
+            tris.push_back({c + Vec3f{v(rng), v(rng), v(rng)}, c + Vec3f{v(rng), v(rng), v(rng)},
+                            c + Vec3f{v(rng), v(rng), v(rng)}});
+        }
+        return tris;
+    }
+
+    // An n x n grid of unit quads in the z = 0 plane, two triangles each
+    TriangleMesh gridMesh(const int n) {
+        std::vector<Point3f> positions;
+        std::vector<Point2f> uvs;
+        for (int j = 0; j <= n; ++j) {
+            for (int i = 0; i <= n; ++i) {
+                positions.emplace_back(float(i), float(j), 0.0f);
+                uvs.emplace_back(float(i) / float(n), float(j) / float(n));
+            }
+        }
+        std::vector<uint32_t> indices;
+        for (int j = 0; j < n; ++j) {
+            for (int i = 0; i < n; ++i) {
+                const auto v = static_cast<uint32_t>(j * (n + 1) + i);
+                const uint32_t right = v + 1, up = v + n + 1, diagonal = up + 1;
+                indices.insert(indices.end(), {v, right, diagonal, v, diagonal, up});
+            }
+        }
+        return {positions, indices, {}, uvs};
+    }
+}
+
+TEST_CASE("Watertight triangle intersection", "[Triangle]") {
+    const Point3f p0{0, 0, 1}, p1{1, 0, 1}, p2{0, 1, 1};
+
+    SECTION("Hit with barycentrics") {
+        TriangleIntersection isect;
+        REQUIRE(intersectTriangle(Rayf({0.25f, 0.5f, 0}, {0, 0, 1}), p0, p1, p2, INFINITY_F, &isect));
+        REQUIRE_THAT(isect.t, WithinAbs(1.0f, 1e-6));
+        REQUIRE_THAT(isect.b0, WithinAbs(0.25f, 1e-6));
+        REQUIRE_THAT(isect.b1, WithinAbs(0.25f, 1e-6));
+        REQUIRE_THAT(isect.b2, WithinAbs(0.5f, 1e-6));
+    }
+
+    SECTION("Two-sided") {
+        TriangleIntersection isect;
+        REQUIRE(intersectTriangle(Rayf({0.25f, 0.25f, 2}, {0, 0, -1}), p0, p1, p2, INFINITY_F, &isect));
+        REQUIRE_THAT(isect.t, WithinAbs(1.0f, 1e-6));
+    }
+
+    SECTION("Misses") {
+        // Outside the triangle, behind the origin, beyond tMax, and parallel to the plane
+        REQUIRE_FALSE(intersectTriangle(Rayf({0.75f, 0.75f, 0}, {0, 0, 1}), p0, p1, p2, INFINITY_F));
+        REQUIRE_FALSE(intersectTriangle(Rayf({0.25f, 0.25f, 2}, {0, 0, 1}), p0, p1, p2, INFINITY_F));
+        REQUIRE_FALSE(intersectTriangle(Rayf({0.25f, 0.25f, 0}, {0, 0, 1}), p0, p1, p2, 0.5f));
+        REQUIRE_FALSE(intersectTriangle(Rayf({0.25f, 0.25f, 0}, {1, 0, 0}), p0, p1, p2, INFINITY_F));
+    }
+
+    SECTION("Degenerate triangles never hit") {
+        REQUIRE_FALSE(intersectTriangle(Rayf({0.5f, 0, 0}, {0, 0, 1}), p0, p1, {2, 0, 1}, INFINITY_F));
+        REQUIRE_FALSE(intersectTriangle(Rayf({0, 0, 0}, {0, 0, 1}), p0, p0, p0, INFINITY_F));
+    }
+
+    SECTION("No gaps along shared edges and vertices") {
+        // Rays through every grid vertex and edge midpoint, straight down and oblique, must hit some triangle
+        const TriangleMesh mesh = gridMesh(4);
+        int tested = 0;
+        for (int j = 1; j < 8; ++j) {
+            for (int i = 1; i < 8; ++i) {
+                const Point3f target{0.5f * float(i), 0.5f * float(j), 0};
+                for (const Vec3f &d : {Vec3f{0, 0, -1}, Vec3f{0.3f, -0.7f, -1}, Vec3f{-1, 1, -0.1f}, Vec3f{1, 1, -1}}) {
+                    const Rayf ray(target - d * 3.0f, d);
+                    const TriangleRay triangleRay(ray);
+                    bool hit = false;
+                    for (size_t t = 0; t < mesh.nTriangles(); ++t) hit |= mesh.intersect(t, triangleRay, INFINITY_F);
+                    REQUIRE(hit);
+                    ++tested;
+                }
+            }
+        }
+        REQUIRE(tested == 196);
+    }
+}
+
+TEST_CASE("Precomputed triangles match the watertight test", "[Triangle]") {
+    const std::vector<RandomTriangle> tris = randomTriangles(500, 1);
+    const std::vector<Rayf> rays = randomRays(200, 2);
+
+    int hits = 0;
+    for (const RandomTriangle &tri : tris) {
+        const PrecomputedTriangle pre(tri.p0, tri.p1, tri.p2);
+        for (const Rayf &ray : rays) {
+            TriangleIntersection expected, actual;
+            const bool hit = intersectTriangle(ray, tri.p0, tri.p1, tri.p2, INFINITY_F, &expected);
+            // The two tests only disagree within rounding of an edge
+            if (hit && std::min({expected.b0, expected.b1, expected.b2}) < 1e-4f) continue;
+            REQUIRE(pre.intersect(ray, INFINITY_F, &actual) == hit);
+            if (!hit) continue;
+            REQUIRE_THAT(actual.t, WithinRel(expected.t, 1e-4f));
+            REQUIRE_THAT(actual.b1, WithinAbs(expected.b1, 1e-4));
+            REQUIRE_THAT(actual.b2, WithinAbs(expected.b2, 1e-4));
+            ++hits;
+        }
+    }
+    REQUIRE(hits > 100);
+
+    SECTION("Every dominant axis and degenerate triangles") {
+        const Rayf alongX({-1, 0.2f, 0.2f}, {1, 0, 0}), alongY({0.2f, -1, 0.2f}, {0, 1, 0});
+        REQUIRE(PrecomputedTriangle({0, 0, 0}, {0, 1, 0}, {0, 0, 1}).intersect(alongX, INFINITY_F));
+        REQUIRE(PrecomputedTriangle({0, 0, 0}, {0, 0, 1}, {1, 0, 0}).intersect(alongY, INFINITY_F));
+        REQUIRE_FALSE(PrecomputedTriangle({0, 0, 0}, {1, 0, 0}, {2, 0, 0}).intersect(alongY, INFINITY_F));
+    }
+}
+
+TEST_CASE("Triangle8 matches the scalar test", "[Triangle]") {
+    const std::vector<RandomTriangle> tris = randomTriangles(800, 3);
+    const std::vector<Rayf> rays = randomRays(300, 4);
+
+    int hits = 0;
+    for (size_t first = 0; first < tris.size(); first += 8) {
+        // Partially filled packets too, to cover the NaN lanes
+        const int count = int(first / 8 % 8) + 1;
+        Triangle8 packet;
+        for (int lane = 0; lane < count; ++lane) {
+            const RandomTriangle &tri = tris[first + lane];
+            packet.set(lane, tri.p0, tri.p1, tri.p2, uint32_t(first + lane));
+        }
+
+        for (const Rayf &ray : rays) {
+            const TriangleRay triangleRay(ray);
+            int expectedLane = -1;
+            TriangleIntersection expected;
+            for (int lane = 0; lane < count; ++lane) {
+                const RandomTriangle &tri = tris[first + lane];
+                TriangleIntersection isect;
+                if (intersectTriangle(triangleRay, tri.p0, tri.p1, tri.p2, expected.t, &isect) &&
+                    isect.t < expected.t) {
+                    expected = isect;
+                    expectedLane = lane;
+                }
+            }
+
+            TriangleIntersection actual;
+            const int lane = intersectTriangle8(packet, triangleRay, INFINITY_F, &actual);
+            REQUIRE(lane == expectedLane);
+            if (lane < 0) continue;
+            REQUIRE(packet.index[lane] == first + lane);
+            REQUIRE_THAT(actual.t, WithinRel(expected.t, 1e-6f));
+            REQUIRE_THAT(actual.b0, WithinAbs(expected.b0, 1e-6));
+            REQUIRE_THAT(actual.b2, WithinAbs(expected.b2, 1e-6));
+            ++hits;
+
+            // tMax is honored
+            REQUIRE(intersectTriangle8(packet, triangleRay, actual.t * 0.5f) == -1);
+        }
+    }
+    REQUIRE(hits > 150);
+}
+
+TEST_CASE("Triangle8 ties go to the lowest lane", "[Triangle]") {
+    // Lane 0 is hit through its vertex, so its edge functions are zero and it takes the scalar retry; lane 1 is hit
+    // at the same distance through its interior
+    Triangle8 packet;
+    packet.set(0, {0, 0, 0}, {1, 0, 0}, {0, 1, 0}, 0);
+    packet.set(1, {-1, -1, 0}, {1, -1, 0}, {0, 1, 0}, 1);
+    const TriangleRay ray(Rayf({0, 0, -1}, {0, 0, 1}));
+    TriangleIntersection isect;
+    REQUIRE(intersectTriangle8(packet, ray, INFINITY_F, &isect) == 0);
+    REQUIRE(isect.t == 1.0f);
+}
+
+TEST_CASE("TriangleMesh", "[Triangle]") {
+    const TriangleMesh mesh = gridMesh(8);
+
+    SECTION("Storage") {
+        REQUIRE(mesh.nVertices() == 81);
+        REQUIRE(mesh.nTriangles() == 128);
+        REQUIRE(mesh.hasUVs());
+        REQUIRE_FALSE(mesh.hasNormals());
+        REQUIRE(mesh.position(10) == Point3f{1, 1, 0});
+        REQUIRE(mesh.getPositions(0)[10] == 1.0f);
+        REQUIRE(mesh.uv(80) == Point2f{1, 1});
+        REQUIRE(mesh.bounds() == BBox3f(Point3f{0, 0, 0}, Point3f{8, 8, 0}));
+        REQUIRE(mesh.triangleBounds(0) == BBox3f(Point3f{0, 0, 0}, Point3f{1, 1, 0}));
+        REQUIRE(mesh.memoryBytes() == 81 * 3 * sizeof(float) + 128 * 3 * sizeof(uint32_t) + 81 * sizeof(Point2f));
+    }
+
+    SECTION("BVH leaves as packets") {
+        std::vector<BBox3f> bounds(mesh.nTriangles());
+        mesh.triangleBounds(bounds);
+        const BVH bvh(bounds, Triangle8::WIDTH);
+
+        // One packet per leaf, addressed by the leaf's first primitive index
+        std::vector<Triangle8> packets(bvh.getPrimitiveIndices().size());
+        for (const LinearBVHNode &node : bvh.getNodes()) {
+            if (node.isLeaf()) {
+                packets[node.primitivesOffset] = mesh.pack({bvh.getPrimitiveIndices().data() + node.primitivesOffset,
+                                                            node.nPrimitives});
+            }
+        }
+
+        for (const Rayf &ray : randomRays(200, 5)) {
+            const Rayf scaled(Point3f{ray.origin.x * 8, ray.origin.y * 8, 1}, Vec3f{ray.dir.x, ray.dir.y, -1});
+            const TriangleRay triangleRay(scaled);
+
+            float expected = INFINITY_F;
+            for (size_t t = 0; t < mesh.nTriangles(); ++t) {
+                TriangleIntersection isect;
+                if (mesh.intersect(t, triangleRay, expected, &isect)) expected = isect.t;
+            }
+
+            float actual = INFINITY_F;
+            for (const LinearBVHNode &node : bvh.getNodes()) {
+                if (!node.isLeaf()) continue;
+                TriangleIntersection isect;
+                const Triangle8 &packet = packets[node.primitivesOffset];
+                if (intersectTriangle8(packet, triangleRay, actual, &isect) >= 0) actual = isect.t;
+            }
+            REQUIRE(actual == expected);
+        }
+    }
+}
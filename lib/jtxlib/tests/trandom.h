@@ -0,0 +1,31 @@
+#pragma once
+
+#include <jtxlib/math/ray.hpp>
+#include <jtxlib/math/vec3.hpp>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Random inputs shared by the acceleration structure tests
+
+// Points uniform in the cube [lo, hi]^3
+inline std::vector<jtx::Point3f> randomPoints(const size_t n, const uint32_t seed, const float lo = 0,
+                                              const float hi = 1) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(lo, hi);
+    std::vector<jtx::Point3f> points;
+    for (size_t i = 0; i < n; ++i) points.emplace_back(u(rng), u(rng), u(rng));
+    return points;
+}
+
+// Rays from below the unit cube heading up through it, tilted by up to 0.3 along x and y
+inline std::vector<jtx::Rayf> randomRays(const size_t n, const uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u(0, 1), v(-1, 1);
+    std::vector<jtx::Rayf> rays;
+    for (size_t i = 0; i < n; ++i) {
+        rays.emplace_back(jtx::Point3f{u(rng), u(rng), -0.5f}, jtx::Vec3f{0.3f * v(rng), 0.3f * v(rng), 1.0f});
+    }
+    return rays;
+}
@@ -0,0 +1,268 @@
+/**
+ * Precomputes the RGBToSpectrumTable coefficients for a color space.
+ *
+ * This is a port of rgb2spec_opt from "A Low-Dimensional Function Space for Efficient Spectral Upsampling"
+ * (Jakob & Hanika 2019), which is also what PBRTv4 uses:
+ * https://github.com/mitsuba-renderer/rgb2spec/blob/master/rgb2spec_opt.cpp
+ *
+ * The fit integrates against the same 1nm CIE and D65 tables as SpectrumToXYZ, so upsampled spectra
+ * round-trip through the renderer's own XYZ conversion.
+ *
+ * Usage: rgb2spec_opt <resolution> <output.cpp> <sRGB|DCI_P3|Rec2020>
+ */
+#include "../spectrum.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace jtx;
+
+namespace {
+    struct Gamut {
+        const char *name;
+        double r[2], g[2], b[2];
+    };
+
+    // Primaries as xy chromaticities, all with a D65 whitepoint
+    constexpr Gamut GAMUTS[] = {
+        {"sRGB", {0.64, 0.33}, {0.30, 0.60}, {0.15, 0.06}},
+        {"DCI_P3", {0.680, 0.320}, {0.265, 0.690}, {0.150, 0.060}},
+        {"Rec2020", {0.708, 0.292}, {0.170, 0.797}, {0.131, 0.046}},
+    };
+
+    constexpr double EPSILON_FD = 1e-4;
+
+    double lambdaTbl[N_DENSE_SAMPLES];
+    double rgbTbl[3][N_DENSE_SAMPLES];
+    double rgbToXYZ[3][3], xyzToRGB[3][3];
+    double xyzWhitepoint[3];
+
+    bool invert3(const double m[3][3], double out[3][3]) {
+        const double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                           m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                           m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+        if (std::abs(det) < 1e-15) return false;
+        const double inv = 1.0 / det;
+        out[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * inv;
+        out[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv;
+        out[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv;
+        out[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * inv;
+        out[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv;
+        out[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv;
+        out[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * inv;
+        out[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv;
+        out[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv;
+        return true;
+    }
+
+    void initTables(const Gamut &gamut) {
+        // Whitepoint of the illuminant, normalized to Y = 1
+        double w[3] = {0, 0, 0};
+        for (int i = 0; i < N_DENSE_SAMPLES; ++i) {
+            const float lambda = LAMBDA_MIN + static_cast<float>(i);
+            const double illum = spectra::D65()(lambda);
+            w[0] += spectra::X()(lambda) * illum;
+            w[1] += spectra::Y()(lambda) * illum;
+            w[2] += spectra::Z()(lambda) * illum;
+        }
+        const double yNorm = w[1];
+        for (double &c : w) c /= yNorm;
+
+        // Columns are the primaries in XYZ, scaled so RGB(1, 1, 1) maps to the whitepoint
+        const double *prims[3] = {gamut.r, gamut.g, gamut.b};
+        double p[3][3], pInv[3][3];
+        for (int j = 0; j < 3; ++j) {
+            p[0][j] = prims[j][0] / prims[j][1];
+            p[1][j] = 1;
+            p[2][j] = (1 - prims[j][0] - prims[j][1]) / prims[j][1];
+        }
+        invert3(p, pInv);
+        for (int j = 0; j < 3; ++j) {
+            const double s = pInv[j][0] * w[0] + pInv[j][1] * w[1] + pInv[j][2] * w[2];
+            for (int i = 0; i < 3; ++i) rgbToXYZ[i][j] = p[i][j] * s;
+        }
+        invert3(rgbToXYZ, xyzToRGB);
+        std::memcpy(xyzWhitepoint, w, sizeof(w));
+
+        for (int i = 0; i < N_DENSE_SAMPLES; ++i) {
+            const float lambda = LAMBDA_MIN + static_cast<float>(i);
+            const double xyz[3] = {spectra::X()(lambda), spectra::Y()(lambda), spectra::Z()(lambda)};
+            const double weight = spectra::D65()(lambda) / yNorm;
+            lambdaTbl[i] = lambda;
+            for (int k = 0; k < 3; ++k) {
+                rgbTbl[k][i] = 0;
+                for (int j = 0; j < 3; ++j) rgbTbl[k][i] += xyzToRGB[k][j] * xyz[j] * weight;
+            }
+        }
+    }
+
+    double sigmoid(const double x) { return 0.5 * x / std::sqrt(1.0 + x * x) + 0.5; }
+
+    double smoothstep(const double x) { return x * x * (3.0 - 2.0 * x); }
+
+    // Converts RGB (in place) to CIELAB relative to the whitepoint
+    void cieLab(double *p) {
+        double xyz[3] = {0, 0, 0};
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) xyz[i] += p[j] * rgbToXYZ[i][j];
+        }
+
+        auto f = [](const double t) {
+            constexpr double delta = 6.0 / 29.0;
+            if (t > delta * delta * delta) return std::cbrt(t);
+            return t / (delta * delta * 3.0) + (4.0 / 29.0);
+        };
+
+        const double fy = f(xyz[1] / xyzWhitepoint[1]);
+        p[0] = 116.0 * fy - 16.0;
+        p[1] = 500.0 * (f(xyz[0] / xyzWhitepoint[0]) - fy);
+        p[2] = 200.0 * (fy - f(xyz[2] / xyzWhitepoint[2]));
+    }
+
+    void evalResidual(const double *coeffs, const double *rgb, double *residual) {
+        double out[3] = {0, 0, 0};
+        for (int i = 0; i < N_DENSE_SAMPLES; ++i) {
+            // Polynomial over lambda rescaled to [0, 1]
+            const double lambda = (lambdaTbl[i] - LAMBDA_MIN) / (LAMBDA_MAX - LAMBDA_MIN);
+            double x = 0;
+            for (int k = 0; k < 3; ++k) x = x * lambda + coeffs[k];
+            const double s = sigmoid(x);
+            for (int k = 0; k < 3; ++k) out[k] += rgbTbl[k][i] * s;
+        }
+        cieLab(out);
+        std::memcpy(residual, rgb, sizeof(double) * 3);
+        cieLab(residual);
+        for (int k = 0; k < 3; ++k) residual[k] -= out[k];
+    }
+
+    void evalJacobian(const double *coeffs, const double *rgb, double jac[3][3]) {
+        double r0[3], r1[3], tmp[3];
+        for (int i = 0; i < 3; ++i) {
+            std::memcpy(tmp, coeffs, sizeof(tmp));
+            tmp[i] -= EPSILON_FD;
+            evalResidual(tmp, rgb, r0);
+
+            std::memcpy(tmp, coeffs, sizeof(tmp));
+            tmp[i] += EPSILON_FD;
+            evalResidual(tmp, rgb, r1);
+
+            for (int j = 0; j < 3; ++j) jac[j][i] = (r1[j] - r0[j]) / (2 * EPSILON_FD);
+        }
+    }
+
+    void gaussNewton(const double rgb[3], double coeffs[3], const int iterations = 15) {
+        for (int it = 0; it < iterations; ++it) {
+            double residual[3], jac[3][3], jacInv[3][3];
+            evalResidual(coeffs, rgb, residual);
+            evalJacobian(coeffs, rgb, jac);
+            // Saturated fits (e.g. black) have a vanishing jacobian, keep the current coefficients
+            if (!invert3(jac, jacInv)) return;
+
+            double r = 0;
+            for (int j = 0; j < 3; ++j) {
+                coeffs[j] -= jacInv[j][0] * residual[0] + jacInv[j][1] * residual[1] + jacInv[j][2] * residual[2];
+                r += residual[j] * residual[j];
+            }
+
+            const double maxCoeff = std::max(std::max(coeffs[0], coeffs[1]), coeffs[2]);
+            if (maxCoeff > 200) {
+                for (int j = 0; j < 3; ++j) coeffs[j] *= 200 / maxCoeff;
+            }
+            if (r < 1e-6) break;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        std::fprintf(stderr, "usage: rgb2spec_opt <resolution> <output.cpp> <sRGB|DCI_P3|Rec2020>\n");
+        return EXIT_FAILURE;
+    }
+
+    const Gamut *gamut = nullptr;
+    for (const Gamut &g : GAMUTS) {
+        if (std::strcmp(argv[3], g.name) == 0) gamut = &g;
+    }
+    if (!gamut) {
+        std::fprintf(stderr, "rgb2spec_opt: unknown gamut %s\n", argv[3]);
+        return EXIT_FAILURE;
+    }
+
+    const int res = std::atoi(argv[1]);
+    if (res < 2) {
+        std::fprintf(stderr, "rgb2spec_opt: invalid resolution %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    initTables(*gamut);
+
+    std::vector<float> scale(res);
+    for (int k = 0; k < res; ++k) scale[k] = static_cast<float>(smoothstep(smoothstep(k / double(res - 1))));
+
+    std::vector<float> out(3 * 3 * static_cast<size_t>(res) * res * res);
+    std::atomic<int> nextRow = 0;
+    auto worker = [&] {
+        for (int row = nextRow++; row < 3 * res; row = nextRow++) {
+            const int l = row / res;
+            const int j = row % res;
+            const double y = j / double(res - 1);
+            for (int i = 0; i < res; ++i) {
+                const double x = i / double(res - 1);
+
+                // Walk outwards from a moderate brightness, warm starting each solve from the previous one
+                auto solve = [&](const int k, double coeffs[3]) {
+                    const double b = scale[k];
+                    double rgb[3];
+                    rgb[l] = b;
+                    rgb[(l + 1) % 3] = x * b;
+                    rgb[(l + 2) % 3] = y * b;
+                    gaussNewton(rgb, coeffs);
+
+                    // Convert from the [0, 1] lambda parameterization back to nanometers
+                    constexpr double c0 = LAMBDA_MIN, c1 = 1.0 / (LAMBDA_MAX - LAMBDA_MIN);
+                    const double A = coeffs[0], B = coeffs[1], C = coeffs[2];
+                    const size_t idx = ((static_cast<size_t>(l) * res + k) * res + j) * res + i;
+                    out[3 * idx + 0] = static_cast<float>(A * c1 * c1);
+                    out[3 * idx + 1] = static_cast<float>(B * c1 - 2 * A * c0 * c1 * c1);
+                    out[3 * idx + 2] = static_cast<float>(C - B * c0 * c1 + A * c0 * c0 * c1 * c1);
+                };
+
+                const int start = res / 5;
+                double coeffs[3] = {0, 0, 0};
+                for (int k = start; k < res; ++k) solve(k, coeffs);
+                std::memset(coeffs, 0, sizeof(coeffs));
+                for (int k = start; k >= 0; --k) solve(k, coeffs);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    const unsigned nThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned t = 0; t < nThreads; ++t) threads.emplace_back(worker);
+    for (std::thread &t : threads) t.join();
+
+    FILE *f = std::fopen(argv[2], "w");
+    if (!f) {
+        std::fprintf(stderr, "rgb2spec_opt: could not open %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    std::fprintf(f, "// Generated by rgb2spec_opt, do not edit\n");
+    std::fprintf(f, "namespace jtx {\n");
+    std::fprintf(f, "extern const int %sToSpectrumTable_Res = %d;\n", gamut->name, res);
+    std::fprintf(f, "extern const float %sToSpectrumTable_Scale[%d] = {\n", gamut->name, res);
+    for (int i = 0; i < res; ++i) std::fprintf(f, "%.9g, ", scale[i]);
+    std::fprintf(f, "};\n");
+    std::fprintf(f, "extern const float %sToSpectrumTable_Data[3][%d][%d][%d][3] = {\n", gamut->name, res, res, res);
+    for (size_t i = 0; i < out.size(); ++i) {
+        std::fprintf(f, "%.9g,", out[i]);
+        if (i % 9 == 8) std::fprintf(f, "\n");
+    }
+    std::fprintf(f, "};\n");
+    std::fprintf(f, "}\n");
+    std::fclose(f);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+#include "color.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Generated by rgb2spec_opt at build time (see CMakeLists.txt)
+namespace jtx {
+    extern const int sRGBToSpectrumTable_Res;
+    extern const float sRGBToSpectrumTable_Scale[RGBToSpectrumTable::RES];
+    extern const RGBToSpectrumTable::CoefficientArray sRGBToSpectrumTable_Data;
+
+    extern const int DCI_P3ToSpectrumTable_Res;
+    extern const float DCI_P3ToSpectrumTable_Scale[RGBToSpectrumTable::RES];
+    extern const RGBToSpectrumTable::CoefficientArray DCI_P3ToSpectrumTable_Data;
+
+    extern const int Rec2020ToSpectrumTable_Res;
+    extern const float Rec2020ToSpectrumTable_Scale[RGBToSpectrumTable::RES];
+    extern const RGBToSpectrumTable::CoefficientArray Rec2020ToSpectrumTable_Data;
+
+    const RGBToSpectrumTable *RGBToSpectrumTable::sRGB;
+    const RGBToSpectrumTable *RGBToSpectrumTable::DCI_P3;
+    const RGBToSpectrumTable *RGBToSpectrumTable::Rec2020;
+
+    void RGBToSpectrumTable::init(Allocator alloc) {
+        ASSERT(sRGBToSpectrumTable_Res == RES);
+        ASSERT(DCI_P3ToSpectrumTable_Res == RES);
+        ASSERT(Rec2020ToSpectrumTable_Res == RES);
+
+        sRGB = alloc.new_object<RGBToSpectrumTable>(sRGBToSpectrumTable_Scale, &sRGBToSpectrumTable_Data);
+        DCI_P3 = alloc.new_object<RGBToSpectrumTable>(DCI_P3ToSpectrumTable_Scale, &DCI_P3ToSpectrumTable_Data);
+        Rec2020 = alloc.new_object<RGBToSpectrumTable>(Rec2020ToSpectrumTable_Scale, &Rec2020ToSpectrumTable_Data);
+    }
+
+    Mat3 whiteBalance(const Point2f &srcWhite, const Point2f &dstWhite) {
+        static const Mat3 LMSFromXYZ{0.8951f, 0.2664f, -0.1614f,
+                                    -0.7502f, 1.7135f, 0.0367f,
+                                    0.0389f, -0.0685f, 1.0296f};
+        static const Mat3 XYZFromLMS{0.986993f, -0.147054f, 0.159963f,
+                                     0.432305f, 0.51836f, 0.0492912f,
+                                     -0.00852866f, 0.0400428f, 0.968487f};
+
+        const Vec3f srcLMS = LMSFromXYZ * XYZFromxyY(srcWhite);
+        const Vec3f dstLMS = LMSFromXYZ * XYZFromxyY(dstWhite);
+        const Mat3 scale = Mat3::diagonal(dstLMS.x / srcLMS.x, dstLMS.y / srcLMS.y, dstLMS.z / srcLMS.z);
+        return XYZFromLMS * scale * LMSFromXYZ;
+    }
+
+    //region Color Encoding
+    namespace detail {
+        const array<float, 256> SRGB8_TO_LINEAR = [] {
+            array<float, 256> lut;
+            for (int i = 0; i < 256; ++i) lut[i] = sRGBToLinear(static_cast<float>(i) / 255);
+            return lut;
+        }();
+
+        // Fits f over [lo, hi], shifting the chord to split its worst over- and undershoot evenly (minimax for a
+        // convex/concave piece)
+        template<typename F>
+        Encode8Segment fitEncode8Segment(F &&f, const double lo, const double hi) {
+            const double f0 = f(lo), f1 = f(hi);
+            double dMin = 0, dMax = 0;
+            for (int j = 1; j < 64; ++j) {
+                const double t = j / 64.0;
+                const double d = f(lo + t * (hi - lo)) - (f0 + t * (f1 - f0));
+                dMin = std::min(dMin, d);
+                dMax = std::max(dMax, d);
+            }
+            return {static_cast<float>(f0 + (dMin + dMax) / 2 + 0.5), static_cast<float>(f1 - f0)};
+        }
+
+        // Segment k covers the k-th (exponent, top 3 mantissa bits) step above minBits
+        template<typename F, int N>
+        void fitEncode8Segments(F &&f, const uint32_t minBits, array<Encode8Segment, N> &segments) {
+            for (uint32_t k = 0; k < static_cast<uint32_t>(N); ++k) {
+                segments[k] = fitEncode8Segment(f, bitsToFloat(minBits + (k << 20)), bitsToFloat(minBits + ((k + 1) << 20)));
+            }
+        }
+
+        const array<Encode8Segment, N_SRGB8_SEGMENTS> SRGB8_SEGMENTS = [] {
+            array<Encode8Segment, N_SRGB8_SEGMENTS> segments;
+            fitEncode8Segments([](const double v) {
+                return 255 * (v <= 0.0031308 ? 12.92 * v : 1.055 * std::pow(v, 1 / 2.4) - 0.055);
+            }, SRGB8_MIN_BITS, segments);
+            return segments;
+        }();
+    }
+
+    ColorEncoding ColorEncoding::linear;
+    ColorEncoding ColorEncoding::sRGB;
+
+    void ColorEncoding::init(Allocator alloc) {
+        linear = ColorEncoding(alloc.new_object<LinearColorEncoding>());
+        sRGB = ColorEncoding(alloc.new_object<sRGBColorEncoding>());
+    }
+
+    void LinearColorEncoding::toLinear(span<const uint8_t> vin, span<float> vout) const {
+        ASSERT(vin.size() == vout.size());
+        for (size_t i = 0; i < vin.size(); ++i) vout[i] = static_cast<float>(vin[i]) / 255;
+    }
+
+    void LinearColorEncoding::fromLinear(span<const float> vin, span<uint8_t> vout) const {
+        ASSERT(vin.size() == vout.size());
+        for (size_t i = 0; i < vin.size(); ++i) {
+            vout[i] = static_cast<uint8_t>(jtx::clamp(vin[i] * 255 + 0.5f, 0.0f, 255.0f));
+        }
+    }
+
+    void sRGBColorEncoding::toLinear(span<const uint8_t> vin, span<float> vout) const {
+        ASSERT(vin.size() == vout.size());
+        for (size_t i = 0; i < vin.size(); ++i) vout[i] = sRGB8ToLinear(vin[i]);
+    }
+
+    void sRGBColorEncoding::fromLinear(span<const float> vin, span<uint8_t> vout) const {
+        ASSERT(vin.size() == vout.size());
+        size_t i = 0;
+#ifdef __AVX2__
+        const __m256 minV = _mm256_set1_ps(bitsToFloat(detail::SRGB8_MIN_BITS));
+        const __m256 maxV = _mm256_set1_ps(bitsToFloat(detail::ENCODE8_MAX_BITS));
+        const __m256i minBits = _mm256_set1_epi32(detail::SRGB8_MIN_BITS);
+        const __m256i fracMask = _mm256_set1_epi32(0xFFFFF);
+        const __m256 fracScale = _mm256_set1_ps(0x1.0p-20f);
+        const auto *segments = reinterpret_cast<const float *>(detail::SRGB8_SEGMENTS.data());
+
+        for (; i + 8 <= vin.size(); i += 8) {
+            __m256 v = _mm256_loadu_ps(vin.data() + i);
+            // Same as the scalar !(v > min) test, NaN included
+            const __m256 zero = _mm256_cmp_ps(v, minV, _CMP_NGT_UQ);
+            v = _mm256_min_ps(_mm256_max_ps(v, minV), maxV);
+
+            const __m256i bits = _mm256_castps_si256(v);
+            // Segments are (base, slope) pairs
+            const __m256i idx = _mm256_slli_epi32(_mm256_srli_epi32(_mm256_sub_epi32(bits, minBits), 20), 1);
+            const __m256 base = _mm256_i32gather_ps(segments, idx, sizeof(float));
+            const __m256 slope = _mm256_i32gather_ps(segments + 1, idx, sizeof(float));
+            const __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(bits, fracMask)), fracScale);
+            const __m256 r = _mm256_andnot_ps(zero, _mm256_add_ps(base, _mm256_mul_ps(slope, t)));
+
+            // Narrow 8 x int32 to 8 bytes; every value is already in [0, 255]
+            const __m256i q = _mm256_cvttps_epi32(r);
+            const __m128i q16 = _mm_packus_epi32(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(vout.data() + i), _mm_packus_epi16(q16, q16));
+        }
+#endif
+        for (; i < vin.size(); ++i) vout[i] = linearToSRGB8(vin[i]);
+    }
+
+    GammaColorEncoding::GammaColorEncoding(const float gamma) : gamma(gamma) {
+        for (int i = 0; i < 256; ++i) applyLUT[i] = jtx::pow(static_cast<float>(i) / 255, gamma);
+        const double invGamma = 1.0 / gamma;
+        detail::fitEncode8Segments([invGamma](const double v) { return 255 * std::pow(v, invGamma); },
+                                   ENCODE_MIN_BITS, encodeSegments);
+    }
+
+    void GammaColorEncoding::toLinear(span<const uint8_t> vin, span<float> vout) const {
+        ASSERT(vin.size() == vout.size());
+        for (size_t i = 0; i < vin.size(); ++i) vout[i] = applyLUT[vin[i]];
+    }
+
+    void GammaColorEncoding::fromLinear(span<const float> vin, span<uint8_t> vout) const {
+        ASSERT(vin.size() == vout.size());
+        for (size_t i = 0; i < vin.size(); ++i) {
+            const float v = vin[i];
+            // Also maps NaN to 0
+            if (!(v > 0)) {
+                vout[i] = 0;
+            } else if (v <= bitsToFloat(ENCODE_MIN_BITS)) {
+                // v^(1/gamma) is too steep near 0 for the table
+                vout[i] = static_cast<uint8_t>(jtx::clamp(255 * jtx::pow(v, 1 / gamma) + 0.5f, 0.0f, 255.0f));
+            } else {
+                const uint32_t bits = jtx::min(floatToBits(v), detail::ENCODE8_MAX_BITS);
+                vout[i] = detail::encode8(encodeSegments.data(), ENCODE_MIN_BITS, bits);
+            }
+        }
+    }
+    //endregion
+}
@@ -1,6 +1,279 @@
 #pragma once
+#include <jtxlib/math/mat3.hpp>
+#include <jtxlib/math/math.hpp>
+#include <jtxlib/math/vec2.hpp>
 #include <jtxlib/math/vec3.hpp>
+#include <jtxlib/std/memory_resource.hpp>
+#include <jtxlib/std/std.hpp>
+#include <jtxlib/util/taggedptr.hpp>
+
+#include <cstdint>
 
 namespace jtx {
     using Color = Vec3f;
-}
\ No newline at end of file
+
+    //region Chromaticity
+    JTX_HOSTDEV
+    JTX_INLINE Point2f xyFromXYZ(const Vec3f &xyz) {
+        const float sum = xyz.x + xyz.y + xyz.z;
+        if (sum == 0) return {0, 0};
+        return {xyz.x / sum, xyz.y / sum};
+    }
+
+    JTX_HOSTDEV
+    JTX_INLINE Vec3f XYZFromxyY(const Point2f &xy, const float Y = 1) {
+        if (xy.y == 0) return {0, 0, 0};
+        return {xy.x * Y / xy.y, Y, (1 - xy.x - xy.y) * Y / xy.y};
+    }
+
+    /**
+     * Von Kries chromatic adaptation in Bradford LMS space, mapping XYZ under an illuminant with
+     * chromaticity srcWhite to XYZ under dstWhite. Same as PBRTv4's WhiteBalance().
+     */
+    JTX_HOST
+    Mat3 whiteBalance(const Point2f &srcWhite, const Point2f &dstWhite);
+    //endregion
+
+    /**
+     * Smooth, bounded spectrum s(lambda) = sigmoid(c0 * lambda^2 + c1 * lambda + c2)
+     * from "A Low-Dimensional Function Space for Efficient Spectral Upsampling" (Jakob & Hanika 2019)
+     */
+    class RGBSigmoidPolynomial {
+    public:
+        RGBSigmoidPolynomial() = default;
+
+        JTX_HOSTDEV
+        RGBSigmoidPolynomial(const float c0, const float c1, const float c2) : c0(c0), c1(c1), c2(c2) {}
+
+        JTX_HOSTDEV
+        float operator()(const float lambda) const {
+            return s(evalPolynomial(lambda, c2, c1, c0));
+        }
+
+        [[nodiscard]]
+        JTX_HOSTDEV
+        float maxValue() const {
+            float result = jtx::max((*this)(360), (*this)(830));
+            const float lambda = -c1 / (2 * c0);
+            if (lambda >= 360 && lambda <= 830) result = jtx::max(result, (*this)(lambda));
+            return result;
+        }
+
+    private:
+        JTX_HOSTDEV
+        static float s(const float x) {
+            if (std::isinf(x)) return x > 0 ? 1 : 0;
+            return 0.5f + x / (2 * jtx::sqrt(1 + x * x));
+        }
+
+        float c0 = 0, c1 = 0, c2 = 0;
+    };
+
+    /**
+     * Maps RGB in [0, 1] to sigmoid polynomial coefficients for one color space.
+     *
+     * The coefficients are precomputed by rgb2spec_opt (src/cmd) at build time over a RES^3 grid per
+     * maximum component and trilinearly interpolated at lookup.
+     */
+    class RGBToSpectrumTable {
+    public:
+        static constexpr int RES = 64;
+
+        using CoefficientArray = float[3][RES][RES][RES][3];
+
+        JTX_HOST
+        RGBToSpectrumTable(const float *zNodes, const CoefficientArray *coeffs) : zNodes(zNodes), coeffs(coeffs) {}
+
+        JTX_HOSTDEV
+        RGBSigmoidPolynomial operator()(const Color &rgb) const;
+
+        // Tables for the supported color spaces, valid after init()
+        static const RGBToSpectrumTable *sRGB;
+        static const RGBToSpectrumTable *DCI_P3;
+        static const RGBToSpectrumTable *Rec2020;
+
+        JTX_HOST
+        static void init(Allocator alloc);
+
+    private:
+        const float *zNodes;
+        const CoefficientArray *coeffs;
+    };
+
+    JTX_HOSTDEV
+    JTX_INLINE RGBSigmoidPolynomial RGBToSpectrumTable::operator()(const Color &rgb) const {
+        ASSERT(rgb.r >= 0 && rgb.g >= 0 && rgb.b >= 0 && rgb.r <= 1 && rgb.g <= 1 && rgb.b <= 1);
+
+        // Uniform RGB maps to a constant spectrum
+        if (rgb.r == rgb.g && rgb.g == rgb.b) {
+            return {0, 0, (rgb.r - 0.5f) / jtx::sqrt(rgb.r * (1 - rgb.r))};
+        }
+
+        // The table is indexed by the largest component and the other two relative to it
+        const int maxc = (rgb.r > rgb.g) ? ((rgb.r > rgb.b) ? 0 : 2) : ((rgb.g > rgb.b) ? 1 : 2);
+        const float z = rgb[maxc];
+        const float x = rgb[(maxc + 1) % 3] * (RES - 1) / z;
+        const float y = rgb[(maxc + 2) % 3] * (RES - 1) / z;
+
+        const int xi = jtx::min(static_cast<int>(x), RES - 2);
+        const int yi = jtx::min(static_cast<int>(y), RES - 2);
+        const int zi = static_cast<int>(findInterval(RES, [&](const int i) { return zNodes[i] < z; }));
+        const float dx = x - static_cast<float>(xi);
+        const float dy = y - static_cast<float>(yi);
+        const float dz = (z - zNodes[zi]) / (zNodes[zi + 1] - zNodes[zi]);
+
+        float c[3];
+        for (int i = 0; i < 3; ++i) {
+            auto co = [&](const int ox, const int oy, const int oz) { return (*coeffs)[maxc][zi + oz][yi + oy][xi + ox][i]; };
+            c[i] = lerp(lerp(lerp(co(0, 0, 0), co(1, 0, 0), dx), lerp(co(0, 1, 0), co(1, 1, 0), dx), dy),
+                        lerp(lerp(co(0, 0, 1), co(1, 0, 1), dx), lerp(co(0, 1, 1), co(1, 1, 1), dx), dy), dz);
+        }
+        return {c[0], c[1], c[2]};
+    }
+
+    //region Color Encoding
+    JTX_HOSTDEV
+    JTX_INLINE float linearToSRGB(const float v) {
+        if (v <= 0.0031308f) return 12.92f * v;
+        return 1.055f * jtx::pow(v, 1 / 2.4f) - 0.055f;
+    }
+
+    JTX_HOSTDEV
+    JTX_INLINE float sRGBToLinear(const float v) {
+        if (v <= 0.04045f) return v / 12.92f;
+        return jtx::pow((v + 0.055f) / 1.055f, 2.4f);
+    }
+
+    namespace detail {
+        // Both built once at startup in color.cpp
+        extern const array<float, 256> SRGB8_TO_LINEAR;
+
+        /**
+         * One piece of a piecewise linear fit of 255 * encode(v) + 0.5, one segment per (exponent, top 3 mantissa
+         * bits) of v. Truncating the fit gives the rounded 8-bit value.
+         * Same idea as ryg's float -> sRGB8 conversion: https://gist.github.com/rygorous/2203834
+         */
+        struct Encode8Segment {
+            float base, slope;
+        };
+        static constexpr uint32_t ENCODE8_MAX_BITS = 0x3F7FFFFFu; // 1 - ulp
+
+        // Segment for v with the given bits, which must be in [minBits, ENCODE8_MAX_BITS]
+        JTX_HOST
+        JTX_INLINE uint8_t encode8(const Encode8Segment *segments, const uint32_t minBits, const uint32_t bits) {
+            const Encode8Segment &s = segments[(bits - minBits) >> 20];
+            const float t = static_cast<float>(bits & 0xFFFFFu) * 0x1.0p-20f;
+            return static_cast<uint8_t>(s.base + s.slope * t);
+        }
+
+        // linearToSRGB over [2^-13, 1)
+        static constexpr int N_SRGB8_SEGMENTS = 13 * 8;
+        static constexpr uint32_t SRGB8_MIN_BITS = (127 - 13) << 23; // 2^-13
+        extern const array<Encode8Segment, N_SRGB8_SEGMENTS> SRGB8_SEGMENTS;
+    }
+
+    JTX_HOST
+    JTX_INLINE float sRGB8ToLinear(const uint8_t v) {
+        return detail::SRGB8_TO_LINEAR[v];
+    }
+
+    // Rounded 8-bit sRGB without pow; within 1 of round(255 * linearToSRGB(v)) and exact for almost all inputs
+    JTX_HOST
+    JTX_INLINE uint8_t linearToSRGB8(const float v) {
+        // !(v > min) also sends NaN to 0
+        if (!(v > bitsToFloat(detail::SRGB8_MIN_BITS))) return 0;
+        const uint32_t bits = jtx::min(floatToBits(v), detail::ENCODE8_MAX_BITS);
+        return detail::encode8(detail::SRGB8_SEGMENTS.data(), detail::SRGB8_MIN_BITS, bits);
+    }
+
+    class LinearColorEncoding {
+    public:
+        JTX_HOST
+        void toLinear(span<const uint8_t> vin, span<float> vout) const;
+
+        JTX_HOST
+        void fromLinear(span<const float> vin, span<uint8_t> vout) const;
+
+        [[nodiscard]]
+        JTX_HOST
+        float toFloatLinear(const float v) const { return v; }
+    };
+
+    class sRGBColorEncoding {
+    public:
+        JTX_HOST
+        void toLinear(span<const uint8_t> vin, span<float> vout) const;
+
+        // 8 values at a time with AVX2
+        JTX_HOST
+        void fromLinear(span<const float> vin, span<uint8_t> vout) const;
+
+        [[nodiscard]]
+        JTX_HOST
+        float toFloatLinear(const float v) const { return sRGBToLinear(v); }
+    };
+
+    /**
+     * v^gamma, with table-driven 8-bit decode. Encoding uses the same piecewise linear fit as sRGB over [2^-32, 1),
+     * within 1 of round(255 * v^(1/gamma)); smaller inputs fall back to pow.
+     */
+    class GammaColorEncoding {
+    public:
+        JTX_HOST
+        explicit GammaColorEncoding(float gamma);
+
+        JTX_HOST
+        void toLinear(span<const uint8_t> vin, span<float> vout) const;
+
+        JTX_HOST
+        void fromLinear(span<const float> vin, span<uint8_t> vout) const;
+
+        [[nodiscard]]
+        JTX_HOST
+        float toFloatLinear(const float v) const { return jtx::pow(v, gamma); }
+
+    private:
+        static constexpr int N_ENCODE_SEGMENTS = 32 * 8;
+        static constexpr uint32_t ENCODE_MIN_BITS = (127 - 32) << 23; // 2^-32
+
+        float gamma;
+        array<float, 256> applyLUT;
+        array<detail::Encode8Segment, N_ENCODE_SEGMENTS> encodeSegments;
+    };
+
+    /**
+     * How 8-bit image values map to linear values, same as PBRTv4's ColorEncoding.
+     * toLinear/fromLinear work on whole spans so the dispatch happens once per image row, not per value.
+     */
+    class ColorEncoding : public TaggedPtr<LinearColorEncoding, sRGBColorEncoding, GammaColorEncoding> {
+    public:
+        using TaggedPtr::TaggedPtr;
+
+        JTX_HOST
+        void toLinear(span<const uint8_t> vin, span<float> vout) const {
+            auto op = [&](auto ptr) { return ptr->toLinear(vin, vout); };
+            return dispatch(op);
+        }
+
+        JTX_HOST
+        void fromLinear(span<const float> vin, span<uint8_t> vout) const {
+            auto op = [&](auto ptr) { return ptr->fromLinear(vin, vout); };
+            return dispatch(op);
+        }
+
+        [[nodiscard]]
+        JTX_HOST
+        float toFloatLinear(const float v) const {
+            auto op = [&](auto ptr) { return ptr->toFloatLinear(v); };
+            return dispatch(op);
+        }
+
+        // Valid after init()
+        static ColorEncoding linear;
+        static ColorEncoding sRGB;
+
+        JTX_HOST
+        static void init(Allocator alloc);
+    };
+    //endregion
+}
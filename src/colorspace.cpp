@@ -0,0 +1,123 @@
+#include "colorspace.hpp"
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+
+namespace jtx {
+    const RGBColorSpace *RGBColorSpace::sRGB;
+    const RGBColorSpace *RGBColorSpace::DCI_P3;
+    const RGBColorSpace *RGBColorSpace::Rec2020;
+    const RGBColorSpace *RGBColorSpace::ACES2065_1;
+    const RGBColorSpace *RGBColorSpace::ACEScg;
+
+    RGBColorSpace::RGBColorSpace(const Point2f &r, const Point2f &g, const Point2f &b,
+                                 const DenselySampledSpectrum *illuminant, const RGBToSpectrumTable *rgbToSpectrum)
+        : r(r), g(g), b(b), illuminant(illuminant), rgbToSpectrum(rgbToSpectrum) {
+        ASSERT(illuminant != nullptr);
+        const Vec3f W = SpectrumToXYZ(Spectrum(const_cast<DenselySampledSpectrum *>(illuminant)));
+        w = xyFromXYZ(W);
+        computeMatrices(W);
+    }
+
+    RGBColorSpace::RGBColorSpace(const Point2f &r, const Point2f &g, const Point2f &b, const Point2f &w)
+        : r(r), g(g), b(b), w(w) {
+        computeMatrices(XYZFromxyY(w));
+    }
+
+    void RGBColorSpace::computeMatrices(const Vec3f &W) {
+        const Vec3f R = XYZFromxyY(r), G = XYZFromxyY(g), B = XYZFromxyY(b);
+        const Mat3 rgb{R.x, G.x, B.x,
+                       R.y, G.y, B.y,
+                       R.z, G.z, B.z};
+
+        // Scale each primary so that RGB (1, 1, 1) lands on the white point
+        const std::optional<Mat3> rgbInv = rgb.inverse();
+        ASSERT(rgbInv.has_value());
+        const Vec3f C = *rgbInv * W;
+        XYZFromRGB = rgb * Mat3::diagonal(C.x, C.y, C.z);
+
+        const std::optional<Mat3> inv = XYZFromRGB.inverse();
+        ASSERT(inv.has_value());
+        RGBFromXYZ = *inv;
+    }
+
+    namespace {
+        // Everything a conversion is computed from. Keying on content rather than addresses means a space freed and
+        // another allocated at its address cannot pick up a stale matrix, and equal spaces share one entry, so the
+        // cache is bounded by the distinct spaces in use
+        using ConversionKey = std::array<float, 22>;
+
+        ConversionKey conversionKey(const RGBColorSpace &from, const RGBColorSpace &to) {
+            ConversionKey key;
+            size_t k = 0;
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    key[k++] = from.XYZFromRGB[i][j];
+                    key[k++] = to.RGBFromXYZ[i][j];
+                }
+            }
+            key[k++] = from.w.x;
+            key[k++] = from.w.y;
+            key[k++] = to.w.x;
+            key[k++] = to.w.y;
+            return key;
+        }
+
+        struct ConversionCache {
+            std::shared_mutex mutex;
+            // std::map so references to cached matrices survive later inserts
+            std::map<ConversionKey, Mat3> matrices;
+        };
+
+        ConversionCache &conversionCache() {
+            static ConversionCache c;
+            return c;
+        }
+    }
+
+    const Mat3 &RGBColorSpace::convertTo(const RGBColorSpace &to) const {
+        static const Mat3 identity = Mat3::identity();
+        if (*this == to) return identity;
+
+        ConversionCache &c = conversionCache();
+        const ConversionKey key = conversionKey(*this, to);
+        {
+            std::shared_lock lock(c.mutex);
+            if (auto it = c.matrices.find(key); it != c.matrices.end()) return it->second;
+        }
+
+        const Mat3 adapt = (w == to.w) ? Mat3::identity() : whiteBalance(w, to.w);
+        const Mat3 m = to.RGBFromXYZ * adapt * XYZFromRGB;
+        std::unique_lock lock(c.mutex);
+        return c.matrices.try_emplace(key, m).first->second;
+    }
+
+    void RGBColorSpace::init(Allocator alloc) {
+        ASSERT(RGBToSpectrumTable::sRGB != nullptr);
+        const DenselySampledSpectrum *d65 = &spectra::D65();
+        // ACES white, approximately D60
+        const Point2f acesWhite{0.32168f, 0.33767f};
+
+        sRGB = alloc.new_object<RGBColorSpace>(Point2f{0.64f, 0.33f}, Point2f{0.3f, 0.6f}, Point2f{0.15f, 0.06f},
+                                               d65, RGBToSpectrumTable::sRGB);
+        DCI_P3 = alloc.new_object<RGBColorSpace>(Point2f{0.68f, 0.32f}, Point2f{0.265f, 0.69f},
+                                                 Point2f{0.15f, 0.06f}, d65, RGBToSpectrumTable::DCI_P3);
+        Rec2020 = alloc.new_object<RGBColorSpace>(Point2f{0.708f, 0.292f}, Point2f{0.17f, 0.797f},
+                                                  Point2f{0.131f, 0.046f}, d65, RGBToSpectrumTable::Rec2020);
+        ACES2065_1 = alloc.new_object<RGBColorSpace>(Point2f{0.7347f, 0.2653f}, Point2f{0.0f, 1.0f},
+                                                     Point2f{0.0001f, -0.077f}, acesWhite);
+        ACEScg = alloc.new_object<RGBColorSpace>(Point2f{0.713f, 0.293f}, Point2f{0.165f, 0.83f},
+                                                 Point2f{0.128f, 0.044f}, acesWhite);
+    }
+
+    const RGBColorSpace *RGBColorSpace::getNamed(const std::string &name) {
+        if (name == "srgb") return sRGB;
+        if (name == "dci-p3") return DCI_P3;
+        if (name == "rec2020") return Rec2020;
+        if (name == "aces2065-1") return ACES2065_1;
+        if (name == "acescg") return ACEScg;
+        return nullptr;
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <jtxlib/math/mat3.hpp>
+
+#include <string>
+
+#include "color.hpp"
+#include "spectrum.hpp"
+
+namespace jtx {
+/**
+ * An RGB color space given by its primaries and white point, same as PBRTv4's RGBColorSpace.
+ *
+ * The RGB <-> XYZ matrices are computed once at construction. Conversions between two spaces, including
+ * Bradford adaptation when their whites differ, are built on first use and cached by convertTo().
+ */
+class RGBColorSpace {
+public:
+    // White point from the illuminant's chromaticity, which also maps to RGB (1, 1, 1)
+    JTX_HOST
+    RGBColorSpace(const Point2f &r, const Point2f &g, const Point2f &b, const DenselySampledSpectrum *illuminant,
+                  const RGBToSpectrumTable *rgbToSpectrum);
+
+    // Explicit white point, for spaces without a standard illuminant spectrum here (e.g. ACES' D60).
+    // These have no RGB to spectrum table, so they can be used for output but not for spectral upsampling.
+    JTX_HOST
+    RGBColorSpace(const Point2f &r, const Point2f &g, const Point2f &b, const Point2f &w);
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    Color toRGB(const Vec3f &xyz) const { return RGBFromXYZ * xyz; }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    Vec3f toXYZ(const Color &rgb) const { return XYZFromRGB * rgb; }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    bool hasSpectra() const { return rgbToSpectrum != nullptr && illuminant != nullptr; }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    RGBSigmoidPolynomial toRGBCoeffs(const Color &rgb) const {
+        ASSERT(rgbToSpectrum != nullptr);
+        return (*rgbToSpectrum)({clampZero(rgb.r), clampZero(rgb.g), clampZero(rgb.b)});
+    }
+
+    // Maps RGB in this space to RGB in `to`. The reference stays valid for the life of the program.
+    [[nodiscard]]
+    JTX_HOST
+    const Mat3 &convertTo(const RGBColorSpace &to) const;
+
+    JTX_HOSTDEV
+    bool operator==(const RGBColorSpace &cs) const {
+        return r == cs.r && g == cs.g && b == cs.b && w == cs.w && illuminant == cs.illuminant &&
+               rgbToSpectrum == cs.rgbToSpectrum;
+    }
+
+    JTX_HOSTDEV
+    bool operator!=(const RGBColorSpace &cs) const { return !(*this == cs); }
+
+    Point2f r, g, b, w;
+    const DenselySampledSpectrum *illuminant = nullptr;
+    const RGBToSpectrumTable *rgbToSpectrum = nullptr;
+    Mat3 XYZFromRGB, RGBFromXYZ;
+
+    // Valid after init(), which needs RGBToSpectrumTable::init() first
+    static const RGBColorSpace *sRGB;
+    static const RGBColorSpace *DCI_P3;
+    static const RGBColorSpace *Rec2020;
+    static const RGBColorSpace *ACES2065_1;
+    static const RGBColorSpace *ACEScg;
+
+    JTX_HOST
+    static void init(Allocator alloc);
+
+    // "srgb", "dci-p3", "rec2020", "aces2065-1" or "acescg"; nullptr if unknown
+    JTX_HOST
+    static const RGBColorSpace *getNamed(const std::string &name);
+
+private:
+    JTX_HOST
+    void computeMatrices(const Vec3f &W);
+};
+}
@@ -0,0 +1,74 @@
+#include "film.hpp"
+
+#ifdef __AVX__
+#include <jtxlib/simd/avxfloat.hpp>
+#endif
+
+namespace jtx {
+FilmSensor::FilmSensor(const Mat3 &outputRGBFromXYZ, const float imagingRatio) : outputFromXYZ(outputRGBFromXYZ) {
+    buildTable(imagingRatio);
+}
+
+FilmSensor::FilmSensor(const Mat3 &outputRGBFromXYZ, const Spectrum &sensorIllum, const Point2f &outputWhite,
+                       const float imagingRatio)
+    : outputFromXYZ(outputRGBFromXYZ * whiteBalance(xyFromXYZ(SpectrumToXYZ(sensorIllum)), outputWhite)) {
+    buildTable(imagingRatio);
+}
+
+FilmSensor::FilmSensor(const RGBColorSpace &outputSpace, const Spectrum &sensorIllum, const float imagingRatio)
+    : outputFromXYZ(outputSpace.RGBFromXYZ) {
+    if (sensorIllum) {
+        outputFromXYZ = outputFromXYZ * whiteBalance(xyFromXYZ(SpectrumToXYZ(sensorIllum)), outputSpace.w);
+    }
+    buildTable(imagingRatio);
+}
+
+void FilmSensor::buildTable(const float imagingRatio) {
+    const Mat3 m = outputFromXYZ * (imagingRatio / (CIE_Y_INTEGRAL * N_SPECTRUM_SAMPLES));
+    for (int i = 0; i < N_DENSE_SAMPLES; ++i) {
+        const Vec3f rgb = m * Vec3f{detail::CIE_X[i], detail::CIE_Y[i], detail::CIE_Z[i]};
+        rgbBar[i][0] = rgb.r;
+        rgbBar[i][1] = rgb.g;
+        rgbBar[i][2] = rgb.b;
+        rgbBar[i][3] = 0;
+    }
+}
+
+void FilmSensor::toRGB(span<const SampledSpectrum> L, span<const SampledWavelengths> lambda, span<Color> out) const {
+    ASSERT(L.size() == lambda.size() && L.size() == out.size());
+    size_t i = 0;
+#ifdef __AVX__
+    // Each 128-bit half of a vector holds one camera sample, so rows and weights line up lane for lane.
+    // SampledSpectrum is read directly as 4 packed floats.
+    static_assert(N_SPECTRUM_SAMPLES == 4 && sizeof(SampledSpectrum) == 4 * sizeof(float));
+    const auto *rad = reinterpret_cast<const float *>(L.data());
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 binOffset = _mm256_set1_ps(LAMBDA_MIN - 0.5f);
+    const __m256 maxBin = _mm256_set1_ps(N_DENSE_SAMPLES - 1);
+
+    for (; i + 2 <= L.size(); i += 2) {
+        const SampledWavelengths &l0 = lambda[i], &l1 = lambda[i + 1];
+        const SampledSpectrum p0 = l0.PDF(), p1 = l1.PDF();
+        const __m256 pdf = _mm256_loadu2_m128(reinterpret_cast<const float *>(&p1),
+                                              reinterpret_cast<const float *>(&p0));
+        // Masking after the divide zeroes the inf/nan lanes where pdf == 0
+        const __m256 w = _mm256_and_ps(_mm256_div_ps(_mm256_loadu_ps(rad + 4 * i), pdf),
+                                       _mm256_cmp_ps(pdf, zero, _CMP_NEQ_OQ));
+
+        const __m256 lam = _mm256_setr_ps(l0[0], l0[1], l0[2], l0[3], l1[0], l1[1], l1[2], l1[3]);
+        alignas(32) int32_t b[8];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(b),
+                           _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(lam, binOffset), zero), maxBin)));
+
+        // _mm256_permute_ps broadcasts weight s within each half
+        const AVXFloat rgb = AVXFloat(_mm256_permute_ps(w, 0x00)) * _mm256_loadu2_m128(rgbBar[b[4]], rgbBar[b[0]]) +
+                             AVXFloat(_mm256_permute_ps(w, 0x55)) * _mm256_loadu2_m128(rgbBar[b[5]], rgbBar[b[1]]) +
+                             AVXFloat(_mm256_permute_ps(w, 0xAA)) * _mm256_loadu2_m128(rgbBar[b[6]], rgbBar[b[2]]) +
+                             AVXFloat(_mm256_permute_ps(w, 0xFF)) * _mm256_loadu2_m128(rgbBar[b[7]], rgbBar[b[3]]);
+        out[i] = {rgb[0], rgb[1], rgb[2]};
+        out[i + 1] = {rgb[4], rgb[5], rgb[6]};
+    }
+#endif
+    for (; i < L.size(); ++i) out[i] = toRGB(L[i], lambda[i]);
+}
+}
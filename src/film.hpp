@@ -0,0 +1,73 @@
+#pragma once
+#include <jtxlib/math/mat3.hpp>
+#include <jtxlib/std/std.hpp>
+
+#include "color.hpp"
+#include "colorspace.hpp"
+#include "spectrum.hpp"
+
+namespace jtx {
+/**
+ * Converts spectral radiance samples to RGB in an output color space, before they are accumulated into pixels.
+ * This is PBRTv4's PixelSensor with the CIE 1931 observer as the sensor response.
+ *
+ * Everything that doesn't depend on the sample is folded into one per-nm table at construction:
+ *     rgbBar(lambda) = imagingRatio * outputRGBFromXYZ * whiteBalance * (xBar, yBar, zBar)(lambda) / (CIE_Y_INTEGRAL * N)
+ * so converting a sample is one row lookup and 3 FMAs per wavelength. A constant radiance of 1 maps to Y = 1.
+ * Wavelengths with a pdf of 0 (terminated secondaries) contribute nothing.
+ */
+class FilmSensor {
+public:
+    // Pass the identity matrix for XYZ output
+    JTX_HOST
+    explicit FilmSensor(const Mat3 &outputRGBFromXYZ, float imagingRatio = 1);
+
+    // Output in outputSpace; a sensor illuminant, if given, is white balanced to the space's white point
+    JTX_HOST
+    explicit FilmSensor(const RGBColorSpace &outputSpace, const Spectrum &sensorIllum = {}, float imagingRatio = 1);
+
+    // Also white balances the sensor illuminant's chromaticity to outputWhite
+    JTX_HOST
+    FilmSensor(const Mat3 &outputRGBFromXYZ, const Spectrum &sensorIllum, const Point2f &outputWhite,
+               float imagingRatio = 1);
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    Color toRGB(const SampledSpectrum &L, const SampledWavelengths &lambda) const {
+        const SampledSpectrum pdf = lambda.PDF();
+        Color rgb{0, 0, 0};
+        for (int i = 0; i < N_SPECTRUM_SAMPLES; ++i) {
+            if (pdf[i] == 0) continue;
+            const float *row = rgbBar[bin(lambda[i])];
+            const float w = L[i] / pdf[i];
+            rgb.r += w * row[0];
+            rgb.g += w * row[1];
+            rgb.b += w * row[2];
+        }
+        return rgb;
+    }
+
+    // Converts a batch of camera samples, two per 8-wide vector with AVX
+    JTX_HOST
+    void toRGB(span<const SampledSpectrum> L, span<const SampledWavelengths> lambda, span<Color> out) const;
+
+    // The matrix applied to XYZ, including white balance (but not the imaging ratio)
+    [[nodiscard]]
+    JTX_HOSTDEV
+    const Mat3 &rgbFromXYZ() const { return outputFromXYZ; }
+
+private:
+    JTX_HOST
+    void buildTable(float imagingRatio);
+
+    // Nearest 1nm bin, same as DenselySampledSpectrum
+    JTX_HOSTDEV
+    static int bin(const float lambda) {
+        return jtx::clamp(static_cast<int>(lambda - (LAMBDA_MIN - 0.5f)), 0, N_DENSE_SAMPLES - 1);
+    }
+
+    Mat3 outputFromXYZ;
+    // (r, g, b, 0) per 1nm bin, padded so each row is one 128-bit load
+    alignas(16) float rgbBar[N_DENSE_SAMPLES][4];
+};
+}
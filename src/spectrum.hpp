@@ -1,19 +1,31 @@
 #pragma once
 #include <jtxlib/math/math.hpp>
+#include <jtxlib/math/half.hpp>
+#include <jtxlib/math/vec3.hpp>
 #include <jtxlib/util/taggedptr.hpp>
+#include <jtxlib/util/batchdispatch.hpp>
 #include <jtxlib/std/memory_resource.hpp>
 #include <jtxlib/std/std.hpp>
 
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+#include "cie.hpp"
+#include "color.hpp"
+
 namespace jtx {
 static constexpr float LAMBDA_MIN = 360.0f;
 static constexpr float LAMBDA_MAX = 830.0f;
 
 static constexpr int N_SPECTRUM_SAMPLES = 4;
+// Number of 1nm samples in [LAMBDA_MIN, LAMBDA_MAX]
+static constexpr int N_DENSE_SAMPLES = static_cast<int>(LAMBDA_MAX - LAMBDA_MIN) + 1;
 
 static constexpr float WEIN_DISPLACEMENT = 2.8977721e-3f;
 
 JTX_HOSTDEV
-float blackBody(const float lambda, const float temp) {
+JTX_INLINE float blackBody(const float lambda, const float temp) {
     if (temp <= 0) return 0;
 
     constexpr float c = 299792458.0f;
@@ -295,8 +307,70 @@ public:
     static float average(const SampledSpectrum &s) { return s.average(); }
 };
 
+#pragma region Wavelength Sampling
+// Visible wavelength importance sampling, a fit to the CIE Y matching function (PBRT 4.5.3)
+JTX_HOSTDEV
+JTX_INLINE float visibleWavelengthsPDF(const float lambda) {
+    if (lambda < LAMBDA_MIN || lambda > LAMBDA_MAX) return 0;
+    const float c = std::cosh(0.0072f * (lambda - 538));
+    return 0.0039398042f / (c * c);
+}
+
+JTX_HOSTDEV
+JTX_INLINE float sampleVisibleWavelengths(const float u) {
+    return 538 - 138.888889f * std::atanh(0.85691062f - 1.82750197f * u);
+}
+
+class Spectrum;
+
+/**
+ * Tabulated wavelength distribution proportional to a spectrum (e.g. a camera sensor response).
+ *
+ * The spectrum is treated as piecewise-constant over the 1nm bins in [LAMBDA_MIN, LAMBDA_MAX],
+ * so sample() inverts the CDF exactly and pdf() matches the returned samples.
+ */
+class WavelengthDistribution {
+    vector<float> func, cdf;
+    float integral = 0;
+public:
+    JTX_HOST
+    explicit WavelengthDistribution(const Spectrum &s, Allocator alloc = {});
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    float pdf(const float lambda) const {
+        if (lambda < LAMBDA_MIN || lambda > LAMBDA_MAX) return 0;
+        const int i = jtx::min(static_cast<int>(lambda - LAMBDA_MIN), static_cast<int>(func.size()) - 1);
+        return func[i] / integral;
+    }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    float sample(const float u) const {
+        const int o = static_cast<int>(findInterval(cdf.size(), [&](const int i) { return cdf[i] <= u; }));
+        float du = u - cdf[o];
+        if (cdf[o + 1] - cdf[o] > 0) du /= cdf[o + 1] - cdf[o];
+        return jtx::min(LAMBDA_MIN + static_cast<float>(o) + du, LAMBDA_MAX);
+    }
+};
+#pragma endregion
+
 class SampledWavelengths {
     array<float, N_SPECTRUM_SAMPLES> lambda, pdf;
+
+    // Stratifies the remaining samples by offsetting u, so one u gives N_SPECTRUM_SAMPLES well-spread wavelengths
+    template<typename F, typename P>
+    JTX_HOSTDEV
+    static SampledWavelengths sampleStratified(const float u, F sampleFn, P pdfFn) {
+        SampledWavelengths r;
+        for (int i = 0; i < N_SPECTRUM_SAMPLES; ++i) {
+            float up = u + static_cast<float>(i) / N_SPECTRUM_SAMPLES;
+            if (up > 1) up -= 1;
+            r.lambda[i] = sampleFn(up);
+            r.pdf[i] = pdfFn(r.lambda[i]);
+        }
+        return r;
+    }
 public:
     JTX_HOSTDEV
     static SampledWavelengths sampleUniform(const float u, const float lMin = LAMBDA_MIN, const float lMax = LAMBDA_MAX) {
@@ -313,6 +387,19 @@ public:
         return r;
     }
 
+    // Importance samples the visible range; prefer over sampleUniform for RGB/XYZ output
+    JTX_HOSTDEV
+    static SampledWavelengths sampleVisible(const float u) {
+        return sampleStratified(u, sampleVisibleWavelengths, visibleWavelengthsPDF);
+    }
+
+    JTX_HOSTDEV
+    static SampledWavelengths sample(const float u, const WavelengthDistribution &distrib) {
+        return sampleStratified(u,
+                                [&](const float up) { return distrib.sample(up); },
+                                [&](const float l) { return distrib.pdf(l); });
+    }
+
     float operator[](const int i) const { return lambda[i]; }
     float &operator[](const int i) { return lambda[i]; }
 
@@ -337,39 +424,36 @@ public:
 
 class ConstantSpectrum;
 class DenselySampledSpectrum;
+class CompactDenseSpectrum;
 class PiecewiseLinearSpectrum;
+class BlackbodySpectrum;
+class RGBAlbedoSpectrum;
+class RGBUnboundedSpectrum;
+class RGBIlluminantSpectrum;
 
-class Spectrum : public TaggedPtr<ConstantSpectrum, DenselySampledSpectrum, PiecewiseLinearSpectrum> {
+class Spectrum : public TaggedPtr<ConstantSpectrum, DenselySampledSpectrum, CompactDenseSpectrum, PiecewiseLinearSpectrum,
+                                  BlackbodySpectrum, RGBAlbedoSpectrum, RGBUnboundedSpectrum, RGBIlluminantSpectrum> {
 public:
     using TaggedPtr::TaggedPtr;
 
     JTX_HOSTDEV
-    float operator()(float lambda) const {
-        auto op = [&](auto ptr) { return (*ptr)(lambda); };
-        return dispatch(op);
-    }
+    float operator()(float lambda) const;
 
     [[nodiscard]]
     JTX_HOSTDEV
-    float maxValue() const {
-        auto op = [&](auto ptr) { return ptr->maxValue(); };
-        return dispatch(op);
-    }
+    float maxValue() const;
 
     JTX_HOSTDEV
-    SampledSpectrum sample(const SampledWavelengths &lambda) const {
-        auto op = [&](auto ptr) { return ptr->sample(lambda); };
-        return dispatch(op);
-    }
+    SampledSpectrum sample(const SampledWavelengths &lambda) const;
+
+    // Writes the spectrum at every integer wavelength in [LAMBDA_MIN, LAMBDA_MAX]
+    // Only dispatches once, so prefer this over operator() when evaluating the whole range
+    JTX_HOSTDEV
+    void sampleDense(span<float> dst) const;
 
     [[nodiscard]]
     JTX_HOST
-    std::string toString() const {
-        if (getPtr() == nullptr) return "(nullptr)";
-
-        auto op = [&](auto ptr) { return ptr->toString(); };
-        return dispatch(op);
-    }
+    std::string toString() const;
 };
 
 class ConstantSpectrum {
@@ -382,13 +466,27 @@ public:
 
     [[nodiscard]]
     JTX_HOSTDEV
-    SampledSpectrum Sample(const SampledWavelengths &lambda) const {
+    SampledSpectrum sample(const SampledWavelengths &lambda) const {
         return SampledSpectrum(c);
     }
 
+    JTX_HOSTDEV
+    void sampleDense(span<float> dst) const {
+        ASSERT(dst.size() == N_DENSE_SAMPLES);
+        for (float &v : dst) v = c;
+    }
+
     [[nodiscard]]
     JTX_HOSTDEV
     float maxValue() const { return c; }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    float getValue() const { return c; }
+
+    [[nodiscard]]
+    JTX_HOST
+    std::string toString() const { return "ConstantSpectrum(" + std::to_string(c) + ")"; }
 private:
     float c;
 };
@@ -396,6 +494,15 @@ private:
 class DenselySampledSpectrum {
     int lambdaMin, lambdaMax;
     vector<float> values;
+    // Set when viewing static data (e.g. the CIE tables), in which case values is empty
+    const float *staticValues = nullptr;
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    span<const float> samples() const {
+        if (staticValues) return {staticValues, static_cast<size_t>(lambdaMax - lambdaMin + 1)};
+        return {values.data(), values.size()};
+    }
 public:
     JTX_HOST
     explicit DenselySampledSpectrum(const int lambdaMin = LAMBDA_MIN, const int lambdaMax = LAMBDA_MAX, const Allocator alloc = {}):
@@ -405,7 +512,7 @@ public:
     {}
 
     JTX_HOST
-    DenselySampledSpectrum(const Spectrum &s, const Allocator alloc) : DenselySampledSpectrum(s, lambdaMin, lambdaMax, alloc) {};
+    DenselySampledSpectrum(const Spectrum &s, const Allocator alloc) : DenselySampledSpectrum(s, LAMBDA_MIN, LAMBDA_MAX, alloc) {};
 
     JTX_HOST
     explicit DenselySampledSpectrum(const Spectrum& s, const int lambdaMin = LAMBDA_MIN, const int lambdaMax = LAMBDA_MAX, const Allocator alloc = {}) :
@@ -413,70 +520,150 @@ public:
         lambdaMax(lambdaMax),
         values(lambdaMax - lambdaMin + 1, alloc)
     {
-        if (s) for (int lambda = lambdaMin; lambda <= lambdaMax; ++lambda) values[lambda - lambdaMin] = s(lambda);
+        if (!s) return;
+        if (lambdaMin == LAMBDA_MIN && lambdaMax == LAMBDA_MAX) s.sampleDense(makeSpan(values));
+        else for (int lambda = lambdaMin; lambda <= lambdaMax; ++lambda) values[lambda - lambdaMin] = s(lambda);
     }
 
+    // Views v in place without allocating; v must outlive this spectrum and is never modified
+    JTX_HOST
+    explicit DenselySampledSpectrum(const span<const float> v, const int lambdaMin = LAMBDA_MIN) :
+        lambdaMin(lambdaMin),
+        lambdaMax(lambdaMin + static_cast<int>(v.size()) - 1),
+        staticValues(v.data())
+    {}
+
     JTX_HOST
     DenselySampledSpectrum(const DenselySampledSpectrum &s, const Allocator alloc) :
         lambdaMin(s.lambdaMin),
         lambdaMax(s.lambdaMax),
-        values(s.values.begin(), s.values.end(), alloc)
+        values(s.samples().begin(), s.samples().end(), alloc)
     {}
 
     [[nodiscard]]
     JTX_HOSTDEV
     SampledSpectrum sample(const SampledWavelengths &lambda) const {
+        const span<const float> v = samples();
         SampledSpectrum s;
         for (int i = 0; i < N_SPECTRUM_SAMPLES; ++i) {
             int offset = jtx::lround(lambda[i]) - lambdaMin;
-            if (offset < 0 || offset >= values.size()) s[i] = 0;
-            else s[i] = values[offset];
+            if (offset < 0 || offset >= v.size()) s[i] = 0;
+            else s[i] = v[offset];
         }
         return s;
     }
 
+    JTX_HOSTDEV
+    void sampleDense(span<float> dst) const {
+        ASSERT(dst.size() == N_DENSE_SAMPLES);
+        const span<const float> v = samples();
+        for (int i = 0; i < N_DENSE_SAMPLES; ++i) {
+            const int offset = static_cast<int>(LAMBDA_MIN) + i - lambdaMin;
+            dst[i] = (offset < 0 || offset >= v.size()) ? 0 : v[offset];
+        }
+    }
+
+    // Returns the stored values over [LAMBDA_MIN, LAMBDA_MAX] without copying,
+    // or an empty span if this spectrum does not cover the whole range
+    [[nodiscard]]
+    JTX_HOSTDEV
+    span<const float> denseView() const {
+        if (lambdaMin > LAMBDA_MIN || lambdaMax < LAMBDA_MAX) return {};
+        return {samples().data() + (static_cast<int>(LAMBDA_MIN) - lambdaMin), N_DENSE_SAMPLES};
+    }
+
     JTX_HOSTDEV
     void scale(const float s) { // NOLINT(*-convert-member-functions-to-static)
-        for (float v& : values) v *= s;
+        ASSERT(staticValues == nullptr);
+        for (float &v : values) v *= s;
     }
 
     JTX_HOSTDEV
     [[nodiscard]]
-    float maxValue() const { return *max_element(values.begin(), values.end()); }
+    float maxValue() const {
+        const span<const float> v = samples();
+        return *max_element(v.begin(), v.end());
+    }
 
     JTX_HOSTDEV
     float operator()(const float lambda) const {
+        const span<const float> v = samples();
         const int offset = jtx::lround(lambda) - lambdaMin;
-        if (offset < 0 || offset >= values.size()) return 0;
-        return values[offset];
+        if (offset < 0 || offset >= v.size()) return 0;
+        return v[offset];
     }
 
     JTX_HOSTDEV
     bool operator==(const DenselySampledSpectrum &s) const {
-        if (lambdaMin != s.lambdaMin || lambdaMax != s.lambdaMax || values.size() != s.values.size()) return false;
-        for (auto i = 0; i < values.size(); ++i) if (values[i] != s.values[i]) return false;
+        const span<const float> a = samples(), b = s.samples();
+        if (lambdaMin != s.lambdaMin || lambdaMax != s.lambdaMax || a.size() != b.size()) return false;
+        for (auto i = 0; i < a.size(); ++i) if (a[i] != b[i]) return false;
         return true;
     }
+
+    [[nodiscard]]
+    JTX_HOST
+    std::string toString() const {
+        return "DenselySampledSpectrum(" + std::to_string(lambdaMin) + ", " + std::to_string(lambdaMax) + ")";
+    }
 };
 
 class PiecewiseLinearSpectrum {
     vector<float> lambdas, values;
+    // Uniform buckets over [lambdas.front(), lambdas.back()], each storing the interval containing its start,
+    // so a lookup is a bucket index plus a short walk instead of a binary search
+    vector<int> grid;
+    float gridInvWidth = 0;
+
+    JTX_HOST
+    void buildGrid() {
+        if (lambdas.size() < 2) return;
+        const int n = static_cast<int>(lambdas.size()) - 1;
+        gridInvWidth = static_cast<float>(n) / (lambdas.back() - lambdas.front());
+        grid.resize(n);
+        int o = 0;
+        for (int b = 0; b < n; ++b) {
+            const float start = lambdas.front() + static_cast<float>(b) / gridInvWidth;
+            while (o < n - 1 && lambdas[o + 1] <= start) ++o;
+            grid[b] = o;
+        }
+    }
+
+    // Index of the interval containing lambda, which must lie in [lambdas.front(), lambdas.back()]
+    [[nodiscard]]
+    JTX_HOSTDEV
+    int findSegment(const float lambda) const {
+        const int last = static_cast<int>(grid.size()) - 1;
+        int o = grid[jtx::min(static_cast<int>((lambda - lambdas.front()) * gridInvWidth), last)];
+        while (o > 0 && lambdas[o] > lambda) --o;
+        while (o < last && lambdas[o + 1] <= lambda) ++o;
+        return o;
+    }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    float interpolate(const int o, const float lambda) const {
+        return lerp(values[o], values[o + 1], (lambda - lambdas[o]) / (lambdas[o + 1] - lambdas[o]));
+    }
 public:
     JTX_HOST
     PiecewiseLinearSpectrum(const span<const float> lambda, const span<const float> values, const Allocator alloc = {}) :
         lambdas(lambda.begin(), lambda.end(), alloc),
-        values(values.begin(), values.end(), alloc)
+        values(values.begin(), values.end(), alloc),
+        grid(alloc)
     {
         ASSERT(lambda.size() == values.size());
-        for (int i = 0; i < lambda.size() - 1; ++i) ASSERT(lambda[i] < lambda[i + 1]);
+        for (size_t i = 1; i < lambda.size(); ++i) ASSERT(lambda[i - 1] < lambda[i]);
+        buildGrid();
     }
 
     JTX_HOST
     PiecewiseLinearSpectrum() = default;
 
+    // Not for the shared spectra from spectra::get() and spectra::intern(), which other handles see
     JTX_HOSTDEV
     void scale(const float s) {
-        for (float v& : values) v *= s;
+        for (float &v : values) v *= s;
     }
 
     JTX_HOSTDEV
@@ -488,81 +675,543 @@ public:
 
     JTX_HOSTDEV
     float operator()(const float lambda) const {
-        if (lambdas.empty() || lambda < lambdas.front() || lambda > lambdas.back()) return 0;
-        const int o = findInterval(lambdas.size(), [&](const int i) { return lambdas[i] <= lambda; });
-        return lerp(values[o], values[o + 1], (lambda - lambdas[o]) / (lambdas[o + 1] - lambdas[o]));
+        if (lambdas.size() < 2 || lambda < lambdas.front() || lambda > lambdas.back()) return 0;
+        return interpolate(findSegment(lambda), lambda);
+    }
+
+    /**
+     * Evaluates the spectrum at each wavelength in lambda.
+     *
+     * Keeps a cursor between wavelengths and only steps it forward, falling back to the grid when the
+     * input goes backwards or skips intervals, so sorted or nearly sorted input costs O(1) per wavelength.
+     */
+    JTX_HOSTDEV
+    void evaluate(const span<const float> lambda, span<float> out) const {
+        ASSERT(lambda.size() == out.size());
+        const int last = static_cast<int>(lambdas.size()) - 2;
+        int o = -1;
+        for (size_t i = 0; i < lambda.size(); ++i) {
+            const float l = lambda[i];
+            if (last < 0 || l < lambdas.front() || l > lambdas.back()) {
+                out[i] = 0;
+                continue;
+            }
+            if (o < 0 || l < lambdas[o] || (o + 2 <= last && lambdas[o + 2] <= l)) o = findSegment(l);
+            else if (o < last && lambdas[o + 1] <= l) ++o;
+            out[i] = interpolate(o, l);
+        }
     }
 
+    JTX_HOSTDEV
+    SampledSpectrum sample(const SampledWavelengths &lambda) const {
+        float l[N_SPECTRUM_SAMPLES], v[N_SPECTRUM_SAMPLES];
+        for (int i = 0; i < N_SPECTRUM_SAMPLES; ++i) l[i] = lambda[i];
+        evaluate(l, v);
+        return SampledSpectrum(v);
+    }
+
+    // The dense wavelengths are sorted, so a single cursor replaces the per-sample binary search
+    JTX_HOSTDEV
+    void sampleDense(span<float> dst) const {
+        ASSERT(dst.size() == N_DENSE_SAMPLES);
+        size_t o = 0;
+        for (int i = 0; i < N_DENSE_SAMPLES; ++i) {
+            const float lambda = LAMBDA_MIN + static_cast<float>(i);
+            if (lambdas.size() < 2 || lambda < lambdas.front() || lambda > lambdas.back()) {
+                dst[i] = 0;
+                continue;
+            }
+            while (lambdas[o + 1] < lambda) ++o;
+            dst[i] = interpolate(static_cast<int>(o), lambda);
+        }
+    }
+
+    // Knots in increasing wavelength order, with the value at each
+    [[nodiscard]]
+    JTX_HOSTDEV
+    span<const float> getLambdas() const { return {lambdas.data(), lambdas.size()}; }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    span<const float> getValues() const { return {values.data(), values.size()}; }
+
+    JTX_HOSTDEV
+    bool operator==(const PiecewiseLinearSpectrum &s) const {
+        if (lambdas.size() != s.lambdas.size()) return false;
+        for (size_t i = 0; i < lambdas.size(); ++i) {
+            if (lambdas[i] != s.lambdas[i] || values[i] != s.values[i]) return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]]
+    JTX_HOST
+    std::string toString() const {
+        return "PiecewiseLinearSpectrum(" + std::to_string(lambdas.size()) + " knots)";
+    }
+};
+
+/**
+ * Dense spectrum with reduced storage: fp16 values and/or 5nm or 10nm spacing, linearly interpolated.
+ *
+ * Covers [LAMBDA_MIN, LAMBDA_MAX] and stores 1884 bytes at fp32/1nm down to 96 bytes at fp16/10nm.
+ * maxError() reports the largest absolute deviation from the full 1nm fp32 table at construction;
+ * create() picks the smallest format that stays within a given error.
+ */
+class CompactDenseSpectrum {
+public:
+    // Supported spacings in nm; each divides LAMBDA_MAX - LAMBDA_MIN
+    static constexpr int SPACINGS[] = {1, 5, 10};
+
+    JTX_HOST
+    CompactDenseSpectrum(const Spectrum &s, int spacing, bool half, Allocator alloc = {});
+
+    // Smallest format whose maximum error against s's 1nm table is at most maxError
+    JTX_HOST
+    static CompactDenseSpectrum *create(const Spectrum &s, float maxError, Allocator alloc = {});
+
+    // Maximum absolute error of a format against a 1nm table, without constructing it
+    JTX_HOST
+    static float formatError(span<const float> dense, int spacing, bool half);
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    static size_t formatBytes(const int spacing, const bool half) {
+        return (static_cast<size_t>(LAMBDA_MAX - LAMBDA_MIN) / spacing + 1) * (half ? sizeof(uint16_t) : sizeof(float));
+    }
+
+    JTX_HOSTDEV
+    float operator()(const float lambda) const {
+        if (lambda < LAMBDA_MIN || lambda > LAMBDA_MAX) return 0;
+        const float x = (lambda - LAMBDA_MIN) / static_cast<float>(spacing);
+        const int i = jtx::min(static_cast<int>(x), count - 2);
+        return lerp(value(i), value(i + 1), x - static_cast<float>(i));
+    }
+
+    [[nodiscard]]
     JTX_HOSTDEV
     SampledSpectrum sample(const SampledWavelengths &lambda) const {
         SampledSpectrum s;
         for (int i = 0; i < N_SPECTRUM_SAMPLES; ++i) s[i] = (*this)(lambda[i]);
         return s;
     }
+
+    JTX_HOSTDEV
+    void sampleDense(span<float> dst) const {
+        ASSERT(dst.size() == N_DENSE_SAMPLES);
+        if (spacing == 1) {
+#ifndef __CUDA_ARCH__
+            // Bulk F16C conversion on the host
+            if (half) {
+                halfToFloat(halfValues.data(), dst.data(), N_DENSE_SAMPLES);
+                return;
+            }
+#endif
+            for (int i = 0; i < N_DENSE_SAMPLES; ++i) dst[i] = value(i);
+            return;
+        }
+        const float invSpacing = 1.0f / static_cast<float>(spacing);
+        for (int k = 0; k < count - 1; ++k) {
+            const float v0 = value(k), v1 = value(k + 1);
+            for (int j = 0; j < spacing; ++j) dst[k * spacing + j] = lerp(v0, v1, static_cast<float>(j) * invSpacing);
+        }
+        dst[N_DENSE_SAMPLES - 1] = value(count - 1);
+    }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    float maxValue() const {
+        float m = value(0);
+        for (int i = 1; i < count; ++i) m = jtx::max(m, value(i));
+        return m;
+    }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    float maxError() const { return error; }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    size_t bytes() const { return formatBytes(spacing, half); }
+
+    [[nodiscard]]
+    JTX_HOST
+    std::string toString() const {
+        return "CompactDenseSpectrum(" + std::to_string(spacing) + "nm, " + (half ? "fp16" : "fp32") +
+               ", max error " + std::to_string(error) + ")";
+    }
+
+private:
+    [[nodiscard]]
+    JTX_HOSTDEV
+    float value(const int i) const { return half ? halfToFloat(halfValues[i]) : values[i]; }
+
+    int spacing;
+    int count;
+    bool half;
+    float error = 0;
+    vector<float> values;
+    vector<uint16_t> halfValues;
 };
 
+/**
+ * Shares normalized dense blackbody tables between emitters of similar temperature.
+ *
+ * Temperatures are snapped to multiples of quantum (in Kelvin), so scenes with thousands of
+ * blackbody emitters evaluate a handful of tables instead of Planck's law per sample. Tables are
+ * allocated from an arena owned by the cache and stay valid until it is destroyed.
+ * lookup() is thread-safe.
+ */
+class BlackbodyTableCache {
+public:
+    JTX_HOST
+    explicit BlackbodyTableCache(float quantum = 10, Allocator alloc = {});
+
+    [[nodiscard]]
+    JTX_HOST
+    float quantize(const float t) const { return jtx::max(1.0f, std::round(t / quantum)) * quantum; }
+
+    // Returns the N_DENSE_SAMPLES normalized values for quantize(t), computing them on first use
+    [[nodiscard]]
+    JTX_HOST
+    const float *lookup(float t);
+
+    [[nodiscard]]
+    JTX_HOST
+    size_t size() const;
+
+private:
+    float quantum;
+    pmr::monotonic_buffer_resource arena;
+    mutable std::mutex mutex;
+    std::unordered_map<int, const float *> tables;
+};
+
+// Planck's law normalized to a peak of 1
 class BlackbodySpectrum {
     float t;
     float normFactor;
+    // Dense 1nm samples over [LAMBDA_MIN, LAMBDA_MAX] from a BlackbodyTableCache, if any
+    const float *table = nullptr;
 public:
     JTX_HOSTDEV
     explicit BlackbodySpectrum(float t) : t(t) {
         normFactor = 1 / jtx::blackBody((WEIN_DISPLACEMENT / t) * 1e9f, t);
     }
 
+    // Snaps t to the cache's temperature grid and evaluates through the shared table
+    JTX_HOST
+    BlackbodySpectrum(const float t, BlackbodyTableCache &cache) : BlackbodySpectrum(cache.quantize(t)) {
+        table = cache.lookup(t);
+    }
+
     JTX_HOSTDEV
-    float operator()(int lambda) const {
+    float operator()(const float lambda) const {
+        if (table && lambda >= LAMBDA_MIN && lambda <= LAMBDA_MAX) {
+            const float x = lambda - LAMBDA_MIN;
+            const int i = jtx::min(static_cast<int>(x), N_DENSE_SAMPLES - 2);
+            return lerp(table[i], table[i + 1], x - static_cast<float>(i));
+        }
         return blackBody(lambda, t) * normFactor;
     }
 
-
     JTX_HOSTDEV
     [[nodiscard]]
     SampledSpectrum sample(const SampledWavelengths &lambda) const {
         SampledSpectrum s;
-        for (int i = 0; i < N_SPECTRUM_SAMPLES; ++i) s[i] = blackBody(lambda[i], t) * normFactor;
+        for (int i = 0; i < N_SPECTRUM_SAMPLES; ++i) s[i] = (*this)(lambda[i]);
         return s;
     }
 
+    JTX_HOSTDEV
+    void sampleDense(span<float> dst) const {
+        ASSERT(dst.size() == N_DENSE_SAMPLES);
+        if (table) {
+            for (int i = 0; i < N_DENSE_SAMPLES; ++i) dst[i] = table[i];
+            return;
+        }
+        for (int i = 0; i < N_DENSE_SAMPLES; ++i) dst[i] = blackBody(LAMBDA_MIN + static_cast<float>(i), t) * normFactor;
+    }
+
+    // The cached table over [LAMBDA_MIN, LAMBDA_MAX], or an empty span if not cached
+    [[nodiscard]]
+    JTX_HOSTDEV
+    span<const float> denseView() const {
+        if (!table) return {};
+        return {table, N_DENSE_SAMPLES};
+    }
+
     JTX_HOSTDEV
     [[nodiscard]]
     float maxValue() const { return 1.0f; } // NOLINT(*-convert-member-functions-to-static)
+
+    [[nodiscard]]
+    JTX_HOST
+    std::string toString() const {
+        return "BlackbodySpectrum(" + std::to_string(t) + (table ? ", cached)" : ")");
+    }
 };
 
-JTX_HOSTDEV
-JTX_INLINE float innerProduct(const Spectrum &f, const Spectrum &g) {
-    float integral = 0;
-    for (float lambda = LAMBDA_MIN; lambda <= LAMBDA_MAX; ++lambda) {
-        integral += f(lambda) * g(lambda);
+// Reflectances in [0, 1]
+class RGBAlbedoSpectrum {
+    RGBSigmoidPolynomial rsp;
+public:
+    JTX_HOSTDEV
+    RGBAlbedoSpectrum(const RGBToSpectrumTable &table, const Color &rgb) {
+        ASSERT(jtx::max(rgb.r, rgb.g, rgb.b) <= 1);
+        ASSERT(jtx::min(rgb.r, rgb.g, rgb.b) >= 0);
+        rsp = table(rgb);
     }
-    return integral;
-}
 
-namespace spectra {
-    inline const DenselySampledSpectrum &X() {
-        extern DenselySampledSpectrum *x;
-        return *x;
+    JTX_HOSTDEV
+    float operator()(const float lambda) const { return rsp(lambda); }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    float maxValue() const { return rsp.maxValue(); }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    SampledSpectrum sample(const SampledWavelengths &lambda) const {
+        SampledSpectrum s;
+        for (int i = 0; i < N_SPECTRUM_SAMPLES; ++i) s[i] = rsp(lambda[i]);
+        return s;
+    }
+
+    JTX_HOSTDEV
+    void sampleDense(span<float> dst) const {
+        ASSERT(dst.size() == N_DENSE_SAMPLES);
+        for (int i = 0; i < N_DENSE_SAMPLES; ++i) dst[i] = rsp(LAMBDA_MIN + static_cast<float>(i));
+    }
+
+    [[nodiscard]]
+    JTX_HOST
+    std::string toString() const { return "RGBAlbedoSpectrum"; }
+};
+
+// Unbounded values (e.g. scattering coefficients), stored as a scaled albedo
+class RGBUnboundedSpectrum {
+    float scale = 1;
+    RGBSigmoidPolynomial rsp;
+public:
+    JTX_HOSTDEV
+    RGBUnboundedSpectrum(const RGBToSpectrumTable &table, const Color &rgb) {
+        const float m = jtx::max(rgb.r, rgb.g, rgb.b);
+        scale = 2 * m;
+        rsp = table(scale != 0 ? rgb / scale : Color(0, 0, 0));
+    }
+
+    JTX_HOSTDEV
+    float operator()(const float lambda) const { return scale * rsp(lambda); }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    float maxValue() const { return scale * rsp.maxValue(); }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    SampledSpectrum sample(const SampledWavelengths &lambda) const {
+        SampledSpectrum s;
+        for (int i = 0; i < N_SPECTRUM_SAMPLES; ++i) s[i] = scale * rsp(lambda[i]);
+        return s;
     }
-    inline const DenselySampledSpectrum &Y() {
-        extern DenselySampledSpectrum *y;
-        return *y;
+
+    JTX_HOSTDEV
+    void sampleDense(span<float> dst) const {
+        ASSERT(dst.size() == N_DENSE_SAMPLES);
+        for (int i = 0; i < N_DENSE_SAMPLES; ++i) dst[i] = scale * rsp(LAMBDA_MIN + static_cast<float>(i));
     }
-    inline const DenselySampledSpectrum &Z() {
-        extern DenselySampledSpectrum *z;
-        return *z;
+
+    [[nodiscard]]
+    JTX_HOST
+    std::string toString() const { return "RGBUnboundedSpectrum(" + std::to_string(scale) + ")"; }
+};
+
+// Emission, stored as an unbounded spectrum multiplied by the color space's illuminant
+class RGBIlluminantSpectrum {
+    float scale = 1;
+    RGBSigmoidPolynomial rsp;
+    const DenselySampledSpectrum *illuminant;
+public:
+    JTX_HOSTDEV
+    RGBIlluminantSpectrum(const RGBToSpectrumTable &table, const Color &rgb, const DenselySampledSpectrum *illuminant)
+        : illuminant(illuminant) {
+        ASSERT(illuminant != nullptr);
+        const float m = jtx::max(rgb.r, rgb.g, rgb.b);
+        scale = 2 * m;
+        rsp = table(scale != 0 ? rgb / scale : Color(0, 0, 0));
     }
 
-    void init(Allocator alloc);
+    JTX_HOSTDEV
+    float operator()(const float lambda) const { return scale * rsp(lambda) * (*illuminant)(lambda); }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    float maxValue() const { return scale * rsp.maxValue() * illuminant->maxValue(); }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    SampledSpectrum sample(const SampledWavelengths &lambda) const {
+        return sample(lambda, illuminant->sample(lambda));
+    }
+
+    // Same as sample(lambda), with the illuminant already evaluated at lambda
+    [[nodiscard]]
+    JTX_HOSTDEV
+    SampledSpectrum sample(const SampledWavelengths &lambda, const SampledSpectrum &illum) const {
+        SampledSpectrum s;
+        for (int i = 0; i < N_SPECTRUM_SAMPLES; ++i) s[i] = scale * rsp(lambda[i]);
+        return s * illum;
+    }
+
+    [[nodiscard]]
+    JTX_HOSTDEV
+    const DenselySampledSpectrum *getIlluminant() const { return illuminant; }
+
+    JTX_HOSTDEV
+    void sampleDense(span<float> dst) const {
+        ASSERT(dst.size() == N_DENSE_SAMPLES);
+        illuminant->sampleDense(dst);
+        for (int i = 0; i < N_DENSE_SAMPLES; ++i) dst[i] *= scale * rsp(LAMBDA_MIN + static_cast<float>(i));
+    }
+
+    [[nodiscard]]
+    JTX_HOST
+    std::string toString() const { return "RGBIlluminantSpectrum(" + std::to_string(scale) + ")"; }
+};
+
+#pragma region Spectrum Inline Functions
+JTX_HOSTDEV
+JTX_INLINE float Spectrum::operator()(float lambda) const {
+    auto op = [&](auto ptr) { return (*ptr)(lambda); };
+    return dispatch(op);
+}
+
+JTX_HOSTDEV
+JTX_INLINE float Spectrum::maxValue() const {
+    auto op = [&](auto ptr) { return ptr->maxValue(); };
+    return dispatch(op);
 }
 
-constexpr float CIE_Y_INTEGRAL = 106.856895f;
+JTX_HOSTDEV
+JTX_INLINE SampledSpectrum Spectrum::sample(const SampledWavelengths &lambda) const {
+    auto op = [&](auto ptr) { return ptr->sample(lambda); };
+    return dispatch(op);
+}
 
 JTX_HOSTDEV
-JTX_INLINE Vec3f SpectrumToXYZ(Spectrum s) {
-    return Vec3f(
-        innerProduct(Spectrum(&spectra::X), s),
-        innerProduct(Spectrum(&spectra::Y), s),
-        innerProduct(Spectrum(&spectra::Z), s)) / CIE_Y_INTEGRAL;
+JTX_INLINE void Spectrum::sampleDense(span<float> dst) const {
+    auto op = [&](auto ptr) { return ptr->sampleDense(dst); };
+    return dispatch(op);
+}
+
+JTX_HOST
+JTX_INLINE std::string Spectrum::toString() const {
+    if (getPtr() == nullptr) return "(nullptr)";
+
+    auto op = [&](auto ptr) { return ptr->toString(); };
+    return dispatch(op);
+}
+#pragma endregion
+
+/**
+ * Integrates f * g over [LAMBDA_MIN, LAMBDA_MAX] at 1nm steps.
+ *
+ * Dispatches once on the (f, g) type pair. A constant operand is factored out of the sum, two
+ * piecewise-linear spectra are summed in closed form over their merged knots in O(knots), and
+ * everything else is resampled to dense arrays (full-range dense spectra are read in place) and
+ * reduced with a SIMD dot product.
+ */
+JTX_HOST
+float innerProduct(const Spectrum &f, const Spectrum &g);
+
+// Read-only dense views of static tables; safe to use from any thread or static initializer
+namespace spectra {
+    JTX_HOST
+    const DenselySampledSpectrum &X();
+
+    JTX_HOST
+    const DenselySampledSpectrum &Y();
+
+    JTX_HOST
+    const DenselySampledSpectrum &Z();
+
+    // CIE standard illuminant D65, normalized to a luminance (Y) of 1
+    JTX_HOST
+    const DenselySampledSpectrum &D65();
+
+    /**
+     * Named spectrum registry.
+     *
+     * Built-in names are "cie-x", "cie-y", "cie-z" and "stdillum-D65". Returns a null Spectrum for
+     * unknown names. Handles stay valid for the lifetime of the process. They are shared, so the
+     * spectra behind them are read-only: do not scale() them. Thread-safe.
+     */
+    JTX_HOST
+    Spectrum get(const std::string &name);
+
+    /**
+     * Adds a named spectrum that is constructed on its first get().
+     *
+     * factory runs at most once and must allocate the spectrum from the allocator it is given, which
+     * is backed by the registry's shared arena. It runs under the registry lock, so it must not call
+     * back into the registry. Returns false if the name is already taken.
+     */
+    JTX_HOST
+    bool registerNamed(const std::string &name, std::function<Spectrum(Allocator)> factory);
+
+    // Returns a shared, read-only piecewise-linear spectrum with this content, deduplicated by content hash
+    JTX_HOST
+    Spectrum intern(span<const float> lambda, span<const float> values);
+
+    // Returns a shared, read-only densely sampled spectrum with this content, deduplicated by content hash
+    JTX_HOST
+    Spectrum internDense(span<const float> values, int lambdaMin = LAMBDA_MIN);
+}
+
+namespace detail {
+    // The content hash spectra::intern() and spectra::internDense() bucket by; only replaced by tests, to force collisions
+    extern uint64_t (*internHash)(const void *data, size_t bytes, uint64_t seed);
 }
 
-}
\ No newline at end of file
+// Integral of the 1nm CIE Y table, computed at compile time so a constant spectrum of 1 has Y = 1 exactly
+constexpr float CIE_Y_INTEGRAL = [] {
+    double sum = 0;
+    for (const float y : detail::CIE_Y) sum += y;
+    return static_cast<float>(sum);
+}();
+
+/**
+ * Converts a spectrum to XYZ by integrating it against the CIE matching functions.
+ *
+ * Results are cached for the shared handles from spectra::get() and spectra::intern(), which
+ * are never freed, so converting the same named or interned illuminant repeatedly is a lookup.
+ * Other handles are integrated on every call.
+ */
+JTX_HOST
+Vec3f SpectrumToXYZ(const Spectrum &s);
+
+JTX_HOST
+void clearXYZCache();
+
+/**
+ * Evaluates many spectra at one set of wavelengths.
+ *
+ * Handles are grouped by tag with a BatchDispatcher, then each type's kernel runs over its whole group
+ * after a single dispatch, hoisting per-batch work (e.g. dense table offsets, shared illuminants) out
+ * of the loop. Results are written back in input order; null handles evaluate to 0.
+ * Keeps its scratch storage between calls, so reuse one instance per thread.
+ */
+class SpectrumBatch {
+public:
+    JTX_HOST
+    explicit SpectrumBatch(const Allocator alloc = {}) : dispatcher(alloc) {}
+
+    JTX_HOST
+    void sample(span<const Spectrum> spectra, const SampledWavelengths &lambda, span<SampledSpectrum> out);
+
+private:
+    BatchDispatcher<Spectrum> dispatcher;
+};
+
+}
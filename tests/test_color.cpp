@@ -0,0 +1,104 @@
+#include "color.hpp"
+#include "spectrum.hpp"
+#include "tspectra.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace jtx;
+
+// Evenly spaced over [0, 1], plus geometrically spaced values near 0 where the encodings are steepest
+static std::vector<float> encodeInputs() {
+    std::vector<float> v;
+    constexpr int N = 1 << 21;
+    for (int i = 0; i <= N; ++i) v.push_back(static_cast<float>(i) / N);
+    for (float x = 1e-12f; x < 1e-2f; x *= 1.001f) v.push_back(x);
+    return v;
+}
+
+// Largest difference, in codes, between the encoder's output and the rounded reference
+template<typename Encoding, typename F>
+static int maxCodeError(const Encoding &encoding, const std::vector<float> &vin, F &&reference) {
+    std::vector<uint8_t> vout(vin.size());
+    encoding.fromLinear(vin, vout);
+    int maxError = 0;
+    for (size_t i = 0; i < vin.size(); ++i) {
+        const int expected = static_cast<int>(reference(static_cast<double>(vin[i])) * 255 + 0.5);
+        maxError = std::max(maxError, std::abs(static_cast<int>(vout[i]) - expected));
+    }
+    return maxError;
+}
+
+TEST_CASE("sRGB encoding matches pow", "[ColorEncoding]") {
+    const auto vin = encodeInputs();
+    const sRGBColorEncoding encoding;
+    REQUIRE(maxCodeError(encoding, vin, [](const double v) {
+        return v <= 0.0031308 ? 12.92 * v : 1.055 * std::pow(v, 1 / 2.4) - 0.055;
+    }) <= 1);
+}
+
+TEST_CASE("Gamma encoding matches pow", "[ColorEncoding]") {
+    const auto vin = encodeInputs();
+    for (const float gamma : {2.2f, 1.8f, 1.0f, 0.5f}) {
+        const GammaColorEncoding encoding(gamma);
+        REQUIRE(maxCodeError(encoding, vin, [gamma](const double v) { return std::pow(v, 1.0 / gamma); }) <= 1);
+    }
+}
+
+TEST_CASE("Encodings clamp out of range values", "[ColorEncoding]") {
+    const std::vector<float> vin = {-1.0f, 0.0f, 1.0f, 2.0f, std::nanf("")};
+    std::vector<uint8_t> vout(vin.size());
+    const std::vector<uint8_t> expected = {0, 0, 255, 255, 0};
+
+    sRGBColorEncoding().fromLinear(vin, vout);
+    REQUIRE(vout == expected);
+    GammaColorEncoding(2.2f).fromLinear(vin, vout);
+    REQUIRE(vout == expected);
+}
+
+// The RGB cube at 0, 0.05, ..., 1 per channel
+static std::vector<Color> rgbGrid() {
+    std::vector<Color> v;
+    for (int r = 0; r <= 20; ++r) {
+        for (int g = 0; g <= 20; ++g) {
+            for (int b = 0; b <= 20; ++b) v.push_back({r / 20.0f, g / 20.0f, b / 20.0f});
+        }
+    }
+    return v;
+}
+
+TEST_CASE("RGB to spectrum round trip", "[RGBToSpectrum]") {
+    initColorSpaces();
+    // Rec2020's primaries lie on the spectral locus, where no smooth spectrum reaches, so only its less saturated
+    // colors (smallest channel at least minRatio of the largest) are expected to round trip
+    const std::pair<const RGBColorSpace *, float> spaces[] = {{RGBColorSpace::sRGB, 0.0f},
+                                                              {RGBColorSpace::Rec2020, 0.2f}};
+    for (const auto &[cs, minRatio] : spaces) {
+        // Emission under the space's illuminant maps back to the same RGB, relative to the white point's Y
+        auto *illum = const_cast<DenselySampledSpectrum *>(cs->illuminant);
+        const float whiteY = SpectrumToXYZ(Spectrum(illum)).y;
+        for (const Color &rgb : rgbGrid()) {
+            if (std::min({rgb.r, rgb.g, rgb.b}) < minRatio * std::max({rgb.r, rgb.g, rgb.b})) continue;
+            RGBIlluminantSpectrum s(*cs->rgbToSpectrum, rgb, illum);
+            const Color out = cs->toRGB(SpectrumToXYZ(Spectrum(&s)) / whiteY);
+            for (int c = 0; c < 3; ++c) REQUIRE(std::abs(out[c] - rgb[c]) <= 2e-3f);
+        }
+    }
+}
+
+TEST_CASE("RGBAlbedoSpectrum stays within [0, 1]", "[RGBToSpectrum]") {
+    initColorSpaces();
+    for (const RGBColorSpace *cs : {RGBColorSpace::sRGB, RGBColorSpace::Rec2020}) {
+        for (const Color &rgb : rgbGrid()) {
+            const RGBAlbedoSpectrum s(*cs->rgbToSpectrum, rgb);
+            float v[N_DENSE_SAMPLES];
+            s.sampleDense(v);
+            for (const float x : v) {
+                REQUIRE(x >= 0);
+                REQUIRE(x <= 1);
+            }
+            REQUIRE(s.maxValue() <= 1);
+        }
+    }
+}
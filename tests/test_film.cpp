@@ -0,0 +1,48 @@
+#include "film.hpp"
+#include "tspectra.h"
+#include <cmath>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace jtx;
+
+// n camera samples: visible-sampled, uniformly sampled past both ends of the table, and some with a terminated secondary
+static void makeSamples(const size_t n, std::vector<SampledSpectrum> &L, std::vector<SampledWavelengths> &lambda) {
+    L.clear();
+    lambda.clear();
+    for (size_t i = 0; i < n; ++i) {
+        const float u = (static_cast<float>(i) + 0.37f) / static_cast<float>(n);
+        SampledWavelengths l = i % 3 == 1 ? SampledWavelengths::sampleUniform(u, 300, 900)
+                                          : SampledWavelengths::sampleVisible(u);
+        if (i % 4 == 3) l.terminateSecondary();
+        SampledSpectrum s;
+        for (int j = 0; j < N_SPECTRUM_SAMPLES; ++j) s[j] = 0.25f + 0.5f * static_cast<float>((i * 5 + j * 3) % 7);
+        L.push_back(s);
+        lambda.push_back(l);
+    }
+}
+
+TEST_CASE("FilmSensor batch toRGB matches scalar toRGB", "[FilmSensor]") {
+    initColorSpaces();
+    const FilmSensor sensors[] = {FilmSensor(*RGBColorSpace::sRGB),
+                                  FilmSensor(*RGBColorSpace::Rec2020, spectra::get("stdillum-D65"), 2.0f)};
+
+    for (const FilmSensor &sensor : sensors) {
+        // Odd sizes leave a sample for the scalar tail after the 2-per-vector loop
+        for (const size_t n : {0, 1, 2, 3, 4, 5, 8, 17, 64, 101}) {
+            std::vector<SampledSpectrum> L;
+            std::vector<SampledWavelengths> lambda;
+            makeSamples(n, L, lambda);
+            std::vector<Color> out(n);
+            sensor.toRGB(L, lambda, out);
+
+            for (size_t i = 0; i < n; ++i) {
+                const Color expected = sensor.toRGB(L[i], lambda[i]);
+                for (int c = 0; c < 3; ++c) {
+                    REQUIRE(std::isfinite(out[i][c]));
+                    REQUIRE(std::abs(out[i][c] - expected[c]) <= 1e-5f * std::abs(expected[c]) + 1e-6f);
+                }
+            }
+        }
+    }
+}
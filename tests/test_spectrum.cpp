@@ -0,0 +1,454 @@
+#include "spectrum.hpp"
+#include "tspectra.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace jtx;
+
+// f * g summed over the 1nm grid one wavelength at a time, the definition innerProduct must match
+static double bruteForceInnerProduct(const Spectrum &f, const Spectrum &g) {
+    if (!f || !g) return 0;
+    double sum = 0;
+    for (int i = 0; i < N_DENSE_SAMPLES; ++i) {
+        const float lambda = LAMBDA_MIN + static_cast<float>(i);
+        sum += static_cast<double>(f(lambda)) * g(lambda);
+    }
+    return sum;
+}
+
+// |start + slope * t| for t in [0, 1), as n dense samples
+static std::vector<float> makeRamp(const int n, const float start, const float slope) {
+    std::vector<float> v(n);
+    for (int i = 0; i < n; ++i) v[i] = std::abs(start + slope * static_cast<float>(i) / static_cast<float>(n));
+    return v;
+}
+
+// One spectrum of every type, plus the layouts with their own code paths. Needs initColorSpaces().
+struct SpectrumSet {
+    // Viewed by the dense spectra that only cover part of the visible range
+    std::vector<float> ramp = makeRamp(301, 0.5f, 2.0f);
+    std::vector<float> hump = makeRamp(301, 1.5f, -1.0f);
+
+    ConstantSpectrum constant{0.75f};
+    DenselySampledSpectrum dense{spectra::X(), Allocator{}};
+    DenselySampledSpectrum partialDense{ramp, 400};
+    DenselySampledSpectrum offsetDense{hump, 300};
+    CompactDenseSpectrum compactHalf{Spectrum(&dense), 5, true};
+    CompactDenseSpectrum compactFull{Spectrum(&dense), 1, false};
+    PiecewiseLinearSpectrum pwl{std::vector<float>{400, 450, 500, 620, 700},
+                                std::vector<float>{0.1f, 0.8f, 0.3f, 0.9f, 0.2f}};
+    PiecewiseLinearSpectrum pwlOutside{std::vector<float>{300, 420, 555.5f, 900},
+                                       std::vector<float>{2, 0.5f, 1.5f, 0.25f}};
+    PiecewiseLinearSpectrum pwlFractional{std::vector<float>{410.25f, 410.75f, 600.5f, 829.9f},
+                                          std::vector<float>{1, 3, 0.5f, 2}};
+    BlackbodySpectrum blackbody{5500};
+    BlackbodyTableCache cache;
+    BlackbodySpectrum blackbodyCached{3200, cache};
+    RGBAlbedoSpectrum albedo{*RGBToSpectrumTable::sRGB, {0.2f, 0.5f, 0.8f}};
+    RGBUnboundedSpectrum unbounded{*RGBToSpectrumTable::sRGB, {2.0f, 5.0f, 8.0f}};
+    RGBIlluminantSpectrum illuminant{*RGBToSpectrumTable::sRGB, {0.8f, 0.6f, 0.4f}, &spectra::D65()};
+
+    // Starts with a null handle
+    std::vector<Spectrum> handles = {
+            Spectrum(), Spectrum(&constant), Spectrum(&dense), Spectrum(&partialDense), Spectrum(&offsetDense),
+            Spectrum(&compactHalf), Spectrum(&compactFull), Spectrum(&pwl), Spectrum(&pwlOutside),
+            Spectrum(&pwlFractional), Spectrum(&blackbody), Spectrum(&blackbodyCached), Spectrum(&albedo),
+            Spectrum(&unbounded), Spectrum(&illuminant)};
+};
+
+static const SpectrumSet &spectrumSet() {
+    initColorSpaces();
+    static const SpectrumSet set;
+    return set;
+}
+
+TEST_CASE("innerProduct matches the brute-force sum for every type pair", "[Spectrum]") {
+    const SpectrumSet &set = spectrumSet();
+    for (const Spectrum &f : set.handles) {
+        for (const Spectrum &g : set.handles) {
+            const double expected = bruteForceInnerProduct(f, g);
+            const float actual = innerProduct(f, g);
+            if (!f || !g) REQUIRE(actual == 0);
+            else REQUIRE(std::abs(actual - expected) <= 1e-5 * std::abs(expected) + 1e-6);
+        }
+    }
+}
+
+TEST_CASE("SpectrumToXYZ", "[Spectrum]") {
+    SECTION("A constant of 1 has Y = 1") {
+        ConstantSpectrum one(1);
+        REQUIRE(std::abs(SpectrumToXYZ(Spectrum(&one)).y - 1) < 1e-6f);
+    }
+
+    SECTION("D65 is the D65 white point") {
+        const Vec3f xyz = SpectrumToXYZ(spectra::get("stdillum-D65"));
+        REQUIRE(std::abs(xyz.x - 0.9505f) < 1e-3f);
+        REQUIRE(std::abs(xyz.y - 1.0f) < 1e-5f);
+        REQUIRE(std::abs(xyz.z - 1.089f) < 1e-3f);
+    }
+
+    SECTION("The vectorized dot product matches a double-precision sum") {
+        const SpectrumSet &set = spectrumSet();
+        for (const Spectrum &s : set.handles) {
+            if (!s) continue;
+            double x = 0, y = 0, z = 0;
+            for (int i = 0; i < N_DENSE_SAMPLES; ++i) {
+                const double v = s(LAMBDA_MIN + static_cast<float>(i));
+                x += v * detail::CIE_X[i];
+                y += v * detail::CIE_Y[i];
+                z += v * detail::CIE_Z[i];
+            }
+            const Vec3f xyz = SpectrumToXYZ(s);
+            REQUIRE(std::abs(xyz.x - x / CIE_Y_INTEGRAL) <= 1e-5 * std::abs(x / CIE_Y_INTEGRAL) + 1e-7);
+            REQUIRE(std::abs(xyz.y - y / CIE_Y_INTEGRAL) <= 1e-5 * std::abs(y / CIE_Y_INTEGRAL) + 1e-7);
+            REQUIRE(std::abs(xyz.z - z / CIE_Y_INTEGRAL) <= 1e-5 * std::abs(z / CIE_Y_INTEGRAL) + 1e-7);
+        }
+    }
+
+    // Scaling a spectrum behind a handle shows whether its XYZ was recomputed
+    SECTION("Registry handles are cached") {
+        const float lambda[] = {400, 550, 700};
+        const float values[] = {0.25f, 0.5f, 0.125f};
+        const Spectrum s = spectra::intern(lambda, values);
+        const Vec3f first = SpectrumToXYZ(s);
+
+        PiecewiseLinearSpectrum *pwl = Spectrum(s).cast<PiecewiseLinearSpectrum>();
+        pwl->scale(2);
+        REQUIRE(SpectrumToXYZ(s) == first);
+        clearXYZCache();
+        REQUIRE(SpectrumToXYZ(s) == first * 2);
+
+        // Leave the shared spectrum as it was interned
+        pwl->scale(0.5f);
+        clearXYZCache();
+        REQUIRE(SpectrumToXYZ(s) == first);
+    }
+
+    SECTION("Other handles are not cached") {
+        const float lambda[] = {400, 550, 700};
+        const float values[] = {0.25f, 0.5f, 0.125f};
+        PiecewiseLinearSpectrum pwl(lambda, values);
+        const Spectrum s(&pwl);
+        const Vec3f first = SpectrumToXYZ(s);
+        pwl.scale(2);
+        REQUIRE(SpectrumToXYZ(s) == first * 2);
+    }
+}
+
+TEST_CASE("Visible wavelength sampling", "[Spectrum]") {
+    SECTION("The pdf integrates to 1 over the visible range") {
+        constexpr int N = 470000;
+        double sum = 0;
+        for (int i = 0; i < N; ++i) {
+            sum += visibleWavelengthsPDF(LAMBDA_MIN + (LAMBDA_MAX - LAMBDA_MIN) * (static_cast<float>(i) + 0.5f) / N);
+        }
+        REQUIRE(std::abs(sum * (LAMBDA_MAX - LAMBDA_MIN) / N - 1) < 1e-3);
+        REQUIRE(visibleWavelengthsPDF(LAMBDA_MIN - 1) == 0);
+        REQUIRE(visibleWavelengthsPDF(LAMBDA_MAX + 1) == 0);
+    }
+
+    SECTION("Samples stay in the visible range and invert the CDF") {
+        // The pdf is a scaled sech^2, so its CDF is a tanh
+        auto cdf = [](const double l) {
+            constexpr double a = 0.0072;
+            return 0.0039398042 / a * (std::tanh(a * (l - 538)) - std::tanh(a * (LAMBDA_MIN - 538)));
+        };
+        REQUIRE(std::abs(cdf(LAMBDA_MAX) - 1) < 1e-5);
+
+        constexpr int N = 10000;
+        for (int i = 0; i < N; ++i) {
+            const float u = static_cast<float>(i) / N;
+            const float l = sampleVisibleWavelengths(u);
+            REQUIRE(l >= LAMBDA_MIN);
+            REQUIRE(l <= LAMBDA_MAX);
+            REQUIRE(std::abs(cdf(l) - u) < 1e-4);
+        }
+
+        const SampledWavelengths lambdas = SampledWavelengths::sampleVisible(0.999f);
+        for (int i = 0; i < N_SPECTRUM_SAMPLES; ++i) {
+            REQUIRE(lambdas[i] >= LAMBDA_MIN);
+            REQUIRE(lambdas[i] <= LAMBDA_MAX);
+            REQUIRE(lambdas.PDF()[i] == visibleWavelengthsPDF(lambdas[i]));
+        }
+    }
+
+    SECTION("WavelengthDistribution's pdf is the density of its samples") {
+        const WavelengthDistribution distrib(Spectrum(const_cast<DenselySampledSpectrum *>(&spectra::Y())));
+        constexpr int N = 1 << 20;
+        std::vector<int> counts(N_DENSE_SAMPLES - 1);
+        for (int i = 0; i < N; ++i) {
+            const float l = distrib.sample((static_cast<float>(i) + 0.5f) / N);
+            REQUIRE(l >= LAMBDA_MIN);
+            REQUIRE(l <= LAMBDA_MAX);
+            ++counts[jtx::min(static_cast<int>(l - LAMBDA_MIN), N_DENSE_SAMPLES - 2)];
+        }
+
+        double total = 0;
+        for (int b = 0; b < N_DENSE_SAMPLES - 1; ++b) {
+            const float pdf = distrib.pdf(LAMBDA_MIN + static_cast<float>(b) + 0.5f);
+            REQUIRE(std::abs(static_cast<float>(counts[b]) / N - pdf) < 1e-4f);
+            total += pdf;
+        }
+        REQUIRE(std::abs(total - 1) < 1e-4);
+    }
+}
+
+// The interval search the grid replaced: the last knot at or below lambda, by binary search
+static float binarySearchEvaluate(const std::vector<float> &lambdas, const std::vector<float> &values, const float l) {
+    if (lambdas.size() < 2 || l < lambdas.front() || l > lambdas.back()) return 0;
+    const auto o = jtx::min(static_cast<size_t>(std::upper_bound(lambdas.begin(), lambdas.end(), l) - lambdas.begin()),
+                            lambdas.size() - 1) - 1;
+    return lerp(values[o], values[o + 1], (l - lambdas[o]) / (lambdas[o + 1] - lambdas[o]));
+}
+
+TEST_CASE("PiecewiseLinearSpectrum lookups match a binary search", "[Spectrum]") {
+    // Unevenly spaced knots, so grid buckets hold several knots or none
+    const std::vector<std::vector<float>> knotSets = {
+            {},
+            {500},
+            {450, 650},
+            {380, 381, 382, 390, 500, 501.5f, 502, 700, 800, 829},
+            {200, 420.5f, 421, 421.25f, 600, 1000},
+    };
+
+    for (const std::vector<float> &lambdas : knotSets) {
+        std::vector<float> values(lambdas.size());
+        for (size_t i = 0; i < values.size(); ++i) values[i] = 0.1f + static_cast<float>((i * 7) % 5);
+        const PiecewiseLinearSpectrum pwl(lambdas, values);
+
+        // Sorted, backward, repeated, knot-exact and out of range, in one stream so the cursor sees every transition
+        std::vector<float> queries;
+        for (float l = 300; l <= 900; l += 0.75f) queries.push_back(l);
+        for (float l = 900; l >= 300; l -= 1.25f) queries.push_back(l);
+        for (const float knot : lambdas) {
+            queries.insert(queries.end(), {knot, knot, std::nextafter(knot, 0.0f), knot, std::nextafter(knot, 2000.0f)});
+        }
+        queries.insert(queries.end(), {LAMBDA_MIN, LAMBDA_MAX, 100, 550, 550, 420, 2000, 421.1f, 380.5f, 0});
+
+        std::vector<float> evaluated(queries.size());
+        pwl.evaluate(queries, evaluated);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const float expected = binarySearchEvaluate(lambdas, values, queries[i]);
+            REQUIRE(pwl(queries[i]) == expected);
+            REQUIRE(evaluated[i] == expected);
+        }
+
+        SampledWavelengths lambda = SampledWavelengths::sampleUniform(0.3f);
+        for (size_t i = 0; i + N_SPECTRUM_SAMPLES <= queries.size(); i += N_SPECTRUM_SAMPLES) {
+            for (int j = 0; j < N_SPECTRUM_SAMPLES; ++j) lambda[j] = queries[i + j];
+            const SampledSpectrum s = pwl.sample(lambda);
+            for (int j = 0; j < N_SPECTRUM_SAMPLES; ++j) {
+                REQUIRE(s[j] == binarySearchEvaluate(lambdas, values, queries[i + j]));
+            }
+        }
+
+        float dense[N_DENSE_SAMPLES];
+        pwl.sampleDense(dense);
+        for (int i = 0; i < N_DENSE_SAMPLES; ++i) {
+            REQUIRE(dense[i] == binarySearchEvaluate(lambdas, values, LAMBDA_MIN + static_cast<float>(i)));
+        }
+    }
+}
+
+TEST_CASE("Named spectrum registry", "[Spectrum]") {
+    SECTION("Built-in and unknown names") {
+        REQUIRE(spectra::get("cie-y").getPtr() == &spectra::Y());
+        REQUIRE(spectra::get("stdillum-D65").getPtr() == &spectra::D65());
+        REQUIRE_FALSE(spectra::get("no-such-spectrum"));
+        REQUIRE_FALSE(spectra::registerNamed("cie-x", [](Allocator) { return Spectrum(); }));
+    }
+
+    SECTION("A factory runs once, even under concurrent get") {
+        std::atomic<int> calls = 0;
+        REQUIRE(spectra::registerNamed("test-concurrent", [&](Allocator alloc) {
+            ++calls;
+            return Spectrum(alloc.new_object<ConstantSpectrum>(0.5f));
+        }));
+        REQUIRE(calls == 0);
+
+        std::vector<Spectrum> results(8);
+        std::vector<std::thread> threads;
+        for (Spectrum &result : results) threads.emplace_back([&result] { result = spectra::get("test-concurrent"); });
+        for (std::thread &t : threads) t.join();
+
+        REQUIRE(calls == 1);
+        REQUIRE(results[0]);
+        for (const Spectrum &s : results) REQUIRE(s == results[0]);
+        REQUIRE(spectra::get("test-concurrent") == results[0]);
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("Equal content interns to the same spectrum") {
+        const float lambda[] = {400, 500, 600};
+        const float values[] = {0.5f, 0.25f, 0.75f};
+        const std::vector<float> copy(std::begin(values), std::end(values));
+        const Spectrum a = spectra::intern(lambda, values);
+        REQUIRE(spectra::intern(lambda, copy) == a);
+
+        const float otherValues[] = {0.5f, 0.25f, 0.5f};
+        REQUIRE(spectra::intern(lambda, otherValues) != a);
+
+        const std::vector<float> dense = makeRamp(N_DENSE_SAMPLES, 0.25f, 0.5f);
+        const Spectrum d = spectra::internDense(dense);
+        REQUIRE(d.is<DenselySampledSpectrum>());
+        REQUIRE(spectra::internDense(dense) == d);
+        REQUIRE(spectra::internDense(dense, 300) != d);
+    }
+
+    SECTION("Hash collisions keep different content apart") {
+        uint64_t (*const hash)(const void *, size_t, uint64_t) = detail::internHash;
+        detail::internHash = [](const void *, size_t, uint64_t) -> uint64_t { return 42; };
+
+        const float lambda[] = {410, 510, 610};
+        const float a[] = {1, 2, 3};
+        const float b[] = {3, 2, 1};
+        const Spectrum sa = spectra::intern(lambda, a);
+        const Spectrum sb = spectra::intern(lambda, b);
+        // Dense spectra with the same hash and the same floats as a piecewise-linear one
+        const Spectrum sd = spectra::internDense(a, 410);
+        REQUIRE(sa != sb);
+        REQUIRE(sd != sa);
+        REQUIRE(sd.is<DenselySampledSpectrum>());
+        REQUIRE(spectra::intern(lambda, a) == sa);
+        REQUIRE(spectra::intern(lambda, b) == sb);
+        REQUIRE(spectra::internDense(a, 410) == sd);
+        REQUIRE(sb(510) == 2);
+        REQUIRE(sb(410) == 3);
+
+        detail::internHash = hash;
+    }
+}
+
+TEST_CASE("CompactDenseSpectrum error bounds and format choice", "[Spectrum]") {
+    const SpectrumSet &set = spectrumSet();
+    const Spectrum spectra[] = {Spectrum(const_cast<DenselySampledSpectrum *>(&set.dense)),
+                                Spectrum(const_cast<BlackbodySpectrum *>(&set.blackbody)),
+                                Spectrum(const_cast<PiecewiseLinearSpectrum *>(&set.pwlOutside)),
+                                Spectrum(const_cast<RGBIlluminantSpectrum *>(&set.illuminant))};
+    pmr::monotonic_buffer_resource arena;
+    const Allocator alloc(&arena);
+
+    for (const Spectrum &s : spectra) {
+        float dense[N_DENSE_SAMPLES];
+        s.sampleDense(dense);
+
+        SECTION("maxError() is the deviation from the 1nm table") {
+            for (const int spacing : CompactDenseSpectrum::SPACINGS) {
+                for (const bool half : {false, true}) {
+                    const CompactDenseSpectrum c(s, spacing, half);
+                    float compact[N_DENSE_SAMPLES];
+                    c.sampleDense(compact);
+                    float deviation = 0, pointDeviation = 0;
+                    for (int i = 0; i < N_DENSE_SAMPLES; ++i) {
+                        deviation = jtx::max(deviation, std::abs(compact[i] - dense[i]));
+                        pointDeviation = jtx::max(pointDeviation, std::abs(c(LAMBDA_MIN + static_cast<float>(i)) - dense[i]));
+                    }
+                    REQUIRE(deviation == c.maxError());
+                    REQUIRE(pointDeviation <= c.maxError() * (1 + 1e-5f) + 1e-7f);
+                    REQUIRE(c.maxError() == CompactDenseSpectrum::formatError(dense, spacing, half));
+                    if (spacing == 1 && !half) REQUIRE(c.maxError() == 0);
+                }
+            }
+        }
+
+        SECTION("create() picks the smallest format within the error") {
+            for (const float maxError : {0.0f, 1e-4f, 1e-3f, 1e-2f, 0.1f, 1.0f}) {
+                const CompactDenseSpectrum *c = CompactDenseSpectrum::create(s, maxError, alloc);
+                REQUIRE(c->maxError() <= maxError);
+                for (const int spacing : CompactDenseSpectrum::SPACINGS) {
+                    for (const bool half : {false, true}) {
+                        if (CompactDenseSpectrum::formatError(dense, spacing, half) <= maxError) {
+                            REQUIRE(c->bytes() <= CompactDenseSpectrum::formatBytes(spacing, half));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("SpectrumBatch matches per-handle sampling", "[Spectrum]") {
+    const SpectrumSet &set = spectrumSet();
+    // A second emitter run with its own illuminant, so the shared-illuminant kernel has to switch
+    const RGBIlluminantSpectrum otherIlluminant{*RGBToSpectrumTable::sRGB, {0.1f, 0.9f, 0.3f}, &set.dense};
+
+    // Types interleaved and repeated, so every group scatters back to non-contiguous indices
+    std::vector<Spectrum> spectra;
+    const size_t n = set.handles.size();
+    for (int pass = 0; pass < 3; ++pass) {
+        for (size_t i = 0; i < n; ++i) spectra.push_back(set.handles[(i * 7 + pass * 3) % n]);
+        spectra.push_back(Spectrum(const_cast<RGBIlluminantSpectrum *>(&otherIlluminant)));
+        spectra.push_back(Spectrum());
+    }
+
+    SpectrumBatch batch;
+    std::vector<SampledSpectrum> out(spectra.size());
+    for (const SampledWavelengths &lambda : {SampledWavelengths::sampleVisible(0.3f),
+                                             SampledWavelengths::sampleUniform(0.7f),
+                                             SampledWavelengths::sampleUniform(0.1f, 300, 900)}) {
+        batch.sample(spectra, lambda, out);
+        for (size_t i = 0; i < spectra.size(); ++i) {
+            const SampledSpectrum expected = spectra[i] ? spectra[i].sample(lambda) : SampledSpectrum(0.0f);
+            for (int j = 0; j < N_SPECTRUM_SAMPLES; ++j) REQUIRE(out[i][j] == expected[j]);
+        }
+    }
+}
+
+TEST_CASE("BlackbodyTableCache", "[Spectrum]") {
+    SECTION("Temperatures in the same quantum share one table") {
+        BlackbodyTableCache cache(10);
+        REQUIRE(cache.size() == 0);
+        const float *table = cache.lookup(3200);
+        REQUIRE(cache.lookup(3196) == table);
+        REQUIRE(cache.lookup(3204.9f) == table);
+        REQUIRE(cache.size() == 1);
+        REQUIRE(cache.lookup(3210) != table);
+        REQUIRE(cache.size() == 2);
+        REQUIRE(cache.quantize(3) == 10);
+    }
+
+    SECTION("Cached and uncached spectra agree at the quantized temperature") {
+        BlackbodyTableCache cache(10);
+        for (const float t : {1000.0f, 2854.0f, 5003.0f, 6504.0f, 12000.0f}) {
+            const BlackbodySpectrum cached(t, cache);
+            const BlackbodySpectrum uncached(cache.quantize(t));
+
+            float a[N_DENSE_SAMPLES], b[N_DENSE_SAMPLES];
+            cached.sampleDense(a);
+            uncached.sampleDense(b);
+            for (int i = 0; i < N_DENSE_SAMPLES; ++i) REQUIRE(std::abs(a[i] - b[i]) <= 1e-5f * b[i] + 1e-7f);
+
+            // Between the 1nm samples the table interpolates; outside the visible range both evaluate Planck's law
+            for (float lambda = 300.0f; lambda < 900.0f; lambda += 0.37f) {
+                REQUIRE(std::abs(cached(lambda) - uncached(lambda)) <= 1e-4f);
+            }
+        }
+    }
+
+    SECTION("Concurrent lookups") {
+        BlackbodyTableCache cache(10);
+        constexpr int N_THREADS = 8, N_TEMPS = 200;
+        std::vector<std::vector<const float *>> seen(N_THREADS, std::vector<const float *>(N_TEMPS));
+        std::vector<std::thread> threads;
+        for (int t = 0; t < N_THREADS; ++t) {
+            threads.emplace_back([&, t] {
+                // Each thread walks the temperatures in a different order
+                for (int k = 0; k < N_TEMPS; ++k) {
+                    const int i = (k * 37 + t * 11) % N_TEMPS;
+                    seen[t][i] = cache.lookup(1000.0f + 10.0f * static_cast<float>(i) + static_cast<float>(t % 5 - 2));
+                }
+            });
+        }
+        for (std::thread &thread : threads) thread.join();
+
+        REQUIRE(cache.size() == N_TEMPS);
+        for (int i = 0; i < N_TEMPS; ++i) {
+            for (int t = 1; t < N_THREADS; ++t) REQUIRE(seen[t][i] == seen[0][i]);
+        }
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "colorspace.hpp"
+
+#include <mutex>
+
+// Sets up the RGB to spectrum tables and color spaces once, for every test that needs them
+inline void initColorSpaces() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        jtx::RGBToSpectrumTable::init({});
+        jtx::RGBColorSpace::init({});
+    });
+}